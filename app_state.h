@@ -33,17 +33,15 @@ typedef enum {
 	
 } app_ext_state_t;
 
-typedef struct {
-	
-	app_ext_state_t state;
-	
-} app_ext_state_change_message_t;
-
+/** one payload-less message per state, nothing is allocated for a state change **/
 enum {
 
-	APP_EXT_STATE_CHANGE_MESSAGE = APP_MESSAGE_BASE
+	APP_EXT_STATE_IDLE_MESSAGE = APP_MESSAGE_BASE,
+	APP_EXT_STATE_WORKING_MESSAGE
 };
 
+#define appExtStateOf(id)	((id) == APP_EXT_STATE_IDLE_MESSAGE ? APP_EXT_STATE_IDLE : APP_EXT_STATE_WORKING)
+
 #endif /** APP_STATE_H **/
 
 
@@ -1,309 +1,329 @@
-/*
-    Warning - this file was autogenerated by genparse
-    DO NOT EDIT - any changes will be lost
-*/
+/**************************************
+
+  generated by tools/at_compile.py from at_command.grammar, do not edit.
+
+  **************************************/
 
 #include "at_command.h"
 
-#include <ctype.h>
-#include <panic.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <util.h> /* hash and compare */
+#include <source.h>
 
-#if (defined TEST_HARNESS || defined DISPLAY_AT_CMDS)
-#include <stdio.h>
-#endif
 
 typedef const uint8 *ptr;
 
-static __inline__ char my_toupper(char c)
-{ return 'a' <= c && c <= 'z' ? c +'A'-'a' : c; }
+/** builds the typed argument struct and calls the handler **/
+typedef void (*at_dispatch_t)(Task task, const uint16 *arg);
+
+typedef struct {
+
+	uint16			args;		/** number of arguments, all required **/
+	at_dispatch_t	dispatch;
 
-static ptr skip1(ptr s, ptr e)
+} at_command_t;
+
+
+static void dispatchConnect(Task task, const uint16 *arg)
 {
-  if(s)
-    while(s != e && (*s == ' ' || *s == '\t'))
-      ++s;
-  return s;
+	struct connect c;
+
+	c.baudrate = arg[0];
+	c.stop = arg[1];
+	c.parity = arg[2];
+	c.polarity = arg[3];
+	c.keeptime = arg[4];
+
+	connect(task, &c);
 }
 
-static ptr skipOnce1(ptr s, ptr e)
+static void dispatchLatency(Task task, const uint16 *arg)
 {
-  if(s)
-  {
-    if(s != e && (*s == ',' || *s == ';'))
-      ++s;
-  }
-  return s;
+	arg = arg;
+
+	latency(task);
 }
 
-static ptr match1(ptr s, ptr e)
-{ return s && s != e && (*s == '\r' || *s == '\n') ? s+1 : 0; }
+static void dispatchLatreset(Task task, const uint16 *arg)
+{
+	arg = arg;
 
-static ptr findEndOfPacket(ptr s, ptr e)
+	latreset(task);
+}
+
+static void dispatchCoalesce(Task task, const uint16 *arg)
 {
-  /*
-     Returns
-     0   if the buffer holds an incomplete packet
-     s+1 if the buffer holds an invalid packet
-     end of the first packet otherwise
-  */
-  if(s == e) return 0;
-
-  if(*s == '\r')
-  {
-    /* expecting <cr> <lf> ... <cr> <lf> */
-    if(e-s >= 4)
-    {
-      if(s[1] == '\n' && s[2] != '\r')
-      {
-        ptr p = s+2;
-        if(*p != '\r')
-        {
-#ifndef TEST_HARNESS
-        p = (const uint8*)UtilFind(0xFFFF, '\r', (const uint16*)p, 0, 1, (uint16)(e-p));
-#endif
-#ifdef TEST_HARNESS
-		   while(p != e && *p != '\r') p++;
-#endif
-        return p == 0 || p + 1 == e ? 0 /* no terminator yet */
-             : p[1] == '\n' ? p+2 /* valid */
-             : s+1 ; /* invalid terminator */
-         }
-         else
-             return s+1;
-      }
-      else
-      {
-        return s+1;
-      }
-    }
-    else
-    {
-      /* Can't tell yet */
-      return 0;
-    }
-  }
-  else
-  {
-    /* expecting ... <cr> */
-    ptr p = s;
-    while(p != e && (*p == ' ' || *p == '\n' || *p == '\0' || *p == '\t')) ++p;
-    if(p != e && *p == '\r') return s+1;
-    while(p != e && *p != '\r') ++p;
-    return p == e ? 0 : p+1;
-  }
+	struct coalesce c;
+
+	c.coalesce = arg[0];
+
+	coalesce(task, &c);
 }
 
-#ifndef TEST_HARNESS
-#ifdef __XAP__
-uint16 parseSource(Source rfcDataIn, Task task)
+static void dispatchPacktime(Task task, const uint16 *arg)
 {
-  ptr s = SourceMap(rfcDataIn);
-  ptr e = s + SourceSize(rfcDataIn);
-  ptr p = parseData(s, e, task);
-  if(p != s)
-  {
-    SourceDrop(rfcDataIn, (uint16) (p - s));
-    return 1;
-  }
-  else
-  {
-    return 0;
-  }
+	struct packtime c;
+
+	c.packtime = arg[0];
+
+	packtime(task, &c);
 }
-#endif
-#endif
 
-typedef struct {
-  char c;
-  int to;
-} Arc;
-
-static const Arc arcs[] = {
-  { '\t', 0 },
-  { '\n', 1 },
-  { '\r', 1 },
-  { ' ', 0 },
-  { '\n', 2 },
-  { '\r', 2 },
-  { '\t', 2 },
-  { ' ', 2 },
-  { 'A', 3 },
-  { 'T', 4 },
-  { '\t', 4 },
-  { ' ', 4 },
-  { '+', 5 },
-  { '\t', 5 },
-  { ' ', 5 },
-  { 'C', 6 },
-  { 'O', 7 },
-  { 'N', 8 },
-  { 'N', 9 },
-  { 'E', 10 },
-  { 'C', 11 },
-  { 'T', 12 },
-  { '\t', 12 },
-  { ' ', 12 },
-  { ':', -1 },
-  { '=', -1 },
+static void dispatchSniffidle(Task task, const uint16 *arg)
+{
+	struct sniffidle c;
+
+	c.sniffidle = arg[0];
+
+	sniffidle(task, &c);
+}
+
+static void dispatchStats(Task task, const uint16 *arg)
+{
+	arg = arg;
+
+	stats(task);
+}
+
+static void dispatchTrace(Task task, const uint16 *arg)
+{
+	arg = arg;
+
+	trace(task);
+}
+
+/** indexed by at_accept[] **/
+static const at_command_t at_commands[8] = {
+
+	{ 5,	dispatchConnect },			/** CONNECT, connect to com port using given configuration **/
+	{ 0,	dispatchLatency },			/** LATENCY, report latency histograms **/
+	{ 0,	dispatchLatreset },			/** LATRESET, clear latency histograms **/
+	{ 1,	dispatchCoalesce },			/** COALESCE, uart -> spp coalescing window in ms, 0 sends every read at once **/
+	{ 1,	dispatchPacktime },			/** PACKTIME, spp -> uart packing window in ms, 0 derives it from the baudrate **/
+	{ 1,	dispatchSniffidle },		/** SNIFFIDLE, ms of pipe silence before the link leaves active mode, 0 stays active **/
+	{ 0,	dispatchStats },			/** STATS, report hot path counters **/
+	{ 0,	dispatchTrace }				/** TRACE, dump the data path trace, TRACE_ENABLED builds only **/
 };
 
-static const Arc *const states[14] = {
-  &arcs[0],
-  &arcs[4],
-  &arcs[6],
-  &arcs[9],
-  &arcs[10],
-  &arcs[13],
-  &arcs[16],
-  &arcs[17],
-  &arcs[18],
-  &arcs[19],
-  &arcs[20],
-  &arcs[21],
-  &arcs[22],
-  &arcs[26],
+/** column of each letter A-Z in at_names[], 0 for a letter in no name **/
+static const uint8 at_letters[26] = {
+	1, 0, 2, 3, 4, 5, 0, 0, 6, 0, 7, 8, 9, 10, 11, 12, 0, 13, 14, 15, 0, 0, 0, 0, 16, 0
 };
 
-static uint16 matchLiteral(ptr s, ptr e, Task task)
-{ s=s; e=e; task=task; return 0; }
+/** name trie, the next state for each state and letter column, 0 ends the walk. state 0 is
+	the start of every name **/
+static const uint8 at_names[52][16] = {
 
-ptr parseData(ptr s, ptr e, Task task)
+	{  0,  1,  0,  0,  0,  0,  0,  8,  0,  0,  0, 26,  0, 34, 47,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  0,  0,  0,  0 },
+	{ 20,  0,  0,  0,  0,  0,  0,  0,  0,  3,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  5,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  6,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  7,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  9,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 10,  0 },
+	{  0,  0,  0, 11,  0,  0,  0,  0,  0,  0,  0,  0, 15,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0, 12,  0,  0,  0,  0,  0,  0 },
+	{  0, 13,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 14 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 16,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 17,  0,  0 },
+	{  0,  0,  0, 18,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 19,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0, 21,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 22,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 23,  0,  0 },
+	{  0, 24,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 25,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{ 27,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0, 28,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0, 29,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 30,  0 },
+	{  0,  0,  0,  0,  0, 31,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0, 32,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 33,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0, 35,  0,  0,  0,  0, 43,  0 },
+	{  0,  0,  0,  0,  0, 36,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0, 37,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0, 38,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0, 39,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0, 40,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0, 41,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 42,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{ 44,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 45,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 46,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 48,  0,  0,  0 },
+	{ 49,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0, 50,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0, 51,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },
+	{  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 }
+};
+
+/** the command + 1 whose name ends in each state, 0 for none **/
+static const uint8 at_accept[52] = {
+	0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 7, 0, 0, 0, 0, 8
+};
+
+static uint8 upper(uint8 c)
 {
-  ptr p;
-
-#ifdef DISPLAY_AT_CMDS
-  {
-  	ptr c = s;
-    printf("\nreceived: ");
-  	while (c != e)
-  	{
-		if (*c == '\r')			printf("\\r");
-		else if (*c == '\n') 	printf("\\n");
-		else 					putchar(*c);
-
-		c++;
-  	}
-  }
-#endif
+	return 'a' <= c && c <= 'z' ? c + 'A' - 'a' : c;
+}
 
-#ifdef TEST_HARNESS
-  task = task;
-#endif
-  for(; (p = findEndOfPacket(s, e)) != 0; s = p)
-  {
-    if(p == s+1)
-    {
-      /* Silently discard one character; no packets are that short */
-      continue;
-    }
-    else if(matchLiteral(s, p, task))
-    {
-      continue;
-    }
-    else
-    {
-      union {
-        struct connect connect;
-      } u, *uu = &u;
-      int state = 0;
-      ptr t = s;
-      while(t != e && state >= 0)
-      {
-        char m = my_toupper((char) *t);
-        const Arc *a = states[state];
-        const Arc *const last_a = states[state+1];
-#ifndef TEST_HARNESS
-        a = (const Arc *) (void *) UtilFind(0xFFFF, (uint16) m, (const uint16 *) (void *) &a[0].c, 0, sizeof(Arc), (uint16) (last_a - a));
-#endif
-#ifdef TEST_HARNESS
-        while(a != last_a && a->c != m) a++;
-#endif
-        /*lint -e{801} suppress goto is deprecated */
-        if(!a) goto unrecognised;
-        state = a->to;
-        ++t;
-      }
-      switch(-state)
-      {
-        case 1:
-          if(match1(match1(skip1(UtilGetNumber(skip1(skipOnce1(UtilGetNumber(skip1(skipOnce1(UtilGetNumber(skip1(skipOnce1(UtilGetNumber(skip1(skipOnce1(UtilGetNumber(skip1(t, e), e, &uu->connect.baudrate), e), e), e, &uu->connect.stop), e), e), e, &uu->connect.parity), e), e), e, &uu->connect.polarity), e), e), e, &uu->connect.keeptime), e), e), e))
-          {
-#ifndef TEST_HARNESS
-            connect(task, &uu->connect);
-#endif
-#ifdef TEST_HARNESS
-            printf("Called connect");
-            printf(" baudrate=%d", uu->connect.baudrate);
-            printf(" stop=%d", uu->connect.stop);
-            printf(" parity=%d", uu->connect.parity);
-            printf(" polarity=%d", uu->connect.polarity);
-            printf(" keeptime=%d", uu->connect.keeptime);
-            putchar('\n');
-#endif
-            continue;
-          }
-          break;
-        default:
-          break;
-      }
-      /*
-        The message does not contain a recognised AT command or response.
-        Pass the data on to the application to have a go at 
-      */
-unrecognised:
-#ifndef TEST_HARNESS
-      handleUnrecognised(s, (uint16) (p-s), task);
-#endif
-#ifdef TEST_HARNESS
-      printf("Called handleUnrecognised\n");
-#endif
-    }
-  }
+static ptr skipBlank(ptr s, ptr e)
+{
+	while (s != e && (*s == ' ' || *s == '\t'))
+		++s;
+	return s;
+}
+
+static ptr skipLineEnd(ptr s, ptr e)
+{
+	while (s != e && (*s == '\r' || *s == '\n'))
+		++s;
+	return s;
+}
+
+/** decimal uint16, 0 if there is none or it overflows **/
+static ptr getNumber(ptr s, ptr e, uint16 *value)
+{
+	uint32 v = 0;
+	ptr start = s;
+
+	while (s != e && '0' <= *s && *s <= '9')
+	{
+		v = v * 10 + (*s - '0');
+		if (v > 0xFFFF)
+			return 0;
+		++s;
+	}
+	if (s == start)
+		return 0;
+
+	*value = (uint16)v;
+	return s;
+}
+
+/** one line without its terminator, each byte is looked at once **/
+static bool parseLine(ptr s, ptr e, Task task)
+{
+	uint16 arg[AT_MAX_ARGS];
+	const at_command_t *cmd;
+	uint16 state = 0;
+	uint16 i;
+
+	s = skipBlank(s, e);
+	if (e - s < 2 || upper(s[0]) != 'A' || upper(s[1]) != 'T')
+		return FALSE;
+
+	s = skipBlank(s + 2, e);
+	if (s == e || *s != '+')
+		return FALSE;
+
+	/** one table lookup per byte of the name **/
+	s = skipBlank(s + 1, e);
+	while (s != e && 'A' <= upper(*s) && upper(*s) <= 'Z')
+	{
+		uint16 column = at_letters[upper(*s) - 'A'];
 
-  return s;
+		if (!column || !(state = at_names[state][column - 1]))
+			return FALSE;
+		++s;
+	}
+
+	if (!at_accept[state])
+		return FALSE;
+	cmd = &at_commands[at_accept[state] - 1];
+
+	s = skipBlank(s, e);
+	if (cmd->args)
+	{
+		if (s == e || (*s != '=' && *s != ':'))
+			return FALSE;
+		++s;
+
+		for (i = 0; i < cmd->args; ++i)
+		{
+			s = skipBlank(s, e);
+			if (i)
+			{
+				/** a separator between every two arguments **/
+				if (s == e || (*s != ',' && *s != ';'))
+					return FALSE;
+				s = skipBlank(s + 1, e);
+			}
+
+			s = getNumber(s, e, &arg[i]);
+			if (!s)
+				return FALSE;
+		}
+		s = skipBlank(s, e);
+	}
+
+	if (s != e)
+		return FALSE;
+
+	cmd->dispatch(task, arg);
+	return TRUE;
+}
+
+const uint8 *parseData(ptr s, ptr e, Task task)
+{
+	for (;;)
+	{
+		ptr start, end;
+
+		/** blank lines and the leading \r\n of a command **/
+		s = skipLineEnd(skipBlank(s, e), e);
+		if (s == e)
+			return s;
+
+		start = s;
+		while (s != e && *s != '\r' && *s != '\n')
+			++s;
+		if (s == e)
+			return start;	/** no terminator yet **/
+
+		end = s;
+		s = skipLineEnd(s, e);
+
+		if (!parseLine(start, end, task))
+			handleUnrecognised(start, (uint16)(s - start), task);
+	}
+}
+
+uint16 parseLineEnd(ptr s, uint16 from, uint16 size)
+{
+	uint16 end = 0;
+	uint16 i;
+
+	/** from byte 2 on, so the leading \r\n of a command is not taken for its end. a \r at the end
+		of the last call still pairs with a \n at from **/
+	for (i = from < 2 ? 2 : from; i < size; ++i)
+	{
+		if (s[i] == '\n' && s[i - 1] == '\r')
+			end = i + 1;
+	}
+	return end;
 }
 
-/*
-connect
-   Skip " \t"
-   Match "\r\n"
-   Match "\r\n"
-   Skip " \t"
-   MatchChar A
-   MatchChar T
-   Skip " \t"
-   MatchChar +
-   Skip " \t"
-   MatchChar C
-   MatchChar O
-   MatchChar N
-   MatchChar N
-   MatchChar E
-   MatchChar C
-   MatchChar T
-   Skip " \t"
-   Match "=:"
-   Skip " \t"
-   GetNumber baudrate
-   SkipOnce ",;"
-   Skip " \t"
-   GetNumber stop
-   SkipOnce ",;"
-   Skip " \t"
-   GetNumber parity
-   SkipOnce ",;"
-   Skip " \t"
-   GetNumber polarity
-   SkipOnce ",;"
-   Skip " \t"
-   GetNumber keeptime
-   Skip " \t"
-   Match "\r\n"
-   Match "\r\n"
-
-
-*/
+#ifdef __XAP__
+uint16 parseSource(Source rfcDataIn, Task task)
+{
+	ptr s = SourceMap(rfcDataIn);
+	ptr e = s + SourceSize(rfcDataIn);
+	ptr p = parseData(s, e, task);
+	if (p != s)
+	{
+		SourceDrop(rfcDataIn, (uint16)(p - s));
+		return 1;
+	}
+	return 0;
+}
+#endif
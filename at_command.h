@@ -1,30 +1,42 @@
-/*
-    Warning - this file was autogenerated by genparse
-    DO NOT EDIT - any changes will be lost
-*/
-
 #ifndef AT_COMMAND_H
 #define AT_COMMAND_H
 
-#include <message_.h>
+#include <message.h>
 
 #ifdef __XAP__
 #include <source.h>
 #endif
 
+/**************************************
+
+  generated by tools/at_compile.py from at_command.grammar, do not edit.
+
+  AT command dispatcher. a command is one line,
+
+	[\r\n] AT+<NAME>[=|:<n>[,|;<n>...]] \r\n
+
+  with case-insensitive name and decimal uint16 arguments, all of them required. each command has an
+  argument struct below and a handler in at_command_parse.c.
+
+  **************************************/
+
+#define AT_MAX_ARGS		5		/** arguments of the longest command **/
+
+/** handle every complete line in [s, e), returns the start of the first incomplete one **/
 const uint8 *parseData(const uint8 *s, const uint8 *e, Task task);
+
+/** end of the last \r\n terminated line in s[0, size), 0 if there is none. bytes before from were
+	searched by an earlier call, only the new ones are looked at **/
+uint16 parseLineEnd(const uint8 *s, uint16 from, uint16 size);
+
+/** a line that is no known command **/
 void handleUnrecognised(const uint8 *data, uint16 length, Task task);
 
 #ifdef __XAP__
 uint16 parseSource(Source rfcDataIncoming, Task task);
 #endif
 
-struct sequence
-{
-  const uint8 *data;
-  uint16 length;
-};
-
+/** AT+CONNECT=<baudrate>,<stop>,<parity>,<polarity>,<keeptime> **/
 struct connect
 {
   uint16 baudrate;
@@ -35,4 +47,37 @@ struct connect
 };
 void connect(Task , const struct connect *);
 
+/** AT+LATENCY **/
+void latency(Task );
+
+/** AT+LATRESET **/
+void latreset(Task );
+
+/** AT+COALESCE=<coalesce> **/
+struct coalesce
+{
+  uint16 coalesce;
+};
+void coalesce(Task , const struct coalesce *);
+
+/** AT+PACKTIME=<packtime> **/
+struct packtime
+{
+  uint16 packtime;
+};
+void packtime(Task , const struct packtime *);
+
+/** AT+SNIFFIDLE=<sniffidle> **/
+struct sniffidle
+{
+  uint16 sniffidle;
+};
+void sniffidle(Task , const struct sniffidle *);
+
+/** AT+STATS **/
+void stats(Task );
+
+/** AT+TRACE **/
+void trace(Task );
+
 #endif
@@ -5,6 +5,7 @@
 #include <pio.h>
 #include <message.h>
 #include "command_return_code.h"
+#include "uart_timing.h"
 
 #include"spp_dev_private.h"
 #include"hal.h"
@@ -81,6 +82,8 @@ void handleUnrecognised(const uint8 *data, uint16 length, Task task) {
 void connect(Task task, const struct connect * config) {
 	
 	bool success = TRUE;
+	bool approx = FALSE;
+	bool autobaud = FALSE;
 	uint16 baudrate, stop, parity;
 	sppb_task_t* task_data;
 	
@@ -89,8 +92,9 @@ void connect(Task task, const struct connect * config) {
 	/** step 1: check baudrate **/
 	switch(config -> baudrate) {
 		
-		case 48:
-			baudrate = 19;	/** this is a guessed value, test it **/
+		case 0:
+			baudrate = 0;	/** auto-baud, the rate is found later **/
+			autobaud = TRUE;
 			break;
 			
 		case 96:
@@ -113,10 +117,28 @@ void connect(Task task, const struct connect * config) {
 			baudrate = VM_UART_RATE_115K2;
 			break;
 			
+		case 2304:
+			baudrate = VM_UART_RATE_230K4;
+			break;
+			
+		case 4608:
+			baudrate = VM_UART_RATE_460K8;
+			break;
+			
+		case 9216:
+			baudrate = VM_UART_RATE_921K6;
+			break;
+			
+		case 13824:
+			baudrate = VM_UART_RATE_1382K4;
+			break;
+			
 		default:
 			
-			baudrate = 0;
-			success = FALSE;
+			/** non-standard rates use a raw divisor, e.g. 4800 is 20 **/
+			baudrate = uartRateDivisor(config -> baudrate);
+			success = (baudrate != 0);
+			approx = TRUE;
 			break;
 	}
 	
@@ -209,10 +231,91 @@ void connect(Task task, const struct connect * config) {
     }
     
 
-	task_data ->command_result = CMD_RET_OK;
+	task_data ->command_connect = TRUE;
+	task_data ->uart_stop = config ->stop;
+	task_data ->uart_config = *config;
+	
+	if (autobaud) {
+		
+		/** echo state runs the search and replies when it is over **/
+		task_data ->command_result = CMD_RET_AUTOBAUD;
+		return;
+	}
+	
+	task_data ->command_result = approx ? CMD_RET_BAUDRATE_APPROX : CMD_RET_OK;
+	
+	/** keep the line settings in AT+CONNECT encoding for timing calculations **/
+	task_data ->uart_baudrate = config ->baudrate;
+	task_data ->uart_divisor = baudrate;
+	task_data ->uart_bits = uartBitsPerChar(config ->parity, config ->stop);
 	
 	StreamUartConfigure(baudrate, stop, parity);
 }
 
+void coalesce(Task task, const struct coalesce * config) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	
+	/** 0 turns coalescing off **/
+	if (config ->coalesce > SPP_PIPE_COALESCE_MAX) {
+		
+		task_data ->command_result = CMD_RET_UNRECOGNIZED;
+		return;
+	}
+	
+	task_data ->coalesce_timeout = config ->coalesce;
+	task_data ->command_result = CMD_RET_OK;
+}
+
+void packtime(Task task, const struct packtime * config) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	
+	/** 0 selects the adaptive window **/
+	if (config ->packtime > SPP_PIPE_PACK_TIMEOUT * 10) {
+		
+		task_data ->command_result = CMD_RET_UNRECOGNIZED;
+		return;
+	}
+	
+	task_data ->pack_timeout = config ->packtime;
+	task_data ->command_result = CMD_RET_OK;
+}
+
+void sniffidle(Task task, const struct sniffidle * config) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	
+	/** 0 keeps the link active for the whole connection **/
+	task_data ->link.active_idle = config ->sniffidle;
+	task_data ->command_result = CMD_RET_OK;
+}
+
+void stats(Task task) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	task_data ->command_result = CMD_RET_STATS;
+}
+
+void trace(Task task) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	task_data ->command_result = CMD_RET_TRACE;
+}
+
+void latency(Task task) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	task_data ->command_result = CMD_RET_LATENCY;
+}
+
+void latreset(Task task) {
+	
+	sppb_task_t* task_data = (sppb_task_t*)task;
+	
+	latencyHistReset(task_data ->lat, SPPB_LATENCIES);
+	task_data ->command_result = CMD_RET_OK;
+}
+
 
 
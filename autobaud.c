@@ -0,0 +1,205 @@
+#include <csrtypes.h>
+#include <stream.h>
+
+#include "autobaud.h"
+#include "uart_timing.h"
+
+
+/** most likely first **/
+static const struct {
+
+	uint16 baudrate;		/** AT+CONNECT encoding **/
+	uint16 divisor;			/** 0 for a non-standard rate, uartRateDivisor() has it **/
+
+} autobaud_rates[] = {
+
+	{   96, VM_UART_RATE_9K6 },
+	{ 1152, VM_UART_RATE_115K2 },
+	{  192, VM_UART_RATE_19K2 },
+	{  384, VM_UART_RATE_38K4 },
+	{  576, VM_UART_RATE_57K6 },
+	{   48, 0 },
+	{ 2304, VM_UART_RATE_230K4 },
+	{ 4608, VM_UART_RATE_460K8 },
+	{ 9216, VM_UART_RATE_921K6 }
+};
+
+#define AUTOBAUD_CANDIDATES	(sizeof(autobaud_rates) / sizeof(autobaud_rates[0]))
+
+/** AT+CONNECT order **/
+static const uint16 autobaud_vm_parity[] = { VM_UART_PARITY_NONE, VM_UART_PARITY_ODD, VM_UART_PARITY_EVEN };
+
+/** crc-16/modbus, reflected 0xA001, a nibble at a time **/
+static const uint16 autobaud_crc_nibble[16] = {
+
+	0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+	0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+
+
+static uint16 autobaudRateDivisor(uint16 candidate) {
+
+	uint16 divisor = autobaud_rates[candidate].divisor;
+
+	return divisor ? divisor : uartRateDivisor(autobaud_rates[candidate].baudrate);
+}
+
+static void autobaudClear(autobaud_t* a) {
+
+	a ->bytes = 0;
+	a ->good = 0;
+	a ->noise = 0;
+
+	a ->since = 0;
+	a ->frame_last = 0;
+	a ->frame_chained = FALSE;
+	a ->frame_bytes = 0;
+}
+
+void autobaudStart(autobaud_t* a, uint16 parity) {
+
+	a ->candidate = 0;
+	a ->parity = parity;
+	a ->best = 0;
+	a ->best_score = -1;
+
+	autobaudClear(a);
+}
+
+static uint16 autobaudCrc(uint16 crc, uint8 c) {
+
+	crc = (crc >> 4) ^ autobaud_crc_nibble[(crc ^ c) & 0x0F];
+
+	return (crc >> 4) ^ autobaud_crc_nibble[(crc ^ (c >> 4)) & 0x0F];
+}
+
+/** run the crc of every frame start behind the boundary, a frame whose crc checks moves the boundary
+	behind it. a frame starting right at the boundary left by another one is chained, both count **/
+static void autobaudFrameFeed(autobaud_t* a, uint8 c) {
+
+	uint16 starts = a ->since < AUTOBAUD_FRAME_STARTS ? a ->since + 1 : AUTOBAUD_FRAME_STARTS;
+	uint16 s;
+
+	if (a ->since < AUTOBAUD_FRAME_STARTS) {
+
+		a ->crc[a ->since] = 0xFFFF;
+	}
+
+	for (s = 0; s < starts; s++) {
+
+		uint16 len = a ->since - s + 1;
+
+		a ->crc[s] = autobaudCrc(a ->crc[s], c);
+
+		if (a ->crc[s] == 0 && len >= AUTOBAUD_FRAME_MIN) {
+
+			if (s == 0 && a ->frame_last) {
+
+				a ->frame_bytes += (a ->frame_chained ? 0 : a ->frame_last) + len;
+				a ->frame_chained = TRUE;
+			}
+			else {
+
+				a ->frame_chained = FALSE;
+			}
+
+			a ->frame_last = len;
+			a ->since = 0;
+			return;
+		}
+	}
+
+	if (++a ->since >= AUTOBAUD_FRAME_MAX) {
+
+		a ->since = 0;
+		a ->frame_last = 0;
+		a ->frame_chained = FALSE;
+	}
+}
+
+void autobaudFeed(autobaud_t* a, const uint8* buf, uint16 len) {
+
+	uint16 i;
+
+	for (i = 0; i < len && a ->bytes < AUTOBAUD_MAX_BYTES; i++) {
+
+		uint8 c = buf[i];
+
+		if ((c >= 0x20 && c < 0x7F) || c == '\r' || c == '\n' || c == '\t') {
+
+			a ->good++;
+		}
+		else if (c == 0x00 || c == 0xFF || (c & 0x80)) {
+
+			a ->noise++;
+		}
+
+		autobaudFrameFeed(a, c);
+		a ->bytes++;
+	}
+}
+
+int16 autobaudScore(const autobaud_t* a) {
+
+	int16 text;
+	int16 frames;
+
+	if (a ->bytes < AUTOBAUD_MIN_BYTES) {
+
+		return -1;
+	}
+
+	text = (int16)(((int32)a ->good * 100 - (int32)a ->noise * 200) / (int32)a ->bytes);
+	frames = (int16)((uint32)a ->frame_bytes * 100 / a ->bytes);
+
+	return text > frames ? text : frames;
+}
+
+bool autobaudNext(autobaud_t* a) {
+
+	int16 score = autobaudScore(a);
+
+	if (score > a ->best_score) {
+
+		a ->best = a ->candidate;
+		a ->best_score = score;
+	}
+
+	autobaudClear(a);
+
+	if (score >= AUTOBAUD_LOCK_SCORE || a ->candidate + 1 >= AUTOBAUD_CANDIDATES) {
+
+		/** finished, the best one becomes current for autobaudConfigure() **/
+		a ->candidate = a ->best;
+		return FALSE;
+	}
+
+	a ->candidate++;
+
+	return TRUE;
+}
+
+bool autobaudLocked(const autobaud_t* a) {
+
+	return a ->best_score >= AUTOBAUD_MIN_SCORE;
+}
+
+void autobaudConfigure(const autobaud_t* a, uint16 stop) {
+
+	StreamUartConfigure(autobaudRateDivisor(a ->candidate), stop, autobaud_vm_parity[a ->parity]);
+}
+
+uint16 autobaudBaudrate(const autobaud_t* a) {
+
+	return autobaud_rates[a ->best].baudrate;
+}
+
+uint16 autobaudParity(const autobaud_t* a) {
+
+	return a ->parity;
+}
+
+uint16 autobaudDivisor(const autobaud_t* a) {
+
+	return autobaudRateDivisor(a ->best);
+}
@@ -0,0 +1,93 @@
+#ifndef AUTOBAUD_H
+#define AUTOBAUD_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  uart auto-baud, AT+CONNECT with baudrate 0. the uart is configured with one candidate rate after
+  the other and whatever the controller sends meanwhile is scored.
+
+  a wrong rate turns text into bytes with the high bit set, 0x00 and 0xFF (breaks and framing garbage),
+  a right one gives printable text and line ends. the text score is the per cent of good bytes minus
+  twice the per cent of noise bytes. binary traffic never scores as text, so bytes are also checked
+  for modbus rtu frames, a crc-16 valid frame directly followed by another one. the protocol score is
+  the per cent of bytes in such frames, a wrong rate practically never produces two in a row. the
+  better of the two scores counts, a candidate needs AUTOBAUD_MIN_BYTES to be scored at all.
+
+  every byte runs up to AUTOBAUD_FRAME_STARTS crcs, at 921600 baud a dwell would bring 36k bytes. only
+  the first AUTOBAUD_MAX_BYTES are scored, the candidate is done once it has them.
+
+  parity is not searched. a wrong parity only changes the ninth bit, the vm drops the characters it
+  fails on without telling, so no score can tell it apart and it would triple the search. stop bits
+  can't be told apart either, a second stop bit is just idle line. both settings of the command are
+  kept.
+
+  **************************************/
+
+#define AUTOBAUD_DWELL			400		/** ms listening to each candidate **/
+#define AUTOBAUD_MIN_BYTES		8		/** fewer bytes than this don't score **/
+#define AUTOBAUD_MAX_BYTES		512		/** bytes scored per candidate, bounds the crc work at high rates **/
+#define AUTOBAUD_MIN_SCORE		50		/** best score must reach this to lock **/
+#define AUTOBAUD_LOCK_SCORE		95		/** lock at once, no need to try the rest **/
+
+#define AUTOBAUD_FRAME_STARTS	16		/** modbus frame starts tried behind a frame boundary **/
+#define AUTOBAUD_FRAME_MIN		4		/** address, function, crc **/
+#define AUTOBAUD_FRAME_MAX		256		/** modbus rtu adu, no boundary for this long starts over **/
+
+typedef struct {
+
+	uint16	candidate;		/** index being listened to **/
+	uint16	parity;			/** AT+CONNECT encoding, kept **/
+
+	/** current candidate **/
+	uint16	bytes;
+	uint16	good;
+	uint16	noise;
+
+	/** modbus rtu frames of the current candidate, a running crc for each start behind the last boundary **/
+	uint16	crc[AUTOBAUD_FRAME_STARTS];
+	uint16	since;			/** bytes since the boundary **/
+	uint16	frame_last;		/** length of the frame ending at the boundary, 0 if none **/
+	bool	frame_chained;	/** it was counted, it followed another frame **/
+	uint16	frame_bytes;	/** bytes in frames that follow or are followed by another frame **/
+
+	/** best so far **/
+	uint16	best;
+	int16	best_score;
+
+} autobaud_t;
+
+/** start with the first candidate and the parity of the command in AT+CONNECT encoding, the caller
+	configures the uart with autobaudConfigure() **/
+void autobaudStart(autobaud_t* a, uint16 parity);
+
+/** score bytes received with the current candidate **/
+void autobaudFeed(autobaud_t* a, const uint8* buf, uint16 len);
+
+/** done with the current candidate, TRUE if there is another one to try. FALSE when all were tried
+	or the current one is good enough to lock, the best candidate is current then **/
+bool autobaudNext(autobaud_t* a);
+
+/** the current candidate has all the bytes it scores, no need to wait for the rest of its dwell **/
+#define autobaudFull(a)				((a)->bytes >= AUTOBAUD_MAX_BYTES)
+
+/** score of the current candidate, -1 if it didn't get enough bytes **/
+int16 autobaudScore(const autobaud_t* a);
+
+/** TRUE if the best candidate is good enough **/
+bool autobaudLocked(const autobaud_t* a);
+
+/** StreamUartConfigure() with the current candidate, the kept parity and the given vm stop setting **/
+void autobaudConfigure(const autobaud_t* a, uint16 stop);
+
+/** the best candidate in AT+CONNECT encoding, the parity is the one autobaudStart() was given **/
+uint16 autobaudBaudrate(const autobaud_t* a);
+uint16 autobaudParity(const autobaud_t* a);
+
+/** raw rate given to StreamUartConfigure() for the best candidate **/
+uint16 autobaudDivisor(const autobaud_t* a);
+
+#define autobaudBestScore(a)		((a)->best_score)
+
+#endif /** AUTOBAUD_H **/
@@ -1,5 +1,4 @@
 #include <csrtypes.h>
-#include <stdlib.h>
 #include <message.h>
 #include "battery_probe.h"
 #include "battery_probe_private.h"
@@ -107,7 +106,6 @@ static void adc_result_handler(vm_adc_source_type source, uint8 reading) {
 		
 		/** to avoid integer overflow **/
 		unsigned long src, vref;
-		uint32* mV;
 		
 		src = battery_probe.source_reading;
 		vref = battery_probe.vref_reading;
@@ -116,10 +114,10 @@ static void adc_result_handler(vm_adc_source_type source, uint8 reading) {
 			return;
 		}
 		
-		mV = (uint32*)malloc(sizeof(uint32));
-		*mV = 1250UL * src / vref;
+		/** kept here, the message carries no payload so nothing is allocated per reading **/
+		battery_probe.voltage = 1250UL * src / vref;
 		
-		MessageSend(battery_probe.client, BATTERY_PROBING_MESSAGE, mV);
+		MessageSend(battery_probe.client, BATTERY_PROBING_MESSAGE, 0);
 	}
 }
 
@@ -140,10 +138,17 @@ void battery_probe_start(Task task, vm_adc_source_type source, uint16 tick_inter
 	battery_probe.tick_interval = tick_interval;
 	battery_probe.vref_reading = 255;
 	battery_probe.source_reading = 255;
+	battery_probe.voltage = 0;
 	
 	tick_handler();
 }
 
+/** latest reading **/
+uint32 battery_probe_voltage(void) {
+	
+	return battery_probe.voltage;
+}
+
 /** stop the probe **/
 void battery_probe_stop(void) {
 	
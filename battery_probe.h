@@ -22,6 +22,9 @@ enum {
 /** start the probe **/
 void battery_probe_start(Task task, vm_adc_source_type source, uint16 tick_interval);
 
+/** mV of the latest reading, BATTERY_PROBING_MESSAGE has no payload **/
+uint32 battery_probe_voltage(void);
+
 /** stop the probe **/
 void battery_probe_stop(void);
 
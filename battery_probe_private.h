@@ -10,6 +10,7 @@ typedef struct {
 	uint16 tick_interval;
 	uint8 vref_reading;
 	uint8 source_reading;
+	uint32 voltage;				/** mV of the last BATTERY_PROBING_MESSAGE **/
 	
 } battery_probe_task_t;
 
@@ -14,12 +14,24 @@ typedef enum {
 	CMD_RET_UNSUPPORTED_BAUDRATE,
 	CMD_RET_UNSUPPORTED_STOP,
 	CMD_RET_UNSUPPORTED_PARITY,
-    CMD_RET_UNSUPPORTED_P0LARITY
+    CMD_RET_UNSUPPORTED_P0LARITY,
+    CMD_RET_LATENCY,					/** OK with latency report **/
+    CMD_RET_BAUDRATE_APPROX,			/** OK, non-standard rate reported with its actual baud and error **/
+    CMD_RET_AUTOBAUD,					/** AT+CONNECT with baudrate 0, replied when the search is over **/
+    CMD_RET_AUTOBAUD_LOCKED,			/** OK with the detected settings **/
+    CMD_RET_AUTOBAUD_FAILED,
+    CMD_RET_STATS,						/** OK with counter report **/
+    CMD_RET_TRACE						/** OK after the trace dump **/
     
     
 
 } at_command_return_code_t;
 
+/** results that are replied with OK **/
+#define CMD_RET_IS_OK(code)	((code) == CMD_RET_OK || (code) == CMD_RET_LATENCY || (code) == CMD_RET_BAUDRATE_APPROX || \
+							 (code) == CMD_RET_AUTOBAUD_LOCKED || (code) == CMD_RET_STATS || \
+							 (code) == CMD_RET_TRACE)
+
 
 #endif /** COMMAND_RETURN_CODE_H **/
 
@@ -0,0 +1,143 @@
+#include <csrtypes.h>
+#include <message.h>
+#include <panic.h>
+#include <vm.h>
+
+#include "deadline.h"
+
+#define deadlineBefore(a, b)	((int32)((a) - (b)) < 0)
+
+static void deadlineTimer(deadline_service_t* d, uint32 due, uint32 now) {
+
+	(void)MessageCancelAll(d ->task, d ->tick);
+	MessageSendLater(d ->task, d ->tick, 0, deadlineBefore(now, due) ? due - now : 0);
+
+	d ->ticking = TRUE;
+	d ->timer_due = due;
+}
+
+void deadlineInit(deadline_service_t* d, Task task, MessageId tick) {
+
+	uint16 i;
+
+	d ->task = task;
+	d ->tick = tick;
+	d ->ticking = FALSE;
+	d ->timer_due = 0;
+
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		d ->slot[i].armed = FALSE;
+	}
+}
+
+void deadlineSet(deadline_service_t* d, MessageId id, uint32 ms) {
+
+	uint32 now = VmGetClock();
+	deadline_t* free = 0;
+	deadline_t* s = 0;
+	uint16 i;
+
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		if (d ->slot[i].armed && d ->slot[i].id == id) {
+
+			s = &d ->slot[i];
+			break;
+		}
+
+		if (!d ->slot[i].armed && free == 0) {
+
+			free = &d ->slot[i];
+		}
+	}
+
+	if (s == 0) {
+
+		if (free == 0) {
+
+			/** DEADLINE_SLOTS is too small **/
+			Panic();
+		}
+
+		s = free;
+		s ->id = id;
+		s ->armed = TRUE;
+	}
+
+	s ->due = now + ms;
+
+	/** a later deadline is picked up by the tick already queued **/
+	if (!d ->ticking || deadlineBefore(s ->due, d ->timer_due)) {
+
+		deadlineTimer(d, s ->due, now);
+	}
+}
+
+void deadlineCancel(deadline_service_t* d, MessageId id) {
+
+	uint16 i;
+
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		if (d ->slot[i].armed && d ->slot[i].id == id) {
+
+			/** the queued tick finds nothing and stops **/
+			d ->slot[i].armed = FALSE;
+		}
+	}
+}
+
+bool deadlineArmed(const deadline_service_t* d, MessageId id) {
+
+	uint16 i;
+
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		if (d ->slot[i].armed && d ->slot[i].id == id) {
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+void deadlineTick(deadline_service_t* d) {
+
+	uint32 now = VmGetClock();
+	uint32 next = 0;
+	bool pending = FALSE;
+	uint16 i;
+
+	d ->ticking = FALSE;
+
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		deadline_t* s = &d ->slot[i];
+
+		if (s ->armed && !deadlineBefore(now, s ->due)) {
+
+			/** disarmed first, the handler may set it again **/
+			s ->armed = FALSE;
+			d ->task ->handler(d ->task, s ->id, 0);
+		}
+	}
+
+	/** handlers may have set deadlines and the timer meanwhile, look again **/
+	for (i = 0; i < DEADLINE_SLOTS; i++) {
+
+		deadline_t* s = &d ->slot[i];
+
+		if (s ->armed && (!pending || deadlineBefore(s ->due, next))) {
+
+			next = s ->due;
+			pending = TRUE;
+		}
+	}
+
+	if (pending && (!d ->ticking || deadlineBefore(next, d ->timer_due))) {
+
+		deadlineTimer(d, next, VmGetClock());
+	}
+}
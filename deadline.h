@@ -0,0 +1,53 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <csrtypes.h>
+#include <message.h>
+
+/**************************************
+
+  deadline service, many logical timeouts of one task on a single vm timer message.
+
+  a deadline is named by the message id it delivers. setting it again moves it, later or earlier,
+  without touching the message queue unless it becomes the earliest one, so a timeout that is pushed
+  back on every received byte costs a store and a compare. when the timer message arrives the task
+  passes it to deadlineTick(), which calls the task handler directly for every expired deadline (no
+  queued message, so a deadline moved after it expired can never deliver a stale one) and re-arms the
+  timer for the earliest deadline left.
+
+  **************************************/
+
+#define DEADLINE_SLOTS		6		/** deadlines armed at the same time per task **/
+
+typedef struct {
+
+	MessageId	id;
+	uint32		due;
+	bool		armed;
+
+} deadline_t;
+
+typedef struct {
+
+	Task		task;
+	MessageId	tick;				/** the timer message id of this task **/
+	bool		ticking;			/** tick is queued for timer_due **/
+	uint32		timer_due;
+
+	deadline_t	slot[DEADLINE_SLOTS];
+
+} deadline_service_t;
+
+void deadlineInit(deadline_service_t* d, Task task, MessageId tick);
+
+/** deliver id to the task in ms from now, moves it if it is already armed **/
+void deadlineSet(deadline_service_t* d, MessageId id, uint32 ms);
+
+void deadlineCancel(deadline_service_t* d, MessageId id);
+
+bool deadlineArmed(const deadline_service_t* d, MessageId id);
+
+/** the tick message arrived **/
+void deadlineTick(deadline_service_t* d);
+
+#endif /** DEADLINE_H **/
@@ -0,0 +1,41 @@
+#include <csrtypes.h>
+
+#include "echo_text.h"
+
+
+char* echoTextString(char* p, const char* s) {
+
+	while (*s) {
+
+		*p++ = *s++;
+	}
+
+	return p;
+}
+
+char* echoTextUint(char* p, uint32 value) {
+
+	char digits[10];
+	uint16 n = 0;
+
+	do {
+
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+
+	} while (value);
+
+	while (n) {
+
+		*p++ = digits[--n];
+	}
+
+	return p;
+}
+
+char* echoTextEnd(char* p) {
+
+	*p = 0;
+
+	return p;
+}
@@ -0,0 +1,18 @@
+#ifndef ECHO_TEXT_H
+#define ECHO_TEXT_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  small helpers to build variable echo responses (reports) in a char buffer, no printf on the vm.
+  each function writes at p and returns the new end, the buffer is not zero-terminated until
+  echoTextEnd() is called.
+
+  **************************************/
+
+char* echoTextString(char* p, const char* s);
+char* echoTextUint(char* p, uint32 value);
+char* echoTextEnd(char* p);
+
+#endif /** ECHO_TEXT_H **/
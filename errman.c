@@ -7,6 +7,7 @@
 #include "spp_dev_b_leds.h"
 
 #include "errman.h"
+#include "stats.h"
 
 
 void DoErrorCheck( bool flag )
@@ -85,6 +86,8 @@ void busy_beep(uint16 times) {
 
 void raise_exception(uint16 m, uint16 n) {
 	
+	statInc(STAT_EXCEPTIONS);
+	
 	busy_beep(m);
 	busy_beep(n);
 	
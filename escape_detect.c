@@ -0,0 +1,60 @@
+#include <csrtypes.h>
+
+#include "escape_detect.h"
+
+
+void escapeDetectInit(escape_detect_t* d, uint8 escape_char, uint16 escape_count, uint16 guard) {
+
+	d ->escape_char = escape_char;
+	d ->escape_count = escape_count;
+	d ->guard = guard;
+
+	escapeDetectReset(d, 0);
+}
+
+void escapeDetectReset(escape_detect_t* d, uint32 now) {
+
+	d ->seen = 0;
+	d ->last_arrival = now;
+}
+
+bool escapeDetectFeed(escape_detect_t* d, const uint8* buf, uint16 len, uint32 now) {
+
+	uint32 gap = now - d ->last_arrival;
+	uint16 i;
+
+	d ->last_arrival = now;
+
+	if (gap >= d ->guard) {
+
+		/** silence before, a new sequence may start here **/
+		d ->seen = 0;
+	}
+	else if (d ->seen == 0) {
+
+		/** payload, don't even look at it **/
+		return FALSE;
+	}
+
+	for (i = 0; i < len; i++) {
+
+		if (buf[i] != d ->escape_char || d ->seen == d ->escape_count) {
+
+			d ->seen = 0;
+			return FALSE;
+		}
+
+		d ->seen++;
+	}
+
+	return d ->seen != 0;
+}
+
+bool escapeDetectExpired(escape_detect_t* d) {
+
+	bool complete = (d ->seen == d ->escape_count);
+
+	d ->seen = 0;
+
+	return complete;
+}
@@ -0,0 +1,51 @@
+#ifndef ESCAPE_DETECT_H
+#define ESCAPE_DETECT_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  hayes style escape detector for the pipe, e.g. "+++" with a guard time of silence before and after.
+  the line must be silent for the guard time, then exactly count escape chars must arrive with less
+  than the guard time between them, then the line must be silent for the guard time again.
+
+  bytes are fed as they arrive, each byte is looked at once. a chunk arriving less than the guard time
+  after the previous one while no sequence is in progress is not looked at all, so binary payload
+  costs nothing and can never be taken for an escape unless it really is the sequence framed by
+  silence.
+
+  **************************************/
+
+#define ESCAPE_DEFAULT_CHAR		'+'
+#define ESCAPE_DEFAULT_COUNT	3
+#define ESCAPE_DEFAULT_GUARD	1000	/** ms **/
+
+typedef struct {
+
+	/** configuration **/
+	uint8	escape_char;
+	uint16	escape_count;
+	uint16	guard;
+
+	/** escape chars of the sequence in progress, 0 if none **/
+	uint16	seen;
+	uint32	last_arrival;
+
+} escape_detect_t;
+
+void escapeDetectInit(escape_detect_t* d, uint8 escape_char, uint16 escape_count, uint16 guard);
+
+/** forget any sequence in progress, the line counts as busy at now **/
+void escapeDetectReset(escape_detect_t* d, uint32 now);
+
+/** feed len bytes that arrived at now. TRUE if they may still be the escape sequence, the caller
+	holds them and runs the guard timer **/
+bool escapeDetectFeed(escape_detect_t* d, const uint8* buf, uint16 len, uint32 now);
+
+/** the guard timer expired without new bytes. TRUE if the full sequence was seen, either way the
+	sequence in progress is over **/
+bool escapeDetectExpired(escape_detect_t* d);
+
+#define escapeDetectGuard(d)		((d)->guard)
+
+#endif /** ESCAPE_DETECT_H **/
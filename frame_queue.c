@@ -0,0 +1,74 @@
+#include <csrtypes.h>
+
+#include "frame_queue.h"
+
+
+void frameQueueInit(frame_queue_t* q) {
+
+	frameQueueReset(q);
+}
+
+void frameQueueReset(frame_queue_t* q) {
+
+	q ->first = 0;
+	q ->count = 0;
+	q ->bytes = 0;
+}
+
+bool frameQueuePush(frame_queue_t* q, uint16 length, uint32 arrival) {
+
+	if (length == 0) {
+
+		return TRUE;
+	}
+
+	q ->bytes += length;
+
+	if (q ->count == FRAME_QUEUE_DEPTH) {
+
+		/** no descriptor left, the bytes are already in the source so just extend the newest frame **/
+		q ->desc[(q ->first + q ->count - 1) % FRAME_QUEUE_DEPTH].length += length;
+
+		return FALSE;
+	}
+
+	q ->desc[(q ->first + q ->count) % FRAME_QUEUE_DEPTH].length = length;
+	q ->desc[(q ->first + q ->count) % FRAME_QUEUE_DEPTH].arrival = arrival;
+	q ->count++;
+
+	return TRUE;
+}
+
+const frame_desc_t* frameQueueFront(const frame_queue_t* q) {
+
+	if (q ->count == 0) {
+
+		return 0;
+	}
+
+	return &q ->desc[q ->first];
+}
+
+void frameQueueConsume(frame_queue_t* q, uint16 length) {
+
+	frame_desc_t* d;
+
+	if (q ->count == 0) {
+
+		return;
+	}
+
+	d = &q ->desc[q ->first];
+
+	if (length >= d ->length) {
+
+		q ->bytes -= d ->length;
+		q ->first = (q ->first + 1) % FRAME_QUEUE_DEPTH;
+		q ->count--;
+	}
+	else {
+
+		q ->bytes -= length;
+		d ->length -= length;
+	}
+}
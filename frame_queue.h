@@ -0,0 +1,58 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  bounded multi-frame queue used by the spp -> uart pipe. the frame bytes are never copied, they stay
+  in the spp source until they are StreamMove()d to the uart sink, so the queue only keeps frame
+  boundaries. the oldest frame always starts at the head of the source.
+
+  when the descriptor table is full a new frame is merged into the newest one instead of being dropped,
+  nothing is lost, the merged frames just go out under one direction-control window. the amount of
+  data held is bounded by the spp source itself, rfcomm flow control stops the peer when it is full.
+
+  **************************************/
+
+#define FRAME_QUEUE_DEPTH		8		/** max number of separately sent frames waiting for uart **/
+
+typedef struct {
+
+	uint16 length;			/** bytes of this frame still held in the source **/
+	uint32 arrival;			/** vm clock of its first byte, a merged frame keeps the older one **/
+
+} frame_desc_t;
+
+typedef struct {
+
+	/** descriptor ring **/
+	frame_desc_t	desc[FRAME_QUEUE_DEPTH];
+	uint16			first;
+	uint16			count;
+
+	/** total bytes held in the source for all queued frames **/
+	uint16			bytes;
+
+} frame_queue_t;
+
+/** start empty **/
+void frameQueueInit(frame_queue_t* q);
+
+/** forget all queued frames, the caller drops the bytes from the source **/
+void frameQueueReset(frame_queue_t* q);
+
+/** append a frame of length bytes whose first byte arrived at arrival, returns FALSE if it had to be
+	merged into the newest one **/
+bool frameQueuePush(frame_queue_t* q, uint16 length, uint32 arrival);
+
+/** oldest frame, or 0 if empty **/
+const frame_desc_t* frameQueueFront(const frame_queue_t* q);
+
+/** account for length bytes of the oldest frame having left the source, pops it when complete **/
+void frameQueueConsume(frame_queue_t* q, uint16 length);
+
+#define frameQueueIsEmpty(q)		((q)->count == 0)
+#define frameQueueBytes(q)			((q)->bytes)
+
+#endif /** FRAME_QUEUE_H **/
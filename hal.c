@@ -78,6 +78,13 @@ Task getHalTask() {
 /** hal task handler **/
 void hal_handler(Task task, MessageId id, Message message) {
 	
+	if (id == HAL_DEADLINE_TICK) {
+		
+		/** expired deadlines come back through this handler **/
+		deadlineTick(&hal.deadlines);
+		return;
+	}
+	
 	switch (hal.state) {
 		
 		case INITIALISING:
@@ -116,7 +123,7 @@ void initialising_state_enter(void) {
 
 	disableLDO();
 	
-	update_indication();
+	indicationBattery();
 }
 
 void initialising_state_exit(void) {
@@ -138,7 +145,7 @@ void initialising_handler(Task task, MessageId id, Message message) {
 			
 				/** update charging state, and no check, even battery low we have nothing to do **/
 				pio_raw_handler(message);
-				update_indication();
+				indicationBattery();
 			}
 			break;
 	 case POWER_BUTTON_PRESS:
@@ -148,17 +155,17 @@ void initialising_handler(Task task, MessageId id, Message message) {
             PioSetDir(1<<5, 0);
             pio5hold = (PioGet()>>5)&0x1;
       */    
-			MessageSendLater(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT, 0, 2000);
+			deadlineSet(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT, 2000);
         /*    if(1==pio5hold)*/
-			    MessageSendLater(getHalTask(), HAL_POWER_BUTTON_HELD_LONG, 0, 10000);
+			    deadlineSet(&hal.deadlines, HAL_POWER_BUTTON_HELD_LONG, 10000);
 			break;
 			
 	case POWER_BUTTON_RELEASE:
 			
 			DEBUG(("hal active state, POWER_BUTTON_RELEASE message arrived...\n"));
 			
-			MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT);
-			MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_LONG);
+			deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT);
+			deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_LONG);
 			break;
             
 	case HAL_POWER_BUTTON_HELD_SHORT:
@@ -168,7 +175,7 @@ void initialising_handler(Task task, MessageId id, Message message) {
              /*      
                  pio5hold = (PioGet()>>5)&0x1;
                 if(pio5hold!=1)
-                    MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_LONG);
+                    deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_LONG);
        */
 				initialising_state_exit();
 			
@@ -193,15 +200,14 @@ void initialising_handler(Task task, MessageId id, Message message) {
 				}
 				battery_message_handler(message);
 				
-				update_indication();
+				indicationBattery();
 			}
 			break;	
 			
-		case APP_EXT_STATE_CHANGE_MESSAGE:
-			{
-				app_ext_state_change_message_t* msg = (app_ext_state_change_message_t*)message;
-				hal.app_state = msg ->state;
-			}
+		case APP_EXT_STATE_IDLE_MESSAGE:
+		case APP_EXT_STATE_WORKING_MESSAGE:
+			
+			hal.app_state = appExtStateOf(id);
 			break;
 	}
 }
@@ -210,10 +216,10 @@ void activating_state_enter(void) {
 	
 	DEBUG(("hal activating state enter...\n"));
 	
-	ledsPlay(ALL_LEDS_OFF);
-	ledsPlay(BEEP_TWICE);
+	indicationBattery();
+	indicationBeep(BEEP_TWICE);
 	
-	MessageSendLater(getHalTask(), HAL_ACTIVATING_TIMEOUT, 0, BEEP_TWICE_DURATION + 100);
+	deadlineSet(&hal.deadlines, HAL_ACTIVATING_TIMEOUT, BEEP_TWICE_DURATION + 100);
 }
 
 void activating_state_exit(void) {
@@ -230,7 +236,7 @@ void activating_handler(Task task, MessageId id, Message message) {
 			DEBUG(("hal activating state, PIO_RAW message arrived...\n"));
 			pio_raw_handler(message);
 			
-			if (!powerAllowedToTurnOn) {
+			if (!powerAllowedToTurnOn()) {
 				
 				/*****
 				  
@@ -254,15 +260,15 @@ void activating_handler(Task task, MessageId id, Message message) {
 			
 			DEBUG(("hal active state, POWER_BUTTON_PRESS message arrived...\n"));
             
-			MessageSendLater(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT, 0, 2000);
+			deadlineSet(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT, 2000);
 			break;
 
 			
 	case POWER_BUTTON_RELEASE:
 			
 			DEBUG(("hal active state, POWER_BUTTON_RELEASE message arrived...\n"));
-            MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_LONG);			
-			MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT);
+            deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_LONG);			
+			deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT);
 			break;
 			
 	case HAL_POWER_BUTTON_HELD_SHORT:
@@ -310,7 +316,7 @@ void active_state_enter(void) {
 	
 	MessageSend(hal.profile_task, HAL_MESSAGE_SWITCHING_ON, 0);
 	
-	update_indication();
+	indicationBattery();
 }
 
 void active_state_exit(void) {
@@ -336,7 +342,7 @@ void active_handler(Task task, MessageId id, Message message) {
 			}
 			else {
 				
-				update_indication();
+				indicationBattery();
 			}
 			
 			break;
@@ -345,7 +351,7 @@ void active_handler(Task task, MessageId id, Message message) {
 			
 			DEBUG(("hal active state, POWER_BUTTON_PRESS message arrived...\n"));
             
-			MessageSendLater(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT, 0, 2000);
+			deadlineSet(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT, 2000);
 			break;
 
 			
@@ -353,8 +359,8 @@ void active_handler(Task task, MessageId id, Message message) {
 			
 			DEBUG(("hal active state, POWER_BUTTON_RELEASE message arrived...\n"));
 			
-			MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT);
-            MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_LONG);
+			deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT);
+            deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_LONG);
 			break;
 		
 	case HAL_POWER_BUTTON_HELD_SHORT:
@@ -392,14 +398,14 @@ void active_handler(Task task, MessageId id, Message message) {
 				deactivating_state_enter();
 			}
 			else {
-				update_indication();
+				indicationBattery();
 			}
 			break;	
 			
-		case APP_EXT_STATE_CHANGE_MESSAGE:
+		case APP_EXT_STATE_IDLE_MESSAGE:
+		case APP_EXT_STATE_WORKING_MESSAGE:
 			{
-				app_ext_state_change_message_t* msg = (app_ext_state_change_message_t*)message;
-				hal.app_state = msg ->state;
+				hal.app_state = appExtStateOf(id);
 				
 				if (hal.app_state == APP_EXT_STATE_IDLE) {
 					
@@ -416,10 +422,10 @@ void deactivating_state_enter(void) {
 	
 	DEBUG(("hal deactivating state enter...\n"));
 	
-	ledsPlay(ALL_LEDS_OFF);
-	ledsPlay(BEEP_TWICE);
+	indicationBattery();
+	indicationBeep(BEEP_TWICE);
 	
-	MessageSendLater(getHalTask(), HAL_DEACTIVATING_TIMEOUT, 0, BEEP_TWICE_DURATION + 100);
+	deadlineSet(&hal.deadlines, HAL_DEACTIVATING_TIMEOUT, BEEP_TWICE_DURATION + 100);
 	
 	/** send message to profile **/
 	MessageSend(hal.profile_task, HAL_MESSAGE_SWITCHING_OFF, 0);
@@ -447,7 +453,7 @@ void deactivating_handler(Task task, MessageId id, Message message) {
 			
 			DEBUG(("hal active state, POWER_BUTTON_PRESS message arrived...\n"));
             
-			MessageSendLater(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT, 0, 2000);
+			deadlineSet(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT, 2000);
 			break;
 
 			
@@ -455,7 +461,7 @@ void deactivating_handler(Task task, MessageId id, Message message) {
 			
 			DEBUG(("hal active state, POWER_BUTTON_RELEASE message arrived...\n"));
 			
-			MessageCancelAll(getHalTask(), HAL_POWER_BUTTON_HELD_SHORT);
+			deadlineCancel(&hal.deadlines, HAL_POWER_BUTTON_HELD_SHORT);
 			break;
 			
 	case HAL_POWER_BUTTON_HELD_SHORT:
@@ -493,6 +499,7 @@ void hal_init(Task profileTask) {
 	
 	/** set task hander **/
 	hal.task.handler = hal_handler;
+	deadlineInit(&hal.deadlines, getHalTask(), HAL_DEADLINE_TICK);
 	
 	/** set profile task **/
 	hal.profile_task = profileTask;
@@ -512,6 +519,7 @@ void hal_init(Task profileTask) {
 
    state = PsStore (2, psBuff, 2);
     DEBUG(("PsStore return state %d \n", state));
+    state = state;		/** only DEBUG reads it **/
     
     PsRetrieve (2, read, 2); 
     
@@ -554,6 +562,12 @@ void ResetUartTX()
     PioSetDir(PIO3, PIO3);
     PioSet(PIO3, 0);
 }
+
+/** stop driving, the weak pull returns the transceiver to receive **/
+void ReleaseUartTX()
+{
+    PioSetDir(PIO3, 0);
+}
  
 
 /** this function may need further refine **/
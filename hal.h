@@ -54,6 +54,7 @@ void hal_init(Task profileTask);
 Task getHalTask(void);
 void SetUartTX(void);
 void ResetUartTX(void);
+void ReleaseUartTX(void);
 
 #endif /* HAL_H */
 
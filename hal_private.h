@@ -5,6 +5,7 @@
 #include <battery.h>
 #include "spp_dev_b_buttons.h"
 #include "app_state.h"
+#include "deadline.h"
 
 
 #define PIO_CHARGE_DETECTION (1UL << 10)
@@ -16,7 +17,8 @@ enum {
 	HAL_ACTIVATING_TIMEOUT,
 	HAL_DEACTIVATING_TIMEOUT,
     HAL_POWER_BUTTON_HELD_SHORT,
-    HAL_POWER_BUTTON_HELD_LONG
+    HAL_POWER_BUTTON_HELD_LONG,
+    HAL_DEADLINE_TICK					/** vm timer of the deadline service **/
 			
 };
 
@@ -70,6 +72,9 @@ typedef struct {
 	/** hal state **/
 	hal_state_t		state;
 	
+	/** power button and beep timeouts, on one vm timer **/
+	deadline_service_t	deadlines;
+	
 } halTaskData;
 
 #endif /** HAL_PRIVATE_H **/
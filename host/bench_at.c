@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "at_command.h"
+
+/**************************************
+
+  echo state command scan, csv on stdout, one row per command length and piece size:
+
+	length		bytes of the command, \r\n included
+	piece		bytes per SPP_MESSAGE_MORE_DATA, the command arrives in length / piece of them
+
+	resume_*	parseLineEnd() from the bytes already searched, what echo state does
+	rescan_*	from the start of the source on every arrival, what it did before
+	*_bytes		bytes looked at for the whole command
+	*_ns		host time for the whole command, averaged over REPEAT
+
+  the program fails if a scan misses the end of the command or resuming looks at a byte twice.
+
+  **************************************/
+
+#define REPEAT				2000
+#define LENGTH_MAX			512
+
+static const uint16 lengths[] = { 16, 64, 256, 512 };
+static const uint16 pieces[] = { 1, 4, 16, 128 };
+
+#define COUNT(a)			(sizeof(a) / sizeof(a[0]))
+
+static uint8 command[LENGTH_MAX];
+
+static double nowNs(void) {
+
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (double)t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** scan the command as it arrives, returns the bytes looked at and sets ns **/
+static uint32 scan(uint16 length, uint16 piece, bool resume, double *ns) {
+
+	volatile uint16 end = 0;
+	uint32 looked = 0;
+	double start = nowNs();
+	uint16 r;
+
+	for (r = 0; r < REPEAT; r++) {
+
+		uint16 size = 0;
+
+		while (size < length) {
+
+			uint16 from = resume ? size : 0;
+
+			size = size + piece < length ? size + piece : length;
+			end = parseLineEnd(command, from, size);
+
+			if (r == 0) {
+
+				looked += size > 2 ? size - (from > 2 ? from : 2) : 0;
+			}
+		}
+	}
+
+	*ns = (nowNs() - start) / REPEAT;
+
+	return end == length ? looked : 0;
+}
+
+int main(void) {
+
+	uint16 l, p;
+	bool failed = FALSE;
+
+	printf("length,piece,resume_bytes,rescan_bytes,resume_ns,rescan_ns\n");
+
+	for (l = 0; l < COUNT(lengths); l++) {
+		for (p = 0; p < COUNT(pieces); p++) {
+
+			uint16 length = lengths[l];
+			uint32 resume, rescan;
+			double resume_ns, rescan_ns;
+
+			memset(command, '1', length);
+			memcpy(command, "AT+CONNECT=", 11);
+			memcpy(command + length - 2, "\r\n", 2);
+
+			resume = scan(length, pieces[p], TRUE, &resume_ns);
+			rescan = scan(length, pieces[p], FALSE, &rescan_ns);
+
+			printf("%u,%u,%lu,%lu,%.0f,%.0f\n", length, pieces[p], (unsigned long)resume, (unsigned long)rescan, resume_ns, rescan_ns);
+
+			if (resume != (uint32)length - 2) {
+
+				failed = TRUE;
+			}
+		}
+	}
+
+	if (failed) {
+
+		fprintf(stderr, "bench_at: a scan missed the end or looked at bytes more than once\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "sppb.h"
+#include "at_command.h"
+
+/**************************************
+
+  AT command parser, the trie dispatcher tools/at_compile.py generates against the genparse parser
+  it replaced (genparse_at_command.c), csv on stdout, one row per parser:
+
+	lines, bytes	the corpus below, each line as \r\n<line>\r\n, parsed REPEAT times
+	ns_per_line		host time per line
+	ns_per_byte		host time per byte
+
+  both call the firmware handlers with a task of their own. the grammar is checked first, after every
+  line of the corpus the handlers must have left the same result, AT+CONNECT settings and packing time,
+  except for the lines marked as changed, where they must differ. the program fails otherwise.
+
+  **************************************/
+
+#define REPEAT				20000
+#define LINE_MAX			64
+
+const uint8 *genparseData(const uint8 *s, const uint8 *e, Task task);
+
+typedef const uint8 *(*parser_t)(const uint8 *s, const uint8 *e, Task task);
+
+static const struct {
+
+	const char	*line;
+	bool		changed;
+
+} corpus[] = {
+
+	{ "AT+CONNECT=1152,1,0,2,0",		FALSE },
+	{ "at+connect=96;2;1;1;5",			FALSE },
+	{ "AT + CONNECT : 9216, 1, 2, 0, 10",	FALSE },
+	{ "AT+CONNECT=48,1,0,2,0",			FALSE },	/** raw divisor, approximate **/
+	{ "AT+CONNECT=1,1,0,2,0",			FALSE },	/** baudrate error **/
+	{ "AT+CONNECT=1152,3,0,2,0",		FALSE },	/** stop error **/
+	{ "AT+CONNECT=1152,1,0,2",			FALSE },	/** an argument missing **/
+	{ "AT+CONNECT",						FALSE },
+	{ "AT+LATENCY",						FALSE },
+	{ "at+latency ",					FALSE },
+	{ "AT+PACKTIME=10",					FALSE },
+	{ "AT+PACKTIME:0",					FALSE },
+	{ "AT+PACKTIME=5000",				FALSE },	/** out of range **/
+	{ "AT+NOSUCH",						FALSE },
+	{ "ATE0",							FALSE },
+	{ "hello",							FALSE },
+
+	{ "AT+CONNECT=1152 1 0 2 0",		TRUE },		/** genparse took the separators as optional **/
+	{ "AT+CONNECT=70000,1,0,2,0",		TRUE },		/** genparse wrapped it to 4464 **/
+	{ "AT+STATS",						TRUE },		/** commands added since **/
+	{ "AT+COALESCE=4",					TRUE },
+	{ "AT+SNIFFIDLE=500",				TRUE }
+};
+
+#define COUNT(a)			(sizeof(a) / sizeof(a[0]))
+
+static sppb_task_t task;
+
+static uint16 lineBuild(uint8 *buf, const char *line) {
+
+	uint16 len = (uint16)strlen(line);
+
+	memcpy(buf, "\r\n", 2);
+	memcpy(buf + 2, line, len);
+	memcpy(buf + 2 + len, "\r\n", 2);
+
+	return len + 4;
+}
+
+/** parse one line from a clean task **/
+static void parseLine(parser_t parse, const char *line) {
+
+	uint8 buf[LINE_MAX];
+	uint16 len = lineBuild(buf, line);
+
+	memset(&task, 0, sizeof(task));
+	task.command_result = 0xFFFF;
+
+	(void)parse(buf, buf + len, (Task)&task);
+}
+
+static bool sameOutcome(const sppb_task_t *a, const sppb_task_t *b) {
+
+	return a ->command_result == b ->command_result && a ->command_connect == b ->command_connect &&
+		   a ->pack_timeout == b ->pack_timeout &&
+		   a ->uart_config.baudrate == b ->uart_config.baudrate && a ->uart_config.stop == b ->uart_config.stop &&
+		   a ->uart_config.parity == b ->uart_config.parity && a ->uart_config.polarity == b ->uart_config.polarity &&
+		   a ->uart_config.keeptime == b ->uart_config.keeptime;
+}
+
+static double nowNs(void) {
+
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (double)t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void bench(const char *name, parser_t parse) {
+
+	uint8 buf[LINE_MAX * COUNT(corpus)];
+	uint16 len = 0;
+	uint16 lines = 0;
+	double start;
+	uint16 i;
+
+	/** the lines both parsers know **/
+	for (i = 0; i < COUNT(corpus); i++) {
+
+		if (!corpus[i].changed) {
+
+			len += lineBuild(buf + len, corpus[i].line);
+			lines++;
+		}
+	}
+
+	start = nowNs();
+
+	for (i = 0; i < REPEAT; i++) {
+
+		task.command_result = 0xFFFF;
+		(void)parse(buf, buf + len, (Task)&task);
+	}
+
+	start = nowNs() - start;
+
+	printf("%s,%u,%u,%.1f,%.2f\n", name, lines, len, start / REPEAT / lines, start / REPEAT / len);
+}
+
+int main(void) {
+
+	static sppb_task_t genparse;
+	uint16 wrong = 0;
+	uint16 i;
+
+	simReset();
+
+	for (i = 0; i < COUNT(corpus); i++) {
+
+		parseLine(genparseData, corpus[i].line);
+		genparse = task;
+		parseLine(parseData, corpus[i].line);
+
+		if (sameOutcome(&genparse, &task) == corpus[i].changed) {
+
+			fprintf(stderr, "bench_parse: \"%s\" %s, genparse %u, trie %u\n", corpus[i].line,
+					corpus[i].changed ? "should have changed" : "changed", genparse.command_result, task.command_result);
+			wrong++;
+		}
+	}
+
+	printf("parser,lines,bytes,ns_per_line,ns_per_byte\n");
+	bench("genparse", genparseData);
+	bench("trie", parseData);
+
+	return wrong ? 1 : 0;
+}
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "stats.h"
+
+/**************************************
+
+  pipe benchmark, csv on stdout, one row per configuration:
+
+	baud		every rate AT+CONNECT accepts
+	frame		request and response size in bytes
+	polarity	AT+CONNECT polarity and keeptime, 2 is full duplex without direction control
+	rate		requests per second the phone offers
+
+  the phone sends a request of frame bytes every 1 / rate s for RUN_TIME, the controller answers each
+  complete request with a response of the same size after a modbus style turnaround, 3.5 characters of
+  silence plus 2 ms. the first two bytes of a frame carry its sequence number and the rest a fixed
+  pattern, a receiver that sees no valid frame slides by one byte, so a lost byte costs only its frame.
+  frames that don't arrive intact are counted as drops.
+
+	s2u_bps, u2s_bps		payload bytes delivered per second of the run, each direction
+	s2u_p50_us ...		phone send to last byte at the controller, controller's first byte on
+						the wire to last byte at the phone
+	load				per cent of the time the busier of the bus and the air is needed for what is offered,
+						on a half duplex bus request, turnaround, keeptime and response follow each other
+	offered				requests the phone could queue, it doesn't queue beyond 4 kB
+	*_drops				frames sent and not delivered intact
+	lost, collisions	bridge bytes sent with its driver off, controller bytes sent into it
+	overruns			uart source full
+	bytes_dropped		STAT_BYTES_DROPPED
+	exceptions			raise_exception() calls
+
+  every row is a fork of the same booted and connected bridge, so rows don't share pipe state. a row
+  below LOAD_MAX per cent load must not drop, lose, collide, overrun or raise anything, the program
+  fails if one does.
+
+  **************************************/
+
+int app_main(void);
+
+#define RUN_TIME			SIM_SEC(2)
+#define DRAIN_TIME			SIM_SEC(2)
+#define PHONE_BACKLOG		4096
+#define MAX_FRAMES			1024
+#define MAX_FRAME_SIZE		256
+#define LOAD_MAX			50
+
+static const uint16 rates[] = { 12, 24, 48, 96, 144, 192, 288, 384, 576, 768, 1152, 1280, 2304, 2500, 2560, 4608, 5000, 9216, 10000, 13824 };
+static const uint16 frames[] = { 8, 64, 256 };
+static const uint16 polarities[][2] = { { 2, 0 }, { 1, 1 }, { 0, 5 } };
+static const uint16 request_rates[] = { 10, 50, 200 };
+
+#define COUNT(a)			(sizeof(a) / sizeof(a[0]))
+
+static struct {
+
+	uint16		frame;
+	uint32		baud;
+
+	/** phone -> controller **/
+	sim_time_t	sent_at[MAX_FRAMES];
+	uint16		requests;
+	uint16		offered;
+	uint8		rx[MAX_FRAME_SIZE];
+	uint16		rx_len;
+	sim_time_t	s2u[MAX_FRAMES];
+	uint16		s2u_count;
+
+	/** controller -> phone **/
+	sim_time_t	started_at[MAX_FRAMES];
+	sim_time_t	line_free;
+	uint16		responses;
+	uint8		phone_rx[MAX_FRAME_SIZE];
+	uint16		phone_rx_len;
+	sim_time_t	u2s[MAX_FRAMES];
+	uint16		u2s_count;
+
+	sim_time_t	run_end;
+
+} bench;
+
+static void frameFill(uint8 *p, uint16 seq, uint8 fill) {
+
+	uint16 i;
+
+	p[0] = (uint8)(seq >> 8);
+	p[1] = (uint8)seq;
+
+	for (i = 2; i < bench.frame; i++) {
+
+		p[i] = (uint8)(fill + i);
+	}
+}
+
+static uint16 frameSeq(const uint8 *p, uint8 fill) {
+
+	uint16 i;
+
+	for (i = 2; i < bench.frame; i++) {
+
+		if (p[i] != (uint8)(fill + i)) {
+
+			return 0xFFFF;
+		}
+	}
+
+	return (uint16)((p[0] << 8) | p[1]);
+}
+
+static sim_time_t charTime(void) {
+
+	return (sim_time_t)10 * 1000000 / bench.baud;
+}
+
+static void controllerRespond(void *ctx) {
+
+	uint16 seq = (uint16)(size_t)ctx;
+	uint8 frame[MAX_FRAME_SIZE];
+	sim_time_t start = simNow() > bench.line_free ? simNow() : bench.line_free;
+
+	frameFill(frame, seq, 0x40);
+	bench.started_at[seq] = start;
+	bench.line_free = start + bench.frame * charTime();
+	bench.responses++;
+	simUartSend(frame, bench.frame);
+}
+
+/** add a byte to the receive window, the sequence number once it holds a valid frame, 0xFFFF otherwise **/
+static uint16 frameReceive(uint8 *window, uint16 *len, uint8 byte, uint8 fill, uint16 limit) {
+
+	uint16 seq;
+
+	window[(*len)++] = byte;
+
+	if (*len < bench.frame) {
+
+		return 0xFFFF;
+	}
+
+	seq = frameSeq(window, fill);
+
+	if (seq < limit) {
+
+		*len = 0;
+		return seq;
+	}
+
+	/** out of step after a lost or corrupt byte, slide **/
+	memmove(window, window + 1, --(*len));
+
+	return 0xFFFF;
+}
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	uint16 seq = frameReceive(bench.rx, &bench.rx_len, byte, 0x10, bench.requests);
+
+	if (seq != 0xFFFF) {
+
+		bench.s2u[bench.s2u_count++] = end - bench.sent_at[seq];
+		simAfter(charTime() * 35 / 10 + SIM_MS(2), controllerRespond, (void*)(size_t)seq);
+	}
+}
+
+static void phoneRx(const uint8 *data, uint16 len, sim_time_t when) {
+
+	while (len--) {
+
+		uint16 seq = frameReceive(bench.phone_rx, &bench.phone_rx_len, *data++, 0x40, MAX_FRAMES);
+
+		if (seq != 0xFFFF && bench.started_at[seq]) {
+
+			bench.u2s[bench.u2s_count++] = when - bench.started_at[seq];
+		}
+	}
+}
+
+static void phoneRequest(void *ctx) {
+
+	uint16 rate = (uint16)(size_t)ctx;
+	uint8 frame[MAX_FRAME_SIZE];
+
+	if (simNow() >= bench.run_end || bench.requests >= MAX_FRAMES) {
+
+		return;
+	}
+
+	bench.offered++;
+
+	if (simPhonePending() + bench.frame <= PHONE_BACKLOG) {
+
+		frameFill(frame, bench.requests, 0x10);
+		bench.sent_at[bench.requests++] = simNow();
+		simPhoneSend(frame, bench.frame);
+	}
+
+	simAfter(SIM_SEC(1) / rate, phoneRequest, ctx);
+}
+
+static int compareTime(const void *a, const void *b) {
+
+	sim_time_t x = *(const sim_time_t*)a, y = *(const sim_time_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static sim_time_t percentile(sim_time_t *v, uint16 n, uint16 p) {
+
+	if (!n) {
+
+		return 0;
+	}
+
+	qsort(v, n, sizeof(v[0]), compareTime);
+
+	return v[((uint32)n * p + 99) / 100 - 1];
+}
+
+/** per cent, see above **/
+static uint16 load(uint16 polarity, uint16 keeptime, uint16 rate) {
+
+	double wire = (double)bench.frame * charTime() / 1000000;
+	double bus = polarity == 2 ? wire : 2 * wire + (double)charTime() * 35 / 10 / 1000000 + 0.002 + (double)keeptime / 1000;
+	double air = (double)bench.frame / sim_config.spp_bytes_per_s;
+
+	return (uint16)(rate * (bus > air ? bus : air) * 100 + 0.5);
+}
+
+/** FALSE if a row below LOAD_MAX lost anything **/
+static bool run(uint16 baudrate, uint16 frame, uint16 polarity, uint16 keeptime, uint16 rate) {
+
+	double seconds = (double)RUN_TIME / 1000000;
+	uint16 row_load;
+	bool clean;
+
+	memset(&bench, 0, sizeof(bench));
+	bench.frame = frame;
+	bench.baud = (uint32)baudrate * 100;
+
+	row_load = load(polarity, keeptime, rate);
+
+	printf("%lu,%u,%u,%u,%u,%u,", (unsigned long)bench.baud, frame, polarity, keeptime, rate, row_load);
+
+	if (!simBridgePipe(baudrate, 1, 0, polarity, keeptime)) {
+
+		printf("connect failed\n");
+		return FALSE;
+	}
+
+	sim_uart.rx = controllerRx;
+	sim_phone.rx = phoneRx;
+	memset(stats_counter, 0, sizeof(stats_counter));
+
+	bench.run_end = simNow() + RUN_TIME;
+	simAfter(0, phoneRequest, (void*)(size_t)rate);
+	(void)simRunUntil(simNow() + RUN_TIME + DRAIN_TIME);
+
+	printf("%u,%.0f,%.0f,%llu,%llu,%llu,%llu,%u,%u,%lu,%lu,%lu,%lu,%lu\n",
+		   bench.offered,
+		   bench.s2u_count * (double)frame / seconds,
+		   bench.u2s_count * (double)frame / seconds,
+		   percentile(bench.s2u, bench.s2u_count, 50), percentile(bench.s2u, bench.s2u_count, 99),
+		   percentile(bench.u2s, bench.u2s_count, 50), percentile(bench.u2s, bench.u2s_count, 99),
+		   bench.requests - bench.s2u_count, bench.responses - bench.u2s_count,
+		   (unsigned long)sim_uart.lost, (unsigned long)sim_uart.collisions, (unsigned long)sim_uart.overruns,
+		   (unsigned long)stats_counter[STAT_BYTES_DROPPED], (unsigned long)stats_counter[STAT_EXCEPTIONS]);
+
+	clean = bench.requests == bench.s2u_count && bench.responses == bench.u2s_count &&
+			!sim_uart.lost && !sim_uart.collisions && !sim_uart.overruns &&
+			!stats_counter[STAT_BYTES_DROPPED] && !stats_counter[STAT_EXCEPTIONS];
+
+	return clean || row_load >= LOAD_MAX;
+}
+
+int main(void) {
+
+	uint16 b, f, p, r;
+	uint16 failed = 0;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+
+	if (!simBridgePowerOn() || !simBridgeConnect()) {
+
+		fprintf(stderr, "bench_pipe: the bridge didn't connect\n");
+		return 1;
+	}
+
+	printf("baud,frame,polarity,keeptime,rate,load,offered,s2u_bps,u2s_bps,s2u_p50_us,s2u_p99_us,u2s_p50_us,u2s_p99_us,"
+		   "s2u_drops,u2s_drops,lost,collisions,overruns,bytes_dropped,exceptions\n");
+	fflush(stdout);
+
+	for (b = 0; b < COUNT(rates); b++) {
+		for (f = 0; f < COUNT(frames); f++) {
+			for (p = 0; p < COUNT(polarities); p++) {
+				for (r = 0; r < COUNT(request_rates); r++) {
+
+					pid_t pid = fork();
+					int status = 0;
+
+					if (pid == 0) {
+
+						bool ok = run(rates[b], frames[f], polarities[p][0], polarities[p][1], request_rates[r]);
+
+						fflush(stdout);
+						_exit(ok ? 0 : 1);
+					}
+
+					if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status)) {
+
+						failed++;
+					}
+				}
+			}
+		}
+	}
+
+	if (failed) {
+
+		fprintf(stderr, "bench_pipe: %u rows below %u%% load lost data\n", failed, LOAD_MAX);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <connection.h>
+
+#include "sim.h"
+#include "sppb.h"
+#include "session_profile.h"
+
+/**************************************
+
+  inquiry/page scan schedule of the scan super-state, csv on stdout, one row per schedule:
+
+	latency_10s		mean page latency in s of a phone paging at a random time of the first 10 s
+	latency_90s		the same over the 90 s pairable state
+	duty_90s		% of the 90 s the radio scans
+
+  the new and known peer rows are the scan parameters the firmware writes after power-on, recorded by
+  sim_scan_hook, with and without a stored session profile. the old fixed row is what the firmware
+  wrote before the schedule, inquiry scan 0x400/0x200 and the default page scan, once at power-on.
+
+  a page is answered at the start of the first page scan window at or after it, or at once inside a
+  window. the pager starts on one of the two page trains and switches after PAGE_TRAIN, a standard
+  scan is on the other train half of the time, an interlaced scan listens on both in one interval.
+  the scan duty counts an interlaced window twice.
+
+  the program fails if the latencies and duties stray from the ones quoted in scan_schedule.h.
+
+  **************************************/
+
+int app_main(void);
+
+#define TIMELINE_MAX		32
+#define PAGE_TRAIN			SIM_MS(1280)		/** a train is repeated 128 times of 10 ms **/
+#define PAGE_STEP			SIM_MS(1)			/** page times are sampled this far apart **/
+#define SLOT_US				625
+
+typedef struct {
+
+	sim_time_t	at;
+	sim_scan_t	scan;
+
+} timeline_t;
+
+static timeline_t timeline[TIMELINE_MAX];
+static uint16 timeline_len;
+
+static const struct {
+
+	const char	*name;
+	double		latency_10s;
+	double		latency_90s;
+	double		duty_90s;
+
+} quoted[] = {
+
+	{ "old_fixed",	1.28, 1.27, 50.9 },
+	{ "new_peer",	0.07, 0.50,  7.0 },
+	{ "known_peer",	0.19, 0.55,  3.3 }
+};
+
+/** writes at the same time make one entry, a step writes up to five parameters **/
+static void scanRecord(void) {
+
+	if (timeline_len && timeline[timeline_len - 1].at == simNow()) {
+
+		timeline[timeline_len - 1].scan = sim_scan;
+	}
+	else if (timeline_len < TIMELINE_MAX) {
+
+		timeline[timeline_len].at = simNow();
+		timeline[timeline_len].scan = sim_scan;
+		timeline_len++;
+	}
+}
+
+static bool pageScan(const sim_scan_t *s) {
+
+	return (s ->enable == hci_scan_enable_page || s ->enable == hci_scan_enable_inq_and_page) && s ->page_interval;
+}
+
+static bool inquiryScan(const sim_scan_t *s) {
+
+	return (s ->enable == hci_scan_enable_inq || s ->enable == hci_scan_enable_inq_and_page) && s ->inquiry_interval;
+}
+
+/** start of the first page scan window at or after t, t itself inside one **/
+static sim_time_t pageWindow(sim_time_t t) {
+
+	uint16 i;
+
+	for (i = 0; i < timeline_len; i++) {
+
+		const sim_scan_t *s = &timeline[i].scan;
+		sim_time_t start = timeline[i].at;
+		sim_time_t end = i + 1 < timeline_len ? timeline[i + 1].at : (sim_time_t)-1;
+		sim_time_t interval, phase, next;
+
+		if (end <= t || !pageScan(s)) {
+
+			continue;
+		}
+
+		if (t < start) {
+
+			return start;
+		}
+
+		interval = (sim_time_t)s ->page_interval * SLOT_US;
+		phase = (t - start) % interval;
+
+		if (phase < (sim_time_t)s ->page_window * SLOT_US) {
+
+			return t;
+		}
+
+		next = t - phase + interval;
+
+		if (next < end) {
+
+			return next;
+		}
+	}
+
+	return (sim_time_t)-1;
+}
+
+/** mean over pages sent every PAGE_STEP from the start of the timeline up to span **/
+static double pageLatency(sim_time_t span) {
+
+	sim_time_t t0 = timeline[0].at;
+	double sum = 0;
+	uint32 n = 0;
+	sim_time_t t;
+
+	for (t = t0; t < t0 + span; t += PAGE_STEP) {
+
+		sim_time_t found = pageWindow(t);
+		const sim_scan_t *s = &timeline[0].scan;
+		uint16 i;
+
+		for (i = 0; i < timeline_len && timeline[i].at <= found; i++) {
+
+			s = &timeline[i].scan;
+		}
+
+		if (s ->page_type == hci_scan_type_interlaced) {
+
+			sum += found - t;
+		}
+		else {
+
+			/** half the pagers start on our train, the others find us after the switch **/
+			sum += (found - t) / 2.0 + (pageWindow(t + PAGE_TRAIN) - t) / 2.0;
+		}
+		n++;
+	}
+
+	return sum / n / 1e6;
+}
+
+/** % of span the radio scans **/
+static double scanDuty(sim_time_t span) {
+
+	sim_time_t t0 = timeline[0].at;
+	double busy = 0;
+	uint16 i;
+
+	for (i = 0; i < timeline_len && timeline[i].at < t0 + span; i++) {
+
+		const sim_scan_t *s = &timeline[i].scan;
+		sim_time_t end = i + 1 < timeline_len && timeline[i + 1].at < t0 + span ? timeline[i + 1].at : t0 + span;
+		double duty = 0;
+
+		if (pageScan(s)) {
+
+			duty += (double)s ->page_window / s ->page_interval * (s ->page_type == hci_scan_type_interlaced ? 2 : 1);
+		}
+
+		if (inquiryScan(s)) {
+
+			duty += (double)s ->inquiry_window / s ->inquiry_interval * (s ->inquiry_type == hci_scan_type_interlaced ? 2 : 1);
+		}
+
+		busy += duty * (end - timeline[i].at);
+	}
+
+	return busy * 100 / span;
+}
+
+/** the scan parameters written from power-on to the end of the pairable state **/
+static bool recordBoot(bool known_peer) {
+
+	sim_time_t t0;
+
+	simReset();
+	simSetLoopLimit(SIM_SEC(SPPB_PAIRABLE_DURATION / 1000 + 10));
+
+	if (known_peer) {
+
+		struct connect config;
+
+		memset(&config, 0, sizeof(config));
+		config.baudrate = 96;
+		config.stop = 1;
+		profileSave(&sim_phone.addr, &config);
+	}
+
+	timeline_len = 0;
+	sim_scan_hook = scanRecord;
+	(void)app_main();
+
+	if (!simBridgePowerOn() || !timeline_len) {
+
+		return FALSE;
+	}
+
+	/** from the first write that scans **/
+	while (timeline_len && timeline[0].scan.enable == hci_scan_enable_off) {
+
+		memmove(timeline, timeline + 1, --timeline_len * sizeof(timeline[0]));
+	}
+
+	t0 = timeline_len ? timeline[0].at : simNow();
+	(void)simRunUntil(t0 + SIM_MS(SPPB_PAIRABLE_DURATION));
+	sim_scan_hook = 0;
+
+	return timeline_len != 0;
+}
+
+static void recordOldFixed(void) {
+
+	sim_scan_t *s = &timeline[0].scan;
+
+	memset(timeline, 0, sizeof(timeline));
+	timeline_len = 1;
+
+	s ->enable = hci_scan_enable_inq_and_page;
+	s ->inquiry_interval = 0x400;
+	s ->inquiry_window = 0x200;
+	s ->page_interval = 0x800;
+	s ->page_window = 0x12;
+	s ->inquiry_type = s ->page_type = hci_scan_type_standard;
+}
+
+/** prints the row, FALSE if it strays from the quoted one by more than the last digit **/
+static bool report(uint16 row) {
+
+	double l10 = pageLatency(SIM_SEC(10));
+	double l90 = pageLatency(SIM_MS(SPPB_PAIRABLE_DURATION));
+	double duty = scanDuty(SIM_MS(SPPB_PAIRABLE_DURATION));
+
+	printf("%s,%.2f,%.2f,%.1f\n", quoted[row].name, l10, l90, duty);
+
+	return l10 - quoted[row].latency_10s < 0.01 && quoted[row].latency_10s - l10 < 0.01 &&
+		   l90 - quoted[row].latency_90s < 0.01 && quoted[row].latency_90s - l90 < 0.01 &&
+		   duty - quoted[row].duty_90s < 0.1 && quoted[row].duty_90s - duty < 0.1;
+}
+
+int main(void) {
+
+	bool ok = TRUE;
+
+	printf("schedule,latency_10s,latency_90s,duty_90s\n");
+
+	recordOldFixed();
+	ok = report(0) && ok;
+
+	ok = recordBoot(FALSE) && report(1) && ok;
+	ok = recordBoot(TRUE) && report(2) && ok;
+
+	if (!ok) {
+
+		fprintf(stderr, "bench_scan: the schedule strays from the table in scan_schedule.h\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/**************************************
+
+  minimal checks for the host programs, a failed CHECK() prints itself and the program carries on,
+  checkDone() is the exit code
+
+  **************************************/
+
+static unsigned check_failures;
+static unsigned check_count;
+
+#define CHECK(c)	do { check_count++; if (!(c)) { check_failures++; \
+						fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); } } while (0)
+
+static int checkDone(const char *name) {
+
+	printf("%s: %u checks, %u failed\n", name, check_count, check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif /** CHECK_H **/
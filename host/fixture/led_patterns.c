@@ -0,0 +1,163 @@
+/**************************************
+
+  generated by tools/led_compile.py from host/fixture/spp_dev_b_leds.led, do not edit.
+
+  **************************************/
+
+#include "led_timeline.h"
+
+const uint16 led_pins_used = 0x0807;
+const uint16 led_pins_mixed = 0x0800;
+
+/** ALL_LEDS_OFF **/
+static const led_step_t steps_ALL_LEDS_OFF[1] = {
+	{ 0x0807, 0x0000,    0 }
+};
+
+/** WHITE_ON **/
+static const led_step_t steps_WHITE_ON[1] = {
+	{ 0x0007, 0x0007,    0 }
+};
+
+/** RED_ON **/
+static const led_step_t steps_RED_ON[1] = {
+	{ 0x0002, 0x0002,    0 }
+};
+
+/** RED_GREEN_ON **/
+static const led_step_t steps_RED_GREEN_ON[1] = {
+	{ 0x0003, 0x0003,    0 }
+};
+
+/** GREEN_ON **/
+static const led_step_t steps_GREEN_ON[1] = {
+	{ 0x0001, 0x0001,    0 }
+};
+
+/** BLUE_FAST_FLASH **/
+static const led_step_t steps_BLUE_FAST_FLASH[2] = {
+	{ 0x0004, 0x0004,  100 },
+	{ 0x0004, 0x0000,  100 }
+};
+
+/** BLUE_THRICE_FAST_ONICE_SLOW_FLASH **/
+static const led_step_t steps_BLUE_THRICE_FAST_ONICE_SLOW_FLASH[8] = {
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,  500 },
+	{ 0x0004, 0x0000, 2000 }
+};
+
+/** GREEN_FAST_FLASH **/
+static const led_step_t steps_GREEN_FAST_FLASH[2] = {
+	{ 0x0001, 0x0001,  100 },
+	{ 0x0001, 0x0000,  100 }
+};
+
+/** WHITE_FAST_FLASH **/
+static const led_step_t steps_WHITE_FAST_FLASH[2] = {
+	{ 0x0007, 0x0007,  100 },
+	{ 0x0007, 0x0000,  100 }
+};
+
+/** BLUE_SLOW_FLASH **/
+static const led_step_t steps_BLUE_SLOW_FLASH[2] = {
+	{ 0x0004, 0x0004,  200 },
+	{ 0x0004, 0x0000, 2000 }
+};
+
+/** RED_SLOW_FLASH **/
+static const led_step_t steps_RED_SLOW_FLASH[2] = {
+	{ 0x0002, 0x0002,  200 },
+	{ 0x0002, 0x0000, 2000 }
+};
+
+/** RED_ON_BLUE_SLOW_FLASH **/
+static const led_step_t steps_RED_ON_BLUE_SLOW_FLASH[2] = {
+	{ 0x0002, 0x0002, 2000 },
+	{ 0x0006, 0x0004,  200 }
+};
+
+/** RED_GREEN_ON_BLUE_SLOW_FLASH **/
+static const led_step_t steps_RED_GREEN_ON_BLUE_SLOW_FLASH[2] = {
+	{ 0x0003, 0x0003, 2000 },
+	{ 0x0007, 0x0004,  200 }
+};
+
+/** GREEN_ON_BLUE_SLOW_FLASH **/
+static const led_step_t steps_GREEN_ON_BLUE_SLOW_FLASH[2] = {
+	{ 0x0801, 0x0001, 2000 },
+	{ 0x0005, 0x0004,  200 }
+};
+
+/** RED_GREEN_BLUE_ALT **/
+static const led_step_t steps_RED_GREEN_BLUE_ALT[6] = {
+	{ 0x0002, 0x0002,  200 },
+	{ 0x0002, 0x0000,  200 },
+	{ 0x0001, 0x0001,  200 },
+	{ 0x0001, 0x0000,  200 },
+	{ 0x0004, 0x0004,  200 },
+	{ 0x0004, 0x0000,  200 }
+};
+
+/** RAINBOW **/
+static const led_step_t steps_RAINBOW[6] = {
+	{ 0x0002, 0x0002,  100 },
+	{ 0x0003, 0x0003,  100 },
+	{ 0x0003, 0x0001,  100 },
+	{ 0x0005, 0x0005,  100 },
+	{ 0x0005, 0x0004,  100 },
+	{ 0x0006, 0x0006,  100 }
+};
+
+/** BEEP_ONCE **/
+static const led_step_t steps_BEEP_ONCE[2] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+/** BEEP_TWICE **/
+static const led_step_t steps_BEEP_TWICE[4] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+/** BEEP_THREE_TIMES **/
+static const led_step_t steps_BEEP_THREE_TIMES[6] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+const led_timeline_t led_patterns[19] = {
+	{ steps_ALL_LEDS_OFF, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_WHITE_ON, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_RED_ON, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_RED_GREEN_ON, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_GREEN_ON, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_BLUE_FAST_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_BLUE_THRICE_FAST_ONICE_SLOW_FLASH, 8, TRUE, 0x0000, 0x0000 },
+	{ steps_GREEN_FAST_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_WHITE_FAST_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_BLUE_SLOW_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_RED_SLOW_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_RED_ON_BLUE_SLOW_FLASH, 2, TRUE, 0x0004, 0x0000 },
+	{ steps_RED_GREEN_ON_BLUE_SLOW_FLASH, 2, TRUE, 0x0004, 0x0000 },
+	{ steps_GREEN_ON_BLUE_SLOW_FLASH, 2, TRUE, 0x0004, 0x0000 },
+	{ steps_RED_GREEN_BLUE_ALT, 6, TRUE, 0x0000, 0x0000 },
+	{ steps_RAINBOW, 6, TRUE, 0x0006, 0x0000 },
+	{ steps_BEEP_ONCE, 2, FALSE, 0x0000, 0x0000 },
+	{ steps_BEEP_TWICE, 4, FALSE, 0x0000, 0x0000 },
+	{ steps_BEEP_THREE_TIMES, 6, FALSE, 0x0000, 0x0000 }
+};
+
+const uint16 led_patterns_count = 19;
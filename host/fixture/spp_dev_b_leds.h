@@ -0,0 +1,68 @@
+/***************************************************************************
+Copyright (C) Cambridge Silicon Radio Ltd. 2006-2009
+
+	This file was auto-generated by the ledparse application from 
+	BlueLab 4.1.2-Release and provides simple LED indications.
+*****************************************************************************/
+
+#ifndef MULTI_LEDS_H
+#define MULTI_LEDS_H
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/*INSERTED_CODE_HERE*/
+
+typedef enum LedPatternTag
+{
+    ALL_LEDS_OFF ,
+    WHITE_ON ,
+    RED_ON ,
+    RED_GREEN_ON ,
+    GREEN_ON ,
+    BLUE_FAST_FLASH ,
+    BLUE_THRICE_FAST_ONICE_SLOW_FLASH ,
+    GREEN_FAST_FLASH ,
+    WHITE_FAST_FLASH ,
+    BLUE_SLOW_FLASH ,
+    RED_SLOW_FLASH ,
+    RED_ON_BLUE_SLOW_FLASH ,
+    RED_GREEN_ON_BLUE_SLOW_FLASH ,
+    GREEN_ON_BLUE_SLOW_FLASH ,
+    RED_GREEN_BLUE_ALT ,
+    RAINBOW ,
+    BEEP_ONCE ,
+    BEEP_TWICE ,
+    BEEP_THREE_TIMES
+
+} LedPattern_t ;
+/*END_OF_INSERTED_CODE*/
+
+
+/****************************************************************************
+NAME	
+	ledsPlay
+
+DESCRIPTION
+    Play an LED pattern. 
+    
+    If a repeating pattern is already playing 
+    - then this will be interuppted and the new pattern (non repeating or 
+      repeating)will be played. If the new pattern is non-repeating then the 
+      interrupted pattern will be resumed after completion of the 
+      non-repeating pattern.
+    
+    If a non-repeating pattern is currently playing    
+    - if the new pattern is also a non-repeating pattern, then returns false 
+      (caller is responsible for queuing LEDS).
+    - if the new pattern is a repeating pattern, then this will be played on
+      completion of the non-repeating current pattern.
+    
+RETURNS
+	bool (whether the LED Pattern has been started or not)
+*/
+bool ledsPlay ( LedPattern_t pNewPattern ) ;
+
+#endif
+
@@ -0,0 +1,18 @@
+/**************************************
+
+  the ledparse engine and a led_timeline of the patterns in fixture/, under fixture names so
+  test_led links them next to the firmware's own.
+
+  **************************************/
+
+#define ledsPlay				fixtureLedsPlay
+#define LED						fixture_leds
+#define led_patterns			fixture_led_patterns
+#define led_patterns_count		fixture_led_patterns_count
+#define led_pins_used			fixture_led_pins_used
+#define led_pins_mixed			fixture_led_pins_mixed
+#define ledTimelineSet			fixtureLedTimelineSet
+
+#include "fixture/spp_dev_b_leds.c"
+#include "fixture/led_patterns.c"
+#include "../led_timeline.c"
@@ -0,0 +1,12 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <message_.h>
+
+typedef enum { VM_ADC_SRC_AIO0, VM_ADC_SRC_AIO1, VM_ADC_SRC_VREF } vm_adc_source_type;
+
+typedef struct { vm_adc_source_type adc_source; uint16 reading; } MessageAdcResult;
+
+bool AdcRequest(Task task, vm_adc_source_type adc);
+
+#endif /** ADC_H **/
@@ -0,0 +1,8 @@
+#ifndef APP_MESSAGE_SYSTEM_MESSAGE_H
+#define APP_MESSAGE_SYSTEM_MESSAGE_H
+
+#include <csrtypes.h>
+
+typedef struct { uint16 state; uint32 time; } MessagePioChanged;
+
+#endif /** APP_MESSAGE_SYSTEM_MESSAGE_H **/
@@ -0,0 +1,15 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <message_.h>
+
+/** the library sends BATTERY_READING_MESSAGE with a uint32 mV payload **/
+#define BATTERY_READING_MESSAGE		0x7800
+
+typedef enum { AIO0, AIO1, VDD } battery_reading_source;
+
+typedef struct { Task client; uint16 source; uint16 period; } BatteryState;
+
+void BatteryInit(BatteryState *state, Task task, battery_reading_source source, uint16 period);
+
+#endif /** BATTERY_H **/
@@ -0,0 +1,8 @@
+#ifndef BDADDR_H
+#define BDADDR_H
+
+#include <bdaddr_.h>
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second);
+
+#endif /** BDADDR_H **/
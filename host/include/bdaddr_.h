@@ -0,0 +1,8 @@
+#ifndef BDADDR__H
+#define BDADDR__H
+
+#include <csrtypes.h>
+
+typedef struct { uint32 lap; uint8 uap; uint16 nap; } bdaddr;
+
+#endif /** BDADDR__H **/
@@ -0,0 +1,8 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <csrtypes.h>
+
+void BootSetMode(uint16 mode);
+
+#endif /** BOOT_H **/
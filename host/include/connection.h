@@ -0,0 +1,72 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <message.h>
+#include <bdaddr_.h>
+
+/** the part of the connection library the firmware uses **/
+
+#define CL_MESSAGE_BASE				0x5000
+
+enum {
+	CL_INIT_CFM = CL_MESSAGE_BASE,
+	CL_DM_MODE_CHANGE_EVENT,
+	CL_DM_REMOTE_FEATURES_CFM,
+	CL_DM_LINK_SUPERVISION_TIMEOUT_IND,
+	CL_DM_SNIFF_SUB_RATING_IND,
+	CL_DM_ACL_OPENED_IND,
+	CL_DM_ACL_CLOSED_IND,
+	CL_SM_PIN_CODE_IND,
+	CL_SM_AUTHORISE_IND,
+	CL_SM_AUTHENTICATE_CFM,
+	CL_SM_ENCRYPTION_KEY_REFRESH_IND,
+	CL_DM_LINK_POLICY_IND,
+	CL_SM_IO_CAPABILITY_REQ_IND,
+	CL_SM_REMOTE_IO_CAPABILITY_IND
+};
+
+typedef enum { success, fail } connection_lib_status;
+typedef enum { hci_success } hci_status;
+typedef enum { lp_active, lp_sniff, lp_passive } lp_power_mode;
+
+typedef struct {
+	lp_power_mode	state;
+	uint16			min_interval;
+	uint16			max_interval;
+	uint16			attempt;
+	uint16			timeout;
+	uint16			time;
+} lp_power_table;
+
+typedef enum { hci_scan_enable_off, hci_scan_enable_inq, hci_scan_enable_page, hci_scan_enable_inq_and_page } hci_scan_enable;
+typedef enum { hci_scan_type_standard, hci_scan_type_interlaced } hci_scan_type;
+typedef enum { auth_status_success, auth_status_fail, auth_status_timeout } authentication_status;
+
+typedef struct { connection_lib_status status; } CL_INIT_CFM_T;
+typedef struct { hci_status status; uint16 features[4]; } CL_DM_REMOTE_FEATURES_CFM_T;
+typedef struct { bdaddr bd_addr; lp_power_mode mode; uint16 interval; } CL_DM_MODE_CHANGE_EVENT_T;
+typedef struct { bdaddr bd_addr; } CL_SM_PIN_CODE_IND_T;
+typedef struct { bdaddr bd_addr; uint16 protocol_id; uint32 channel; bool incoming; } CL_SM_AUTHORISE_IND_T;
+typedef struct { bdaddr bd_addr; authentication_status status; } CL_SM_AUTHENTICATE_CFM_T;
+typedef struct { bdaddr bd_addr; } CL_SM_REMOTE_IO_CAPABILITY_IND_T;
+
+#define cl_sm_io_cap_no_input_no_output		3
+
+void ConnectionInit(Task task);
+void ConnectionSmRegisterIncomingService(uint16 protocol_id, uint32 channel, uint16 security);
+void ConnectionWriteClassOfDevice(uint32 cod);
+void ConnectionWriteInquiryscanActivity(uint16 interval, uint16 window);
+void ConnectionWritePagescanActivity(uint16 interval, uint16 window);
+void ConnectionWriteInquiryScanType(hci_scan_type type);
+void ConnectionWritePageScanType(hci_scan_type type);
+void ConnectionSmSetSdpSecurityIn(bool enable);
+void ConnectionWriteScanEnable(hci_scan_enable mode);
+void ConnectionReadRemoteSuppFeatures(Task task, Sink sink);
+void ConnectionSetLinkPolicy(Sink sink, uint16 size, const lp_power_table *table);
+void ConnectionSetSniffSubRatePolicy(Sink sink, uint16 max_remote_latency, uint16 min_remote_timeout, uint16 min_local_timeout);
+void ConnectionSmPinCodeResponse(const bdaddr *bd_addr, uint16 length, const uint8 *pin);
+void ConnectionSmAuthoriseResponse(const bdaddr *bd_addr, uint16 protocol_id, uint32 channel, bool incoming, bool authorised);
+void ConnectionSmSetTrustLevel(const bdaddr *bd_addr, bool trusted);
+void ConnectionSmIoCapabilityResponse(const bdaddr *bd_addr, uint16 io_capability, bool force_mitm, bool bonding, bool oob_data_present, uint8 *oob_hash_c, uint8 *oob_rand_r);
+
+#endif /** CONNECTION_H **/
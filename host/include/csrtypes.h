@@ -0,0 +1,22 @@
+#ifndef CSRTYPES_H
+#define CSRTYPES_H
+
+/** host stand-in for the BlueLab type header, uint32 keeps the 32 bit wrap of the chip **/
+
+typedef unsigned char	uint8;
+typedef unsigned short	uint16;
+typedef unsigned int	uint32;
+typedef signed char		int8;
+typedef short			int16;
+typedef int				int32;
+
+typedef unsigned int	bool;
+
+#define TRUE			1
+#define FALSE			0
+
+#ifndef NULL
+#define NULL			((void*)0)
+#endif
+
+#endif /** CSRTYPES_H **/
@@ -0,0 +1,28 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <message_.h>
+#include <stdlib.h>
+
+/** system messages, values as in the BlueLab headers **/
+#define MESSAGE_MORE_DATA			0x8002
+#define MESSAGE_MORE_SPACE			0x8003
+#define MESSAGE_PIO_CHANGED			0x8004
+#define MESSAGE_ADC_RESULT			0x8006
+
+#define D_SEC(s)					((uint32)(s) * 1000)
+
+void MessageSend(Task task, MessageId id, void *message);
+void MessageSendLater(Task task, MessageId id, void *message, uint32 delay);
+void MessageSendConditionally(Task task, MessageId id, void *message, const uint16 *condition);
+uint16 MessageCancelAll(Task task, MessageId id);
+bool MessageCancelFirst(Task task, MessageId id);
+uint16 MessageFlushTask(Task task);
+void MessageLoop(void);
+Task MessageSinkTask(Sink sink, Task task);
+Task MessagePioTask(Task task);
+
+#define PanicUnlessNew(T)			((T*)PanicNull(malloc(sizeof(T))))
+void *PanicNull(void *p);
+
+#endif /** MESSAGE_H **/
@@ -0,0 +1,16 @@
+#ifndef MESSAGE__H
+#define MESSAGE__H
+
+#include <csrtypes.h>
+
+typedef uint16 MessageId;
+typedef const void *Message;
+
+typedef struct TaskData *Task;
+typedef void (*TaskHandler)(Task, MessageId, Message);
+typedef struct TaskData { TaskHandler handler; } TaskData;
+
+typedef struct SINK_T *Sink;
+typedef struct SOURCE_T *Source;
+
+#endif /** MESSAGE__H **/
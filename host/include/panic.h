@@ -0,0 +1,11 @@
+#ifndef PANIC_H
+#define PANIC_H
+
+#include <csrtypes.h>
+
+void Panic(void);
+void *PanicNull(void *p);
+
+#define PanicFalse(x)				((x) ? (x) : (Panic(), (x)))
+
+#endif /** PANIC_H **/
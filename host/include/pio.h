@@ -0,0 +1,13 @@
+#ifndef PIO_H
+#define PIO_H
+
+#include <csrtypes.h>
+
+uint16 PioGet(void);
+uint16 PioSet(uint16 mask, uint16 bits);
+uint16 PioSetDir(uint16 mask, uint16 dir);
+uint16 PioDebounce(uint16 mask, uint16 count, uint16 period);
+bool PioSetLed0(bool on);
+bool PioSetLed1(bool on);
+
+#endif /** PIO_H **/
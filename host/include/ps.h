@@ -0,0 +1,13 @@
+#ifndef PS_H
+#define PS_H
+
+#include <csrtypes.h>
+
+/** lengths are in sizeof() units, words on the chip and bytes on the host **/
+uint16 PsStore(uint16 key, const void *buff, uint16 words);
+uint16 PsRetrieve(uint16 key, void *buff, uint16 words);
+uint16 PsFullRetrieve(uint16 key, void *buff, uint16 words);
+
+#define PSKEY_PIO_WAKEUP_STATE		0x0296
+
+#endif /** PS_H **/
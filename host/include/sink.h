@@ -0,0 +1,19 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <message_.h>
+
+#define VM_SINK_MESSAGES			1
+
+#define VM_MESSAGES_ALL				0
+#define VM_MESSAGES_SOME			1
+#define VM_MESSAGES_NONE			2
+
+uint16 SinkSlack(Sink sink);
+uint16 SinkClaim(Sink sink, uint16 extra);
+uint8 *SinkMap(Sink sink);
+bool SinkFlush(Sink sink, uint16 amount);
+bool SinkIsValid(Sink sink);
+bool SinkConfigure(Sink sink, uint16 key, uint16 value);
+
+#endif /** SINK_H **/
@@ -0,0 +1,14 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <message_.h>
+
+#define VM_SOURCE_MESSAGES			1
+
+uint16 SourceSize(Source source);
+const uint8 *SourceMap(Source source);
+void SourceDrop(Source source, uint16 amount);
+bool SourceIsValid(Source source);
+bool SourceConfigure(Source source, uint16 key, uint16 value);
+
+#endif /** SOURCE_H **/
@@ -0,0 +1,41 @@
+#ifndef SPP_H
+#define SPP_H
+
+#include <connection.h>
+
+/** the part of the spp library the firmware uses **/
+
+#define SPP_MESSAGE_BASE			0x6000
+
+typedef struct SPP_T SPP;
+
+enum {
+	SPP_INIT_CFM = SPP_MESSAGE_BASE,
+	SPP_CONNECT_IND,
+	SPP_CONNECT_CFM,
+	SPP_DISCONNECT_IND,
+	SPP_MESSAGE_MORE_DATA,
+	SPP_MESSAGE_MORE_SPACE
+};
+
+typedef enum { spp_init_success, spp_init_fail } spp_init_status;
+typedef enum { rfcomm_connect_success, rfcomm_connect_failed } rfcomm_connect_status;
+typedef enum { spp_disconnect_success, spp_disconnect_link_loss } spp_disconnect_status;
+
+typedef struct { spp_init_status status; } SPP_INIT_CFM_T;
+typedef struct { SPP *spp; bdaddr addr; uint8 server_channel; uint16 frame_size; } SPP_CONNECT_IND_T;
+typedef struct { SPP *spp; rfcomm_connect_status status; Sink sink; uint16 payload_size; } SPP_CONNECT_CFM_T;
+typedef struct { SPP *spp; spp_disconnect_status status; } SPP_DISCONNECT_IND_T;
+
+typedef struct {
+	uint16	client_recipe;
+	uint16	size_service_record;
+	void	*service_record;
+	uint16	no_service_record;
+} spp_init_params;
+
+void SppInitLazy(Task client, Task connection, const spp_init_params *config);
+void SppConnectResponseLazy(SPP *spp, bool response, const bdaddr *bd_addr, uint8 local_server_channel, uint16 max_payload_size);
+void SppDisconnect(SPP *spp);
+
+#endif /** SPP_H **/
@@ -0,0 +1,38 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <message_.h>
+#include <sink.h>
+#include <source.h>
+
+#define VM_STREAM_UART_CONFIG		1
+#define VM_STREAM_UART_THROUGHPUT	2
+
+/** raw uart divisors, one step is 10^6 / 4096 baud **/
+typedef enum {
+	VM_UART_RATE_SAME = 0,
+	VM_UART_RATE_9K6 = 39,
+	VM_UART_RATE_19K2 = 79,
+	VM_UART_RATE_38K4 = 157,
+	VM_UART_RATE_57K6 = 236,
+	VM_UART_RATE_115K2 = 472,
+	VM_UART_RATE_230K4 = 944,
+	VM_UART_RATE_460K8 = 1887,
+	VM_UART_RATE_921K6 = 3775,
+	VM_UART_RATE_1382K4 = 5662
+} vm_uart_rate;
+
+typedef enum { VM_UART_STOP_ONE, VM_UART_STOP_TWO, VM_UART_STOP_SAME } vm_uart_stop;
+typedef enum { VM_UART_PARITY_NONE, VM_UART_PARITY_ODD, VM_UART_PARITY_EVEN, VM_UART_PARITY_SAME } vm_uart_parity;
+
+Source StreamUartSource(void);
+Sink StreamUartSink(void);
+Source StreamSourceFromSink(Sink sink);
+bool StreamConnect(Source source, Sink sink);
+void StreamDisconnect(Source source, Sink sink);
+bool StreamConnectDispose(Source source);
+uint16 StreamMove(Sink sink, Source source, uint16 count);
+bool StreamConfigure(uint16 key, uint16 value);
+void StreamUartConfigure(uint16 rate, uint16 stop, uint16 parity);
+
+#endif /** STREAM_H **/
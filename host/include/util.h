@@ -0,0 +1,12 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <csrtypes.h>
+
+/** the first of count elements size apart from address + offset whose word under mask is value, 0 if none **/
+const uint16 *UtilFind(uint16 mask, uint16 value, const uint16 *address, uint16 offset, uint16 size, uint16 count);
+
+/** decimal number at start, returns the end of it or 0 if there is none **/
+const uint8 *UtilGetNumber(const uint8 *start, const uint8 *end, uint16 *result);
+
+#endif /** UTIL_H **/
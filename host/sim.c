@@ -0,0 +1,775 @@
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include <panic.h>
+#include <pio.h>
+#include <ps.h>
+#include <vm.h>
+#include <boot.h>
+#include <bdaddr.h>
+#include <battery.h>
+#include <util.h>
+#include <adc.h>
+#include <app/message/system_message.h>
+
+#include "sim_private.h"
+
+#define SIM_QUEUE			4096		/** messages and events pending at once **/
+#define SIM_PS_KEYS			64
+#define SIM_PS_SIZE			64
+
+typedef struct sim_entry {
+
+	struct sim_entry	*next;
+	sim_time_t			due;
+	uint32				seq;
+
+	/** a message if task is set, an event otherwise **/
+	Task				task;
+	MessageId			id;
+	void				*payload;
+	const uint16		*condition;
+
+	sim_fn				fn;
+	void				*ctx;
+
+} sim_entry_t;
+
+sim_config_t sim_config;
+sim_counters_t sim_counters;
+void (*sim_pio_hook)(uint16 changed, uint16 levels);
+
+static struct {
+
+	sim_time_t		now;
+	uint32			seq;
+
+	sim_entry_t		pool[SIM_QUEUE];
+	sim_entry_t		*free;
+	sim_entry_t		*queue;			/** by due, then seq **/
+
+	bool			stop;
+	sim_time_t		loop_limit;
+	jmp_buf			panic_jump;
+	bool			running;
+	bool			trace;			/** SIM_TRACE set in the environment, every delivery on stderr **/
+
+	/** pios **/
+	uint16			inputs;
+	uint16			outputs;
+	uint16			dirs;
+	uint16			debounce;
+	Task			pio_task;
+
+	/** battery library **/
+	uint32			battery_mv;
+	BatteryState	*battery;
+	uint16			battery_generation;
+
+	/** persistent store **/
+	struct {
+		uint16		length;
+		uint8		data[SIM_PS_SIZE];
+	} ps[SIM_PS_KEYS];
+
+} sim;
+
+
+/**************************************************************************************************
+
+  queue and clock
+
+  */
+
+void simReset(void) {
+
+	uint16 i;
+
+	memset(&sim, 0, sizeof(sim));
+	memset(&sim_counters, 0, sizeof(sim_counters));
+
+	for (i = 0; i < SIM_QUEUE; i++) {
+
+		sim.pool[i].next = sim.free;
+		sim.free = &sim.pool[i];
+	}
+
+	sim.loop_limit = SIM_SEC(3600);
+	sim.trace = getenv("SIM_TRACE") != 0;
+	sim.battery_mv = 1622;		/** 4.0 V at the battery through the 22k / 15k divider **/
+
+	sim_config.handler_us = 0;
+	sim_config.uart_buffer = 512;
+	sim_config.spp_buffer = 672;
+	sim_config.spp_latency_us = 5000;
+	sim_config.spp_bytes_per_s = 60000;
+
+	sim_pio_hook = 0;
+
+	simStreamReset();
+	simSppReset();
+}
+
+sim_time_t simNow(void) {
+
+	return sim.now;
+}
+
+uint32 VmGetClock(void) {
+
+	return (uint32)(sim.now / 1000);
+}
+
+static void simQueue(sim_entry_t *e, sim_time_t due) {
+
+	sim_entry_t **p = &sim.queue;
+
+	e ->due = due;
+	e ->seq = sim.seq++;
+
+	while (*p && (*p) ->due <= due) {
+
+		p = &(*p) ->next;
+	}
+
+	e ->next = *p;
+	*p = e;
+}
+
+static sim_entry_t *simEntry(void) {
+
+	sim_entry_t *e = sim.free;
+
+	if (!e) {
+
+		sim_entry_t *q;
+
+		fprintf(stderr, "sim: queue full at %llu us\n", sim.now);
+
+		for (q = sim.queue; q; q = q ->next) {
+
+			fprintf(stderr, "  %10llu us  task %p  id 0x%04x  fn %p\n", q ->due, (void*)q ->task, q ->id, (void*)q ->fn);
+		}
+		abort();
+	}
+
+	sim.free = e ->next;
+	memset(e, 0, sizeof(*e));
+
+	return e;
+}
+
+static void simRelease(sim_entry_t *e) {
+
+	e ->next = sim.free;
+	sim.free = e;
+}
+
+void simAt(sim_time_t when, sim_fn fn, void *ctx) {
+
+	sim_entry_t *e = simEntry();
+
+	e ->fn = fn;
+	e ->ctx = ctx;
+	simQueue(e, when < sim.now ? sim.now : when);
+}
+
+void simAfter(sim_time_t delay, sim_fn fn, void *ctx) {
+
+	simAt(sim.now + delay, fn, ctx);
+}
+
+void simPost(Task task, MessageId id, void *payload, sim_time_t delay) {
+
+	sim_entry_t *e = simEntry();
+
+	e ->task = task;
+	e ->id = id;
+	e ->payload = payload;
+	simQueue(e, sim.now + delay);
+}
+
+void *simPayload(size_t size) {
+
+	/** calloc, so heap checks that wrap malloc only see the firmware's own allocations **/
+	void *p = calloc(1, size);
+
+	if (!p) {
+
+		abort();
+	}
+
+	return p;
+}
+
+bool simPending(Task task, MessageId id) {
+
+	sim_entry_t *e;
+
+	for (e = sim.queue; e; e = e ->next) {
+
+		if (e ->task == task && e ->id == id) {
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+uint16 simQueued(Task task, MessageId id) {
+
+	sim_entry_t *e;
+	uint16 n = 0;
+
+	for (e = sim.queue; e; e = e ->next) {
+
+		if (e ->task && (!task || (e ->task == task && e ->id == id))) {
+
+			n++;
+		}
+	}
+
+	return n;
+}
+
+/** the first entry that can run now, conditional messages wait for their condition **/
+static sim_entry_t **simReady(sim_time_t *next) {
+
+	sim_entry_t **p;
+
+	*next = (sim_time_t)-1;
+
+	for (p = &sim.queue; *p; p = &(*p) ->next) {
+
+		sim_entry_t *e = *p;
+
+		if (e ->condition && *e ->condition) {
+
+			/** only a handler or a device can clear it, the loop looks again after each step **/
+			continue;
+		}
+
+		if (e ->due <= sim.now) {
+
+			return p;
+		}
+
+		*next = e ->due;
+		return 0;
+	}
+
+	return 0;
+}
+
+static bool simStep(sim_time_t until) {
+
+	sim_time_t next;
+	sim_entry_t **p = simReady(&next);
+	sim_entry_t *e;
+
+	if (!p) {
+
+		if (next > until) {
+
+			if (until > sim.now) {
+
+				sim.now = until;
+			}
+			return FALSE;
+		}
+
+		sim.now = next;
+		return TRUE;
+	}
+
+	e = *p;
+	*p = e ->next;
+
+	if (e ->task) {
+
+		Task task = e ->task;
+		MessageId id = e ->id;
+		void *payload = e ->payload;
+
+		simRelease(e);
+
+		sim_counters.messages++;
+
+		if (sim.trace) {
+
+			fprintf(stderr, "%10llu us  task %p  id 0x%04x\n", sim.now, (void*)task, id);
+		}
+
+		task ->handler(task, id, payload);
+		free(payload);
+
+		sim.now += sim_config.handler_us;
+	}
+	else {
+
+		sim_fn fn = e ->fn;
+		void *ctx = e ->ctx;
+
+		simRelease(e);
+		fn(ctx);
+	}
+
+	simStreamPump();
+
+	return TRUE;
+}
+
+bool simRunUntil(sim_time_t until) {
+
+	return simRunWhileNot(0, until) || !sim.running;
+}
+
+bool simRunWhileNot(bool (*done)(void), sim_time_t until) {
+
+	sim.stop = FALSE;
+	sim.running = TRUE;
+
+	if (setjmp(sim.panic_jump)) {
+
+		sim.running = FALSE;
+		return FALSE;
+	}
+
+	while (!sim.stop) {
+
+		if (done && done()) {
+
+			return TRUE;
+		}
+
+		if (!simStep(until)) {
+
+			break;
+		}
+	}
+
+	return done ? done() : TRUE;
+}
+
+void simSetLoopLimit(sim_time_t until) {
+
+	sim.loop_limit = until;
+}
+
+void simStop(void) {
+
+	sim.stop = TRUE;
+}
+
+void MessageLoop(void) {
+
+	(void)simRunUntil(sim.loop_limit);
+}
+
+
+/**************************************************************************************************
+
+  message api
+
+  */
+
+void MessageSend(Task task, MessageId id, void *message) {
+
+	MessageSendLater(task, id, message, 0);
+}
+
+void MessageSendLater(Task task, MessageId id, void *message, uint32 delay) {
+
+	if (!task) {
+
+		free(message);
+		return;
+	}
+
+	simPost(task, id, message, SIM_MS(delay));
+}
+
+void MessageSendConditionally(Task task, MessageId id, void *message, const uint16 *condition) {
+
+	sim_entry_t *e;
+
+	if (!task) {
+
+		free(message);
+		return;
+	}
+
+	e = simEntry();
+	e ->task = task;
+	e ->id = id;
+	e ->payload = message;
+	e ->condition = condition;
+	simQueue(e, sim.now);
+}
+
+static uint16 simCancel(Task task, MessageId id, bool all, bool any_id) {
+
+	sim_entry_t **p = &sim.queue;
+	uint16 n = 0;
+
+	while (*p) {
+
+		sim_entry_t *e = *p;
+
+		if (e ->task == task && (any_id || e ->id == id)) {
+
+			*p = e ->next;
+			free(e ->payload);
+			simRelease(e);
+			n++;
+
+			if (!all) {
+
+				break;
+			}
+		}
+		else {
+
+			p = &e ->next;
+		}
+	}
+
+	return n;
+}
+
+uint16 MessageCancelAll(Task task, MessageId id) {
+
+	return simCancel(task, id, TRUE, FALSE);
+}
+
+bool MessageCancelFirst(Task task, MessageId id) {
+
+	return simCancel(task, id, FALSE, FALSE) != 0;
+}
+
+uint16 MessageFlushTask(Task task) {
+
+	return simCancel(task, 0, TRUE, TRUE);
+}
+
+
+/**************************************************************************************************
+
+  panic and boot
+
+  */
+
+void Panic(void) {
+
+	sim_counters.panics++;
+
+	if (sim.running) {
+
+		longjmp(sim.panic_jump, 1);
+	}
+
+	fprintf(stderr, "sim: panic outside the message loop\n");
+	abort();
+}
+
+void *PanicNull(void *p) {
+
+	if (!p) {
+
+		Panic();
+	}
+
+	return p;
+}
+
+/**************************************************************************************************
+
+  util, what the genparse output uses
+
+  */
+
+const uint16 *UtilFind(uint16 mask, uint16 value, const uint16 *address, uint16 offset, uint16 size, uint16 count) {
+
+	/** on the xap a char is a word, the searches are all over chars. sizes are in sizeof() units,
+		so here the byte at the start of each element is compared **/
+	const uint8 *p = (const uint8*)address + offset;
+
+	for (; count; count--, p += size) {
+
+		if ((*p & mask) == value) {
+
+			return (const uint16*)p;
+		}
+	}
+
+	return 0;
+}
+
+const uint8 *UtilGetNumber(const uint8 *start, const uint8 *end, uint16 *result) {
+
+	const uint8 *p = start;
+	uint16 v = 0;
+
+	while (p != end && *p >= '0' && *p <= '9') {
+
+		v = v * 10 + (*p++ - '0');
+	}
+
+	if (p == start) {
+
+		return 0;
+	}
+
+	*result = v;
+
+	return p;
+}
+
+void BootSetMode(uint16 mode) {
+
+	/** the chip reboots, the simulation of this boot is over **/
+	mode = mode;
+	sim_counters.boot_mode_sets++;
+	sim.stop = TRUE;
+}
+
+
+/**************************************************************************************************
+
+  pios
+
+  */
+
+static void simPioUpdate(uint16 outputs, uint16 dirs) {
+
+	uint16 before = sim.outputs & sim.dirs;
+	uint16 after = outputs & dirs;
+	uint16 turned = sim.dirs ^ dirs;
+	bool bus = ((sim.outputs ^ outputs) | turned) != 0;
+
+	sim.outputs = outputs;
+	sim.dirs = dirs;
+
+	if (before != after) {
+
+		sim_counters.pio_writes++;
+	}
+
+	if ((before ^ after) | turned) {
+
+		if (sim_pio_hook) {
+
+			sim_pio_hook((before ^ after) | turned, after);
+		}
+	}
+
+	if (bus) {
+
+		simUartPioChanged();
+	}
+}
+
+uint16 PioGet(void) {
+
+	return (sim.outputs & sim.dirs) | (sim.inputs & ~sim.dirs);
+}
+
+uint16 PioSet(uint16 mask, uint16 bits) {
+
+	simPioUpdate((sim.outputs & ~mask) | (bits & mask), sim.dirs);
+	return 0;
+}
+
+uint16 PioSetDir(uint16 mask, uint16 dir) {
+
+	simPioUpdate(sim.outputs, (sim.dirs & ~mask) | (dir & mask));
+	return 0;
+}
+
+uint16 PioDebounce(uint16 mask, uint16 count, uint16 period) {
+
+	count = count; period = period;
+	sim.debounce = mask;
+	return 0;
+}
+
+bool PioSetLed0(bool on) {
+
+	simPioUpdate(on ? sim.outputs | 0x8000 : sim.outputs & ~0x8000, sim.dirs | 0x8000);
+	return TRUE;
+}
+
+bool PioSetLed1(bool on) {
+
+	simPioUpdate(on ? sim.outputs | 0x4000 : sim.outputs & ~0x4000, sim.dirs | 0x4000);
+	return TRUE;
+}
+
+Task MessagePioTask(Task task) {
+
+	Task old = sim.pio_task;
+
+	sim.pio_task = task;
+	return old;
+}
+
+void simPioInput(uint16 mask, uint16 bits) {
+
+	uint16 changed = (sim.inputs ^ bits) & mask;
+
+	sim.inputs = (sim.inputs & ~mask) | (bits & mask);
+
+	if ((changed & sim.debounce) && sim.pio_task) {
+
+		MessagePioChanged *m = simPayload(sizeof(MessagePioChanged));
+
+		/** the debounced pins only, like the chip reports them **/
+		m ->state = PioGet() & sim.debounce;
+		m ->time = VmGetClock();
+		simPost(sim.pio_task, MESSAGE_PIO_CHANGED, m, 0);
+	}
+}
+
+uint16 simPioOutput(void) {
+
+	return sim.outputs;
+}
+
+uint16 simPioDirection(void) {
+
+	return sim.dirs;
+}
+
+
+/**************************************************************************************************
+
+  battery and adc
+
+  */
+
+typedef struct {
+
+	BatteryState	*state;
+	uint16			generation;
+
+} sim_battery_tick_t;
+
+static sim_battery_tick_t battery_tick;
+
+static void simBatteryReading(void *ctx) {
+
+	sim_battery_tick_t *t = (sim_battery_tick_t*)ctx;
+	uint32 *mv;
+
+	/** a later BatteryInit() replaced this polling **/
+	if (t ->generation != sim.battery_generation) {
+
+		return;
+	}
+
+	/** the library is linked into the application and allocates each reading from its heap **/
+	mv = malloc(sizeof(uint32));
+
+	if (!mv) {
+
+		abort();
+	}
+
+	*mv = sim.battery_mv;
+	sim_counters.battery_readings++;
+	simPost(t ->state ->client, BATTERY_READING_MESSAGE, mv, 0);
+
+	if (t ->state ->period) {
+
+		simAfter(SIM_MS(t ->state ->period), simBatteryReading, t);
+	}
+}
+
+void BatteryInit(BatteryState *state, Task task, battery_reading_source source, uint16 period) {
+
+	state ->client = task;
+	state ->source = source;
+	state ->period = period;
+
+	battery_tick.state = state;
+	battery_tick.generation = ++sim.battery_generation;
+
+	simAfter(SIM_MS(10), simBatteryReading, &battery_tick);
+}
+
+void simBatteryMv(uint32 mv) {
+
+	sim.battery_mv = mv;
+}
+
+bool AdcRequest(Task task, vm_adc_source_type adc) {
+
+	MessageAdcResult *m = simPayload(sizeof(MessageAdcResult));
+
+	/** 8 bits over 1.8 V, vref is the 1.25 V the probe scales by, any other source the battery divider **/
+	m ->adc_source = adc;
+	m ->reading = (uint16)((adc == VM_ADC_SRC_VREF ? 1250 : sim.battery_mv) * 255 / 1800);
+	simPost(task, MESSAGE_ADC_RESULT, m, SIM_MS(1));
+
+	return TRUE;
+}
+
+
+/**************************************************************************************************
+
+  persistent store and bdaddr
+
+  */
+
+uint16 PsStore(uint16 key, const void *buff, uint16 words) {
+
+	if (key >= SIM_PS_KEYS || words > SIM_PS_SIZE) {
+
+		return 0;
+	}
+
+	memcpy(sim.ps[key].data, buff, words);
+	sim.ps[key].length = words;
+
+	return words;
+}
+
+uint16 PsRetrieve(uint16 key, void *buff, uint16 words) {
+
+	if (key >= SIM_PS_KEYS || sim.ps[key].length == 0) {
+
+		return 0;
+	}
+
+	if (words == 0) {
+
+		return sim.ps[key].length;
+	}
+
+	if (words < sim.ps[key].length) {
+
+		return 0;
+	}
+
+	memcpy(buff, sim.ps[key].data, sim.ps[key].length);
+
+	return sim.ps[key].length;
+}
+
+uint16 PsFullRetrieve(uint16 key, void *buff, uint16 words) {
+
+	/** no factory keys are modelled **/
+	return key == PSKEY_PIO_WAKEUP_STATE ? 0 : PsRetrieve(key, buff, words);
+}
+
+void simPsClear(void) {
+
+	memset(sim.ps, 0, sizeof(sim.ps));
+}
+
+bool BdaddrIsSame(const bdaddr *first, const bdaddr *second) {
+
+	return first ->lap == second ->lap && first ->uap == second ->uap && first ->nap == second ->nap;
+}
@@ -0,0 +1,241 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <csrtypes.h>
+#include <message.h>
+#include <bdaddr_.h>
+
+/**************************************
+
+  discrete event simulator of the BlueLab vm for host builds of the firmware.
+
+  the firmware sources are compiled unchanged against the headers in host/include and linked with
+  this library, which implements the message loop, streams, pios, persistent store, battery, and the
+  connection and spp libraries on a virtual clock. nothing waits for real time, a run of minutes
+  takes milliseconds.
+
+  time is kept in microseconds, VmGetClock() is that divided by 1000. a message is delivered at its
+  due time, messages due at the same time in the order they were sent, a conditional message once
+  its condition word is 0. peers and devices schedule plain callbacks on the same clock with
+  simAt() / simAfter(). handlers take no virtual time unless sim_config.handler_us says otherwise.
+
+  scripted peers stand at both ends of the bridge:
+
+	phone		an spp client, connects, sends bytes in rfcomm packets of the negotiated payload
+				size, sim_phone.rx collects what the bridge sends back
+	uart		the controller, sends bytes at its own line settings and receives what the bridge
+				puts on the wire. the bus follows the rs-485 direction pio, bytes the bridge sends
+				with the driver off are lost and bytes arriving while it drives the bus collide
+
+  **************************************/
+
+typedef unsigned long long sim_time_t;		/** microseconds **/
+
+#define SIM_MS(ms)					((sim_time_t)(ms) * 1000)
+#define SIM_SEC(s)					((sim_time_t)(s) * 1000000)
+
+typedef void (*sim_fn)(void *ctx);
+
+typedef struct {
+
+	uint32		handler_us;			/** virtual time taken by each handler call **/
+
+	uint16		uart_buffer;		/** uart sink and source size **/
+	uint16		spp_buffer;			/** spp sink and source size **/
+
+	uint32		spp_latency_us;		/** one way air latency of an rfcomm packet **/
+	uint32		spp_bytes_per_s;	/** air throughput of the link in each direction **/
+
+} sim_config_t;
+
+typedef struct {
+
+	uint32		messages;			/** handler calls **/
+	uint32		pio_writes;			/** PioSet() calls that changed an output **/
+	uint32		panics;
+	uint32		boot_mode_sets;
+	uint32		battery_readings;	/** BATTERY_READING_MESSAGEs, each one allocated by the library **/
+
+} sim_counters_t;
+
+extern sim_config_t sim_config;
+extern sim_counters_t sim_counters;
+
+/** fresh simulation at time 0 with the default configuration. the firmware keeps its static
+	state, so each program simulates one boot **/
+void simReset(void);
+
+sim_time_t simNow(void);
+
+/** ctx is passed back to fn, events at the same time run in the order they were set **/
+void simAt(sim_time_t when, sim_fn fn, void *ctx);
+void simAfter(sim_time_t delay, sim_fn fn, void *ctx);
+
+/** run messages and events up to until, FALSE if the firmware panicked **/
+bool simRunUntil(sim_time_t until);
+
+/** run until done() returns TRUE or until is reached, FALSE if it wasn't done **/
+bool simRunWhileNot(bool (*done)(void), sim_time_t until);
+
+/** MessageLoop() runs until simStop(), this time or a panic **/
+void simSetLoopLimit(sim_time_t until);
+void simStop(void);
+
+/** number of queued messages for task and id, both 0 for all **/
+uint16 simQueued(Task task, MessageId id);
+
+
+/**************************************
+  pios
+  **************************************/
+
+/** levels of the input pins, the pio task gets MESSAGE_PIO_CHANGED for debounced pins **/
+void simPioInput(uint16 mask, uint16 bits);
+
+uint16 simPioOutput(void);					/** levels written with PioSet() **/
+uint16 simPioDirection(void);				/** 1 for pins driven **/
+
+/** called on every change of a driven level or of a pin direction, for waveform checks. levels are the
+	driven ones, simPioDirection() tells a pin driven low from a released one **/
+extern void (*sim_pio_hook)(uint16 changed, uint16 levels);
+
+/** mV at the battery divider, reported by the battery library and read by AdcRequest() **/
+void simBatteryMv(uint32 mv);
+
+/** forget everything in persistent store **/
+void simPsClear(void);
+
+
+/**************************************
+  uart and rs-485 bus
+  **************************************/
+
+typedef enum {
+
+	SIM_BUS_FULL_DUPLEX,			/** rs-232, no direction control **/
+	SIM_BUS_DRIVE_HIGH,				/** rs-485, driver on while PIO3 is driven high **/
+	SIM_BUS_DRIVE_LOW				/** rs-485, driver on while PIO3 is driven low **/
+
+} sim_bus_t;
+
+typedef struct {
+
+	/** controller line settings, AT+CONNECT encoding of parity and stop **/
+	uint32		baud;
+	uint16		parity;
+	uint16		stop;
+
+	sim_bus_t	bus;
+
+	/** every byte the controller received, with the time its stop bit ended **/
+	void		(*rx)(uint8 byte, sim_time_t end);
+
+	/** counters **/
+	uint32		rx_bytes;
+	uint32		tx_bytes;
+	uint32		lost;				/** bridge sent with its driver off **/
+	uint32		collisions;			/** controller sent while the bridge drove the bus **/
+	uint32		overruns;			/** uart source full **/
+	uint32		claimed;			/** bytes the firmware wrote into the uart sink itself rather than StreamMove()d **/
+	uint32		mismatched;			/** bridge and controller line settings differ **/
+
+	/** bridge side **/
+	sim_time_t	driver_on_us;		/** total time the bridge drove the bus **/
+
+} sim_uart_t;
+
+extern sim_uart_t sim_uart;
+
+/** the controller sends len bytes back-to-back, after whatever it is still sending **/
+void simUartSend(const uint8 *data, uint16 len);
+
+/** TRUE while the controller is sending **/
+bool simUartBusy(void);
+
+/** line settings last given to StreamUartConfigure(), baud from the raw divisor **/
+uint32 simUartBridgeBaud(void);
+uint16 simUartBridgeParity(void);
+
+/** bytes the bridge's uart receiver makes of len bytes sent at the controller settings, sampled bit by
+	bit at the bridge settings. returns the number of bytes in out **/
+uint16 simUartSample(const uint8 *data, uint16 len, uint32 baud, uint16 parity, uint16 stop,
+					 uint32 rx_baud, uint16 rx_parity, uint16 rx_stop, uint8 *out, uint16 max);
+
+
+/**************************************
+  phone, the spp peer
+  **************************************/
+
+typedef struct {
+
+	bdaddr		addr;
+	uint16		frame_size;			/** rfcomm payload size offered on connect **/
+
+	bool		connected;
+
+	/** every packet the phone received **/
+	void		(*rx)(const uint8 *data, uint16 len, sim_time_t when);
+
+	/** counters **/
+	uint32		tx_packets;
+	uint32		tx_bytes;
+	uint32		rx_packets;
+	uint32		rx_bytes;
+
+} sim_phone_t;
+
+extern sim_phone_t sim_phone;
+
+/** page the bridge, SPP_CONNECT_IND is sent to the firmware **/
+void simPhoneConnect(void);
+void simPhoneDisconnect(void);
+
+/** queue len bytes to send, they go in packets of up to frame_size as flow control allows **/
+void simPhoneSend(const uint8 *data, uint16 len);
+
+/** bytes queued at the phone and not accepted by the bridge yet **/
+uint16 simPhonePending(void);
+
+/** scan parameters last written by the firmware **/
+typedef struct {
+
+	uint16		enable;				/** hci_scan_enable **/
+	uint16		inquiry_interval;
+	uint16		inquiry_window;
+	uint16		page_interval;
+	uint16		page_window;
+	uint16		inquiry_type;
+	uint16		page_type;
+
+} sim_scan_t;
+
+extern sim_scan_t sim_scan;
+
+/** called whenever the firmware writes scan parameters **/
+extern void (*sim_scan_hook)(void);
+
+
+/**************************************
+  bridge, the firmware under test
+  **************************************/
+
+/** what main() does before MessageLoop() **/
+void simBridgeInit(void);
+
+/** charger plugged, power button held until the bridge is pairable, FALSE if it never was **/
+bool simBridgePowerOn(void);
+
+/** the phone connects and the bridge reaches echo state, or pipe with a stored profile **/
+bool simBridgeConnect(void);
+
+/** send one AT command line from the phone and run until the reply is in, returns the reply **/
+const char *simBridgeCommand(const char *line);
+
+/** AT+CONNECT with these arguments, the controller is set to the same line and bus. TRUE if the bridge
+	answered OK and is in pipe state **/
+bool simBridgePipe(uint16 baudrate, uint16 stop, uint16 parity, uint16 polarity, uint16 keeptime);
+
+/** bytes the phone received since the last call, NUL terminated **/
+const char *simPhoneTake(uint16 *len);
+
+#endif /** SIM_H **/
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <connection.h>
+#include <spp.h>
+
+#include "hal.h"
+#include "sppb.h"
+
+#include "sim_private.h"
+
+#define PIO_POWER_BUTTON		(1 << 4)
+#define PIO_CHARGER				(1 << 10)
+
+void simBridgeInit(void) {
+
+	hal_init(getSppbTask());
+	sppb_init(getHalTask());
+}
+
+static bool bridgePairable(void) {
+
+	return sim_scan.enable != hci_scan_enable_off;
+}
+
+bool simBridgePowerOn(void) {
+
+	bool pairable;
+
+	/** the charger is plugged so a flat simulated battery doesn't stop the boot **/
+	simPioInput(PIO_CHARGER, PIO_CHARGER);
+	(void)simRunUntil(simNow() + SIM_MS(100));
+
+	simPioInput(PIO_POWER_BUTTON, PIO_POWER_BUTTON);
+	pairable = simRunWhileNot(bridgePairable, simNow() + SIM_SEC(5));
+
+	/** released before the long press powers the module down **/
+	simPioInput(PIO_POWER_BUTTON, 0);
+	(void)simRunUntil(simNow() + SIM_MS(100));
+
+	return pairable && bridgePairable();
+}
+
+static bool bridgeSettled(void) {
+
+	return sim_spp_port.valid && !simPending(getSppbTask(), SPP_CONNECT_CFM);
+}
+
+bool simBridgeConnect(void) {
+
+	simPhoneConnect();
+
+	if (!simRunWhileNot(bridgeSettled, simNow() + SIM_SEC(1)) || !sim_spp_port.valid) {
+
+		return FALSE;
+	}
+
+	/** the echo or pipe state it started settles **/
+	(void)simRunUntil(simNow() + SIM_MS(10));
+
+	return sim_spp_port.valid;
+}
+
+/** a final result line closes every reply **/
+static bool bridgeReplied(void) {
+
+	const char *p = simPhonePeek();
+	uint16 n = strlen(p);
+	static const char *const finals[] = { "OK\r\n", "ERROR\r\n", "UNRECOGNIZED\r\n" };
+	uint16 i;
+
+	for (i = 0; i < sizeof(finals) / sizeof(finals[0]); i++) {
+
+		uint16 f = strlen(finals[i]);
+
+		if (n >= f && !strcmp(p + n - f, finals[i])) {
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+const char *simBridgeCommand(const char *line) {
+
+	(void)simPhoneTake(0);
+	simPhoneSend((const uint8*)line, strlen(line));
+
+	/** an auto-baud search takes a while, a plain command a few ms **/
+	(void)simRunWhileNot(bridgeReplied, simNow() + SIM_SEC(30));
+
+	return simPhoneTake(0);
+}
+
+bool simBridgePipe(uint16 baudrate, uint16 stop, uint16 parity, uint16 polarity, uint16 keeptime) {
+
+	char line[48];
+	const char *reply;
+
+	sim_uart.baud = (uint32)baudrate * 100;
+	sim_uart.stop = stop;
+	sim_uart.parity = parity;
+	sim_uart.bus = polarity == 0 ? SIM_BUS_DRIVE_LOW : polarity == 1 ? SIM_BUS_DRIVE_HIGH : SIM_BUS_FULL_DUPLEX;
+
+	sprintf(line, "AT+CONNECT=%u,%u,%u,%u,%u\r\n", baudrate, stop, parity, polarity, keeptime);
+	reply = simBridgeCommand(line);
+
+	/** the reply is out before the switch to pipe, let it happen **/
+	(void)simRunUntil(simNow() + SIM_MS(5));
+
+	return strstr(reply, "OK\r\n") != 0;
+}
@@ -0,0 +1,88 @@
+#ifndef SIM_PRIVATE_H
+#define SIM_PRIVATE_H
+
+#include "sim.h"
+
+/**************************************
+
+  shared between the simulator modules, not for tests
+
+  **************************************/
+
+#define SIM_BUFFER_MAX		4096
+
+/** one direction of a stream, committed bytes first, then the region claimed by the writer **/
+typedef struct {
+
+	uint8		data[SIM_BUFFER_MAX];
+	uint16		used;
+	uint16		claimed;
+
+} sim_buffer_t;
+
+typedef struct sim_port sim_port_t;
+
+struct SINK_T { sim_port_t *port; };
+struct SOURCE_T { sim_port_t *port; };
+
+/** a pair of streams between the firmware and a device, the uart or the spp channel **/
+struct sim_port {
+
+	struct SINK_T	sink;			/** firmware -> device **/
+	struct SOURCE_T	source;			/** device -> firmware **/
+
+	sim_buffer_t	tx;
+	sim_buffer_t	rx;
+	uint16			*capacity;		/** of each direction, from sim_config **/
+
+	bool			valid;
+
+	/** messages to the firmware **/
+	Task			task;
+	MessageId		more_data;
+	MessageId		more_space;
+	bool			data_messages;
+	bool			space_messages;
+	bool			new_data;		/** device added to rx since the last message **/
+	bool			new_space;		/** device took from tx since the last message **/
+
+	/** firmware connections of the source **/
+	Sink			connected;
+	bool			disposed;
+
+	/** the device looks at the buffers again **/
+	void			(*kick)(void);
+};
+
+void simPortInit(sim_port_t *port, uint16 *capacity, MessageId more_data, MessageId more_space, void (*kick)(void));
+
+/** device side of the buffers **/
+uint16 simPortRxSpace(const sim_port_t *port);
+void simPortRxPut(sim_port_t *port, const uint8 *data, uint16 len);
+uint16 simPortTxTake(sim_port_t *port, uint8 *data, uint16 max);
+
+/** queue a message from the simulated firmware or libraries, payload is freed after delivery **/
+void simPost(Task task, MessageId id, void *payload, sim_time_t delay);
+
+/** TRUE if a message with this id is queued for task **/
+bool simPending(Task task, MessageId id);
+
+/** payload for a library message, freed by the loop like the firmware's own **/
+void *simPayload(size_t size);
+
+/** pio outputs changed, the bus follows the direction pio **/
+void simUartPioChanged(void);
+
+/** a stream buffer changed, run the firmware connections between streams **/
+void simStreamPump(void);
+
+void simStreamReset(void);
+void simSppReset(void);
+
+/** everything the phone received since the last simPhoneTake(), NUL terminated **/
+const char *simPhonePeek(void);
+
+/** the spp channel, pumped with the uart **/
+extern sim_port_t sim_spp_port;
+
+#endif /** SIM_PRIVATE_H **/
@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <connection.h>
+#include <spp.h>
+
+#include "sim_private.h"
+
+#define PHONE_QUEUE			65536
+
+struct SPP_T { uint16 channel; };
+
+sim_phone_t sim_phone;
+sim_scan_t sim_scan;
+void (*sim_scan_hook)(void);
+
+sim_port_t sim_spp_port;
+
+static struct {
+
+	struct SPP_T	spp;
+	Task			cl_task;
+	Task			client;
+
+	/** phone -> bridge **/
+	uint8			queue[PHONE_QUEUE];
+	uint32			head;
+	uint32			tail;
+	bool			sending;
+	uint16			in_flight;		/** sent and not in the bridge source yet, rfcomm credits cover these **/
+
+	/** bridge -> phone **/
+	bool			receiving;
+
+	/** what the phone got, for simPhoneTake() **/
+	char			taken[PHONE_QUEUE];
+	uint16			taken_len;
+
+	/** a disconnect or a new connection makes packets in the air stale **/
+	uint16			session;
+
+} spp;
+
+typedef struct {
+
+	uint16		session;
+	uint16		len;
+	uint8		data[SIM_BUFFER_MAX];
+
+} packet_t;
+
+static void sppKick(void);
+
+
+/**************************************************************************************************
+
+  connection library
+
+  */
+
+void ConnectionInit(Task task) {
+
+	CL_INIT_CFM_T *cfm = simPayload(sizeof(CL_INIT_CFM_T));
+
+	spp.cl_task = task;
+	cfm ->status = success;
+	simPost(task, CL_INIT_CFM, cfm, SIM_MS(5));
+}
+
+static void scanChanged(void) {
+
+	if (sim_scan_hook) {
+
+		sim_scan_hook();
+	}
+}
+
+void ConnectionWriteScanEnable(hci_scan_enable mode) {
+
+	sim_scan.enable = mode;
+	scanChanged();
+}
+
+void ConnectionWriteInquiryscanActivity(uint16 interval, uint16 window) {
+
+	sim_scan.inquiry_interval = interval;
+	sim_scan.inquiry_window = window;
+	scanChanged();
+}
+
+void ConnectionWritePagescanActivity(uint16 interval, uint16 window) {
+
+	sim_scan.page_interval = interval;
+	sim_scan.page_window = window;
+	scanChanged();
+}
+
+void ConnectionWriteInquiryScanType(hci_scan_type type) {
+
+	sim_scan.inquiry_type = type;
+	scanChanged();
+}
+
+void ConnectionWritePageScanType(hci_scan_type type) {
+
+	sim_scan.page_type = type;
+	scanChanged();
+}
+
+void ConnectionReadRemoteSuppFeatures(Task task, Sink sink) {
+
+	CL_DM_REMOTE_FEATURES_CFM_T *cfm = simPayload(sizeof(CL_DM_REMOTE_FEATURES_CFM_T));
+
+	sink = sink;
+	cfm ->status = hci_success;
+	cfm ->features[2] = 0x0200;		/** sniff subrating **/
+	simPost(task, CL_DM_REMOTE_FEATURES_CFM, cfm, SIM_MS(20));
+}
+
+void ConnectionSmRegisterIncomingService(uint16 protocol_id, uint32 channel, uint16 security) {
+
+	protocol_id = protocol_id; channel = channel; security = security;
+}
+
+void ConnectionWriteClassOfDevice(uint32 cod) {
+
+	cod = cod;
+}
+
+void ConnectionSmSetSdpSecurityIn(bool enable) {
+
+	enable = enable;
+}
+
+void ConnectionSetLinkPolicy(Sink sink, uint16 size, const lp_power_table *table) {
+
+	sink = sink; size = size; table = table;
+}
+
+void ConnectionSetSniffSubRatePolicy(Sink sink, uint16 max_remote_latency, uint16 min_remote_timeout, uint16 min_local_timeout) {
+
+	sink = sink; max_remote_latency = max_remote_latency; min_remote_timeout = min_remote_timeout; min_local_timeout = min_local_timeout;
+}
+
+void ConnectionSmPinCodeResponse(const bdaddr *bd_addr, uint16 length, const uint8 *pin) {
+
+	bd_addr = bd_addr; length = length; pin = pin;
+}
+
+void ConnectionSmAuthoriseResponse(const bdaddr *bd_addr, uint16 protocol_id, uint32 channel, bool incoming, bool authorised) {
+
+	bd_addr = bd_addr; protocol_id = protocol_id; channel = channel; incoming = incoming; authorised = authorised;
+}
+
+void ConnectionSmSetTrustLevel(const bdaddr *bd_addr, bool trusted) {
+
+	bd_addr = bd_addr; trusted = trusted;
+}
+
+void ConnectionSmIoCapabilityResponse(const bdaddr *bd_addr, uint16 io_capability, bool force_mitm, bool bonding, bool oob_data_present, uint8 *oob_hash_c, uint8 *oob_rand_r) {
+
+	bd_addr = bd_addr; io_capability = io_capability; force_mitm = force_mitm; bonding = bonding;
+	oob_data_present = oob_data_present; oob_hash_c = oob_hash_c; oob_rand_r = oob_rand_r;
+}
+
+
+/**************************************************************************************************
+
+  spp library
+
+  */
+
+void SppInitLazy(Task client, Task connection, const spp_init_params *config) {
+
+	SPP_INIT_CFM_T *cfm = simPayload(sizeof(SPP_INIT_CFM_T));
+
+	connection = connection; config = config;
+	spp.client = client;
+	cfm ->status = spp_init_success;
+	simPost(client, SPP_INIT_CFM, cfm, SIM_MS(5));
+}
+
+void SppConnectResponseLazy(SPP *handle, bool response, const bdaddr *bd_addr, uint8 local_server_channel, uint16 max_payload_size) {
+
+	SPP_CONNECT_CFM_T *cfm;
+
+	bd_addr = bd_addr; local_server_channel = local_server_channel;
+
+	if (!response) {
+
+		sim_phone.connected = FALSE;
+		return;
+	}
+
+	/** 0 leaves the frame size to the library, the phone's offer stands **/
+	if (max_payload_size && sim_phone.frame_size > max_payload_size) {
+
+		sim_phone.frame_size = max_payload_size;
+	}
+
+	cfm = simPayload(sizeof(SPP_CONNECT_CFM_T));
+	cfm ->spp = handle;
+	cfm ->status = rfcomm_connect_success;
+	cfm ->sink = &sim_spp_port.sink;
+	cfm ->payload_size = sim_phone.frame_size;
+
+	sim_spp_port.valid = TRUE;
+	sim_spp_port.task = spp.client;
+
+	simPost(spp.client, SPP_CONNECT_CFM, cfm, sim_config.spp_latency_us);
+}
+
+static void sppClosed(spp_disconnect_status status) {
+
+	SPP_DISCONNECT_IND_T *ind = simPayload(sizeof(SPP_DISCONNECT_IND_T));
+
+	sim_phone.connected = FALSE;
+	sim_spp_port.valid = FALSE;
+	sim_spp_port.tx.used = sim_spp_port.tx.claimed = sim_spp_port.rx.used = 0;
+	sim_spp_port.connected = 0;
+	sim_spp_port.disposed = FALSE;
+
+	spp.session++;
+	spp.head = spp.tail;
+	spp.in_flight = 0;
+	spp.sending = spp.receiving = FALSE;
+
+	ind ->spp = &spp.spp;
+	ind ->status = status;
+	simPost(spp.client, SPP_DISCONNECT_IND, ind, SIM_MS(10));
+}
+
+void SppDisconnect(SPP *handle) {
+
+	handle = handle;
+
+	if (sim_spp_port.valid) {
+
+		sppClosed(spp_disconnect_success);
+	}
+}
+
+
+/**************************************************************************************************
+
+  phone
+
+  */
+
+void simPhoneConnect(void) {
+
+	SPP_CONNECT_IND_T *ind = simPayload(sizeof(SPP_CONNECT_IND_T));
+
+	sim_phone.connected = TRUE;
+
+	ind ->spp = &spp.spp;
+	ind ->addr = sim_phone.addr;
+	ind ->server_channel = 1;
+	ind ->frame_size = sim_phone.frame_size;
+	simPost(spp.client, SPP_CONNECT_IND, ind, sim_config.spp_latency_us);
+}
+
+void simPhoneDisconnect(void) {
+
+	if (sim_spp_port.valid) {
+
+		sppClosed(spp_disconnect_link_loss);
+	}
+}
+
+static sim_time_t airTime(uint16 len) {
+
+	return (sim_time_t)len * 1000000 / (sim_config.spp_bytes_per_s ? sim_config.spp_bytes_per_s : 1);
+}
+
+static void phonePacketArrived(void *ctx) {
+
+	packet_t *p = (packet_t*)ctx;
+
+	if (p ->session == spp.session) {
+
+		spp.in_flight -= p ->len;
+		simPortRxPut(&sim_spp_port, p ->data, p ->len);
+	}
+
+	free(p);
+}
+
+static void phonePacketSent(void *ctx) {
+
+	ctx = ctx;
+	spp.sending = FALSE;
+	sppKick();
+}
+
+static void bridgePacketArrived(void *ctx) {
+
+	packet_t *p = (packet_t*)ctx;
+
+	if (p ->session == spp.session) {
+
+		uint16 room = sizeof(spp.taken) - 1 - spp.taken_len;
+		uint16 n = p ->len < room ? p ->len : room;
+
+		memcpy(spp.taken + spp.taken_len, p ->data, n);
+		spp.taken_len += n;
+		spp.taken[spp.taken_len] = 0;
+
+		sim_phone.rx_packets++;
+		sim_phone.rx_bytes += p ->len;
+
+		if (sim_phone.rx) {
+
+			sim_phone.rx(p ->data, p ->len, simNow());
+		}
+	}
+
+	free(p);
+}
+
+static void bridgePacketSent(void *ctx) {
+
+	ctx = ctx;
+	spp.receiving = FALSE;
+	sppKick();
+}
+
+/** one packet each way at a time, the air is shared by the two directions only in throughput **/
+static void sppKick(void) {
+
+	if (!sim_spp_port.valid) {
+
+		return;
+	}
+
+	if (!spp.sending && spp.head != spp.tail) {
+
+		uint32 queued = spp.tail - spp.head;
+		uint16 space = simPortRxSpace(&sim_spp_port);
+		uint16 credit = space > spp.in_flight ? space - spp.in_flight : 0;
+		uint16 len = sim_phone.frame_size;
+
+		if (len > queued) {
+
+			len = (uint16)queued;
+		}
+
+		if (len > credit) {
+
+			len = credit;
+		}
+
+		if (len) {
+
+			packet_t *p = simPayload(sizeof(packet_t));
+			uint16 i;
+
+			for (i = 0; i < len; i++) {
+
+				p ->data[i] = spp.queue[spp.head++ % PHONE_QUEUE];
+			}
+
+			p ->len = len;
+			p ->session = spp.session;
+			spp.in_flight += len;
+			spp.sending = TRUE;
+
+			sim_phone.tx_packets++;
+			sim_phone.tx_bytes += len;
+
+			simAfter(airTime(len), phonePacketSent, 0);
+			simAfter(airTime(len) + sim_config.spp_latency_us, phonePacketArrived, p);
+		}
+	}
+
+	if (!spp.receiving && sim_spp_port.tx.used) {
+
+		packet_t *p = simPayload(sizeof(packet_t));
+
+		p ->len = simPortTxTake(&sim_spp_port, p ->data, sim_phone.frame_size);
+		p ->session = spp.session;
+		spp.receiving = TRUE;
+
+		simAfter(airTime(p ->len), bridgePacketSent, 0);
+		simAfter(airTime(p ->len) + sim_config.spp_latency_us, bridgePacketArrived, p);
+	}
+}
+
+void simPhoneSend(const uint8 *data, uint16 len) {
+
+	uint16 i;
+
+	if (spp.tail - spp.head + len > PHONE_QUEUE) {
+
+		fprintf(stderr, "sim: phone queue full\n");
+		abort();
+	}
+
+	for (i = 0; i < len; i++) {
+
+		spp.queue[spp.tail++ % PHONE_QUEUE] = data[i];
+	}
+
+	sppKick();
+}
+
+uint16 simPhonePending(void) {
+
+	return (uint16)(spp.tail - spp.head) + spp.in_flight;
+}
+
+const char *simPhonePeek(void) {
+
+	return spp.taken;
+}
+
+const char *simPhoneTake(uint16 *len) {
+
+	static char copy[PHONE_QUEUE];
+
+	memcpy(copy, spp.taken, spp.taken_len);
+	copy[spp.taken_len] = 0;
+
+	if (len) {
+
+		*len = spp.taken_len;
+	}
+
+	spp.taken_len = 0;
+	spp.taken[0] = 0;
+
+	return copy;
+}
+
+void simSppReset(void) {
+
+	memset(&spp, 0, sizeof(spp));
+	memset(&sim_phone, 0, sizeof(sim_phone));
+	memset(&sim_scan, 0, sizeof(sim_scan));
+	sim_scan_hook = 0;
+
+	sim_phone.addr.lap = 0x123456;
+	sim_phone.addr.uap = 0x78;
+	sim_phone.addr.nap = 0x9ABC;
+	sim_phone.frame_size = 127;
+
+	simPortInit(&sim_spp_port, &sim_config.spp_buffer, SPP_MESSAGE_MORE_DATA, SPP_MESSAGE_MORE_SPACE, sppKick);
+}
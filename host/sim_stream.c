@@ -0,0 +1,818 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <stream.h>
+#include <pio.h>
+
+#include "sim_private.h"
+
+#define PIO_DIRECTION		(1 << 3)		/** rs-485 driver enable, see hal.h **/
+#define CONTROLLER_QUEUE	65536
+
+sim_uart_t sim_uart;
+
+static sim_port_t uart_port;
+
+static struct {
+
+	/** StreamUartConfigure() **/
+	uint16		divisor;
+	uint16		parity;				/** AT+CONNECT encoding **/
+	uint16		stop;
+
+	/** bridge transmitter **/
+	bool		sending;
+	uint32		bus_changes;		/** driver switched, a byte sent across a switch is lost **/
+	bool		driving;
+	sim_time_t	driving_since;
+	uint32		bridge_carry;		/** us fraction of the characters sent so far **/
+
+	/** controller transmitter, a ring of bytes still to send **/
+	uint8		queue[CONTROLLER_QUEUE];
+	uint32		head;
+	uint32		tail;
+	bool		busy;
+	uint32		controller_carry;
+
+	/** a burst sent at settings the bridge doesn't share, decoded when the line goes idle **/
+	uint8		burst[CONTROLLER_QUEUE];
+	uint16		burst_len;
+
+} uart;
+
+static void uartKick(void);
+
+
+/**************************************************************************************************
+
+  ports
+
+  */
+
+void simPortInit(sim_port_t *port, uint16 *capacity, MessageId more_data, MessageId more_space, void (*kick)(void)) {
+
+	memset(port, 0, sizeof(*port));
+
+	port ->sink.port = port;
+	port ->source.port = port;
+	port ->capacity = capacity;
+	port ->more_data = more_data;
+	port ->more_space = more_space;
+	port ->data_messages = TRUE;
+	port ->space_messages = TRUE;
+	port ->kick = kick;
+}
+
+static uint16 portCapacity(const sim_port_t *port) {
+
+	return *port ->capacity > SIM_BUFFER_MAX ? SIM_BUFFER_MAX : *port ->capacity;
+}
+
+uint16 simPortRxSpace(const sim_port_t *port) {
+
+	uint16 capacity = portCapacity(port);
+
+	return port ->rx.used >= capacity ? 0 : capacity - port ->rx.used;
+}
+
+void simPortRxPut(sim_port_t *port, const uint8 *data, uint16 len) {
+
+	memcpy(port ->rx.data + port ->rx.used, data, len);
+	port ->rx.used += len;
+	port ->new_data = TRUE;
+}
+
+uint16 simPortTxTake(sim_port_t *port, uint8 *data, uint16 max) {
+
+	uint16 n = port ->tx.used < max ? port ->tx.used : max;
+
+	if (n) {
+
+		memcpy(data, port ->tx.data, n);
+		memmove(port ->tx.data, port ->tx.data + n, port ->tx.used + port ->tx.claimed - n);
+		port ->tx.used -= n;
+		port ->new_space = TRUE;
+	}
+
+	return n;
+}
+
+static sim_port_t *sinkPort(Sink sink) {
+
+	return sink && sink ->port ->valid ? sink ->port : 0;
+}
+
+static sim_port_t *sourcePort(Source source) {
+
+	return source && source ->port ->valid ? source ->port : 0;
+}
+
+/** run the firmware's stream connections and tell tasks about new data and space **/
+static void portPump(sim_port_t *port) {
+
+	if (!port ->valid) {
+
+		return;
+	}
+
+	if (port ->disposed) {
+
+		port ->rx.used = 0;
+		port ->new_data = FALSE;
+	}
+	else if (port ->connected) {
+
+		Sink sink = port ->connected;
+		uint16 moved = StreamMove(sink, &port ->source, port ->rx.used);
+
+		if (moved) {
+
+			(void)SinkFlush(sink, moved);
+		}
+		port ->new_data = FALSE;
+	}
+
+	port ->kick();
+
+	if (port ->task && port ->new_data && port ->rx.used && port ->data_messages && !simPending(port ->task, port ->more_data)) {
+
+		port ->new_data = FALSE;
+		simPost(port ->task, port ->more_data, 0, 0);
+	}
+
+	if (port ->task && port ->new_space && port ->space_messages && !simPending(port ->task, port ->more_space)) {
+
+		port ->new_space = FALSE;
+		simPost(port ->task, port ->more_space, 0, 0);
+	}
+}
+
+void simStreamPump(void) {
+
+	portPump(&uart_port);
+	portPump(&sim_spp_port);
+}
+
+
+/**************************************************************************************************
+
+  sinks, sources and streams
+
+  */
+
+uint16 SinkSlack(Sink sink) {
+
+	sim_port_t *port = sinkPort(sink);
+	uint16 capacity;
+
+	if (!port) {
+
+		return 0;
+	}
+
+	capacity = portCapacity(port);
+
+	return port ->tx.used + port ->tx.claimed >= capacity ? 0 : capacity - port ->tx.used - port ->tx.claimed;
+}
+
+uint16 SinkClaim(Sink sink, uint16 extra) {
+
+	sim_port_t *port = sinkPort(sink);
+	uint16 offset;
+
+	if (!port || extra > SinkSlack(sink)) {
+
+		return 0xFFFF;
+	}
+
+	offset = port ->tx.claimed;
+	port ->tx.claimed += extra;
+
+	if (port == &uart_port) {
+
+		sim_uart.claimed += extra;
+	}
+
+	return offset;
+}
+
+uint8 *SinkMap(Sink sink) {
+
+	sim_port_t *port = sinkPort(sink);
+
+	return port ? port ->tx.data + port ->tx.used : 0;
+}
+
+bool SinkFlush(Sink sink, uint16 amount) {
+
+	sim_port_t *port = sinkPort(sink);
+
+	if (!port || amount > port ->tx.claimed) {
+
+		return FALSE;
+	}
+
+	port ->tx.used += amount;
+	port ->tx.claimed -= amount;
+
+	return TRUE;
+}
+
+bool SinkIsValid(Sink sink) {
+
+	return sinkPort(sink) != 0;
+}
+
+bool SinkConfigure(Sink sink, uint16 key, uint16 value) {
+
+	sim_port_t *port = sinkPort(sink);
+
+	if (!port || key != VM_SINK_MESSAGES) {
+
+		return FALSE;
+	}
+
+	port ->space_messages = value != VM_MESSAGES_NONE;
+
+	return TRUE;
+}
+
+uint16 SourceSize(Source source) {
+
+	sim_port_t *port = sourcePort(source);
+
+	return port ? port ->rx.used : 0;
+}
+
+const uint8 *SourceMap(Source source) {
+
+	sim_port_t *port = sourcePort(source);
+
+	return port ? port ->rx.data : 0;
+}
+
+void SourceDrop(Source source, uint16 amount) {
+
+	sim_port_t *port = sourcePort(source);
+
+	if (!port) {
+
+		return;
+	}
+
+	if (amount > port ->rx.used) {
+
+		amount = port ->rx.used;
+	}
+
+	memmove(port ->rx.data, port ->rx.data + amount, port ->rx.used - amount);
+	port ->rx.used -= amount;
+}
+
+bool SourceIsValid(Source source) {
+
+	return sourcePort(source) != 0;
+}
+
+bool SourceConfigure(Source source, uint16 key, uint16 value) {
+
+	sim_port_t *port = sourcePort(source);
+
+	if (!port || key != VM_SOURCE_MESSAGES) {
+
+		return FALSE;
+	}
+
+	port ->data_messages = value != VM_MESSAGES_NONE;
+
+	return TRUE;
+}
+
+Source StreamUartSource(void) {
+
+	return &uart_port.source;
+}
+
+Sink StreamUartSink(void) {
+
+	return &uart_port.sink;
+}
+
+Source StreamSourceFromSink(Sink sink) {
+
+	return sink ? &sink ->port ->source : 0;
+}
+
+bool StreamConnect(Source source, Sink sink) {
+
+	sim_port_t *from = sourcePort(source);
+
+	if (!from || !sinkPort(sink) || from ->connected) {
+
+		return FALSE;
+	}
+
+	from ->connected = sink;
+	from ->disposed = FALSE;
+
+	return TRUE;
+}
+
+bool StreamConnectDispose(Source source) {
+
+	sim_port_t *from = sourcePort(source);
+
+	if (!from || from ->connected) {
+
+		return FALSE;
+	}
+
+	from ->disposed = TRUE;
+
+	return TRUE;
+}
+
+void StreamDisconnect(Source source, Sink sink) {
+
+	sim_port_t *ports[2];
+	uint16 i;
+
+	ports[0] = &uart_port;
+	ports[1] = &sim_spp_port;
+
+	for (i = 0; i < 2; i++) {
+
+		if ((source && &ports[i] ->source == source) || (sink && ports[i] ->connected == sink)) {
+
+			ports[i] ->connected = 0;
+			ports[i] ->disposed = FALSE;
+		}
+	}
+}
+
+uint16 StreamMove(Sink sink, Source source, uint16 count) {
+
+	sim_port_t *to = sinkPort(sink);
+	sim_port_t *from = sourcePort(source);
+	uint16 slack = SinkSlack(sink);
+
+	if (!to || !from) {
+
+		return 0;
+	}
+
+	if (count > from ->rx.used) {
+
+		count = from ->rx.used;
+	}
+
+	if (count > slack) {
+
+		count = slack;
+	}
+
+	/** into the claimed region, the caller flushes **/
+	memcpy(to ->tx.data + to ->tx.used + to ->tx.claimed, from ->rx.data, count);
+	to ->tx.claimed += count;
+	SourceDrop(source, count);
+
+	return count;
+}
+
+Task MessageSinkTask(Sink sink, Task task) {
+
+	sim_port_t *port = sink ? sink ->port : 0;
+	Task old;
+
+	if (!port) {
+
+		return 0;
+	}
+
+	old = port ->task;
+	port ->task = task;
+
+	return old;
+}
+
+bool StreamConfigure(uint16 key, uint16 value) {
+
+	key = key; value = value;
+	return TRUE;
+}
+
+void StreamUartConfigure(uint16 rate, uint16 stop, uint16 parity) {
+
+	if (rate != VM_UART_RATE_SAME) {
+
+		uart.divisor = rate;
+	}
+
+	if (stop != VM_UART_STOP_SAME) {
+
+		uart.stop = stop == VM_UART_STOP_TWO ? 2 : 1;
+	}
+
+	if (parity != VM_UART_PARITY_SAME) {
+
+		uart.parity = parity == VM_UART_PARITY_ODD ? 1 : parity == VM_UART_PARITY_EVEN ? 2 : 0;
+	}
+}
+
+
+/**************************************************************************************************
+
+  uart line
+
+  */
+
+static uint16 bitsPerChar(uint16 parity, uint16 stop) {
+
+	return 1 + 8 + (parity ? 1 : 0) + (stop == 2 ? 2 : 1);
+}
+
+/** one character of bits x us_num / us_den us, the fraction left over is carried to the next one so
+	that back-to-back characters keep the exact rate **/
+static sim_time_t charTime(uint32 us_num, uint32 us_den, uint32 *carry) {
+
+	unsigned long long n;
+
+	if (!us_den) {
+
+		return 0;
+	}
+
+	n = (unsigned long long)us_num + *carry;
+	*carry = (uint32)(n % us_den);
+
+	return n / us_den;
+}
+
+/** the bridge bit lasts 4096 / divisor us, see uartDivisorBaud() **/
+static sim_time_t bridgeCharTime(void) {
+
+	return charTime((uint32)bitsPerChar(uart.parity, uart.stop) * 4096, uart.divisor, &uart.bridge_carry);
+}
+
+static sim_time_t controllerCharTime(void) {
+
+	return charTime((uint32)bitsPerChar(sim_uart.parity, sim_uart.stop) * 1000000, sim_uart.baud, &uart.controller_carry);
+}
+
+uint32 simUartBridgeBaud(void) {
+
+	return (uint32)(((unsigned long long)uart.divisor * 1000000 + 2048) / 4096);
+}
+
+uint16 simUartBridgeParity(void) {
+
+	return uart.parity;
+}
+
+/** both ends sample each other right, within 2% of each other and the same framing **/
+static bool uartMatched(void) {
+
+	uint32 bridge = simUartBridgeBaud();
+	uint32 diff = bridge > sim_uart.baud ? bridge - sim_uart.baud : sim_uart.baud - bridge;
+
+	return sim_uart.baud && diff * 50 <= sim_uart.baud && uart.parity == sim_uart.parity && uart.stop == sim_uart.stop;
+}
+
+static bool uartDriving(void) {
+
+	uint16 level = simPioOutput() & PIO_DIRECTION;
+
+	if (!(simPioDirection() & PIO_DIRECTION)) {
+
+		return FALSE;
+	}
+
+	switch (sim_uart.bus) {
+
+		case SIM_BUS_DRIVE_HIGH:
+			return level != 0;
+
+		case SIM_BUS_DRIVE_LOW:
+			return level == 0;
+
+		default:
+			return FALSE;
+	}
+}
+
+void simUartPioChanged(void) {
+
+	bool driving = uartDriving();
+
+	/** any pio may have changed, only the driver matters **/
+	if (driving != uart.driving) {
+
+		uart.bus_changes++;
+
+		if (uart.driving) {
+
+			sim_uart.driver_on_us += simNow() - uart.driving_since;
+		}
+
+		uart.driving = driving;
+		uart.driving_since = simNow();
+	}
+}
+
+/** bytes the controller gets for one byte the bridge sent **/
+static void controllerReceive(uint8 byte) {
+
+	uint8 out[4];
+	uint16 n = 1, i;
+
+	out[0] = byte;
+
+	if (!uartMatched()) {
+
+		sim_uart.mismatched++;
+		n = simUartSample(&byte, 1, simUartBridgeBaud(), uart.parity, uart.stop,
+						  sim_uart.baud, sim_uart.parity, sim_uart.stop, out, sizeof(out));
+	}
+
+	for (i = 0; i < n; i++) {
+
+		sim_uart.rx_bytes++;
+
+		if (sim_uart.rx) {
+
+			sim_uart.rx(out[i], simNow());
+		}
+	}
+}
+
+typedef struct {
+
+	uint8		byte;
+	uint32		bus_changes;
+	bool		driving;
+
+} bridge_char_t;
+
+static bridge_char_t bridge_char;
+
+static void bridgeCharSent(void *ctx) {
+
+	bridge_char_t *c = (bridge_char_t*)ctx;
+
+	uart.sending = FALSE;
+
+	/** full duplex has no driver, on a bus the driver must have been on for the whole character **/
+	if (sim_uart.bus == SIM_BUS_FULL_DUPLEX || (c ->driving && c ->bus_changes == uart.bus_changes && uartDriving())) {
+
+		controllerReceive(c ->byte);
+	}
+	else {
+
+		sim_uart.lost++;
+	}
+
+	uartKick();
+}
+
+/** the bridge uart takes the next byte of the sink into its shift register **/
+static void uartKick(void) {
+
+	if (uart.sending || !uart_port.valid || !uart_port.tx.used) {
+
+		return;
+	}
+
+	(void)simPortTxTake(&uart_port, &bridge_char.byte, 1);
+	bridge_char.bus_changes = uart.bus_changes;
+	bridge_char.driving = uartDriving();
+
+	uart.sending = TRUE;
+	simAfter(bridgeCharTime(), bridgeCharSent, &bridge_char);
+}
+
+static void bridgeReceive(const uint8 *data, uint16 len) {
+
+	uint16 space = simPortRxSpace(&uart_port);
+
+	if (len > space) {
+
+		sim_uart.overruns += len - space;
+		len = space;
+	}
+
+	if (len) {
+
+		simPortRxPut(&uart_port, data, len);
+	}
+}
+
+static void controllerCharSent(void *ctx) {
+
+	uint8 byte = uart.queue[uart.head % CONTROLLER_QUEUE];
+
+	ctx = ctx;
+	uart.head++;
+	sim_uart.tx_bytes++;
+
+	if (sim_uart.bus != SIM_BUS_FULL_DUPLEX && uart.driving) {
+
+		/** both ends drive the bus, nobody reads this byte **/
+		sim_uart.collisions++;
+	}
+	else if (uartMatched() && !uart.burst_len) {
+
+		bridgeReceive(&byte, 1);
+	}
+	else if (uart.burst_len < sizeof(uart.burst)) {
+
+		uart.burst[uart.burst_len++] = byte;
+	}
+
+	if (uart.head != uart.tail) {
+
+		simAfter(controllerCharTime(), controllerCharSent, 0);
+		return;
+	}
+
+	uart.busy = FALSE;
+
+	if (uart.burst_len) {
+
+		/** the line is idle, the bridge receiver has made what it could of the burst **/
+		uint8 out[CONTROLLER_QUEUE / 4];
+		uint16 n;
+
+		sim_uart.mismatched += uart.burst_len;
+		n = simUartSample(uart.burst, uart.burst_len, sim_uart.baud, sim_uart.parity, sim_uart.stop,
+						  simUartBridgeBaud(), uart.parity, uart.stop, out, sizeof(out));
+		uart.burst_len = 0;
+		bridgeReceive(out, n);
+	}
+}
+
+void simUartSend(const uint8 *data, uint16 len) {
+
+	uint16 i;
+
+	if (uart.tail - uart.head + len > CONTROLLER_QUEUE) {
+
+		fprintf(stderr, "sim: controller queue full\n");
+		abort();
+	}
+
+	for (i = 0; i < len; i++) {
+
+		uart.queue[uart.tail++ % CONTROLLER_QUEUE] = data[i];
+	}
+
+	if (!uart.busy && len) {
+
+		uart.busy = TRUE;
+		simAfter(controllerCharTime(), controllerCharSent, 0);
+	}
+}
+
+bool simUartBusy(void) {
+
+	return uart.busy;
+}
+
+void simStreamReset(void) {
+
+	memset(&uart, 0, sizeof(uart));
+	memset(&sim_uart, 0, sizeof(sim_uart));
+
+	/** the ps configuration of the module, 115200 8N1 **/
+	uart.divisor = VM_UART_RATE_115K2;
+	uart.stop = 1;
+
+	sim_uart.baud = 115200;
+	sim_uart.stop = 1;
+
+	simPortInit(&uart_port, &sim_config.uart_buffer, MESSAGE_MORE_DATA, MESSAGE_MORE_SPACE, uartKick);
+	uart_port.valid = TRUE;
+}
+
+
+/**************************************************************************************************
+
+  bit level receiver
+
+  */
+
+typedef struct {
+
+	const uint8	*data;
+	uint16		len;
+	uint16		bits;			/** per character **/
+	uint16		parity;
+
+} line_t;
+
+/** level of bit k of the line, idle high before and after the characters **/
+static uint16 lineLevel(const line_t *line, long k) {
+
+	long c, b;
+	uint8 byte;
+
+	if (k < 0 || k >= (long)line ->len * line ->bits) {
+
+		return 1;
+	}
+
+	c = k / line ->bits;
+	b = k % line ->bits;
+	byte = line ->data[c];
+
+	if (b == 0) {
+
+		return 0;
+	}
+
+	if (b <= 8) {
+
+		return (byte >> (b - 1)) & 1;
+	}
+
+	if (b == 9 && line ->parity) {
+
+		uint16 ones = 0, i;
+
+		for (i = 0; i < 8; i++) {
+
+			ones += (byte >> i) & 1;
+		}
+
+		/** odd parity makes the count of ones odd **/
+		return line ->parity == 1 ? !(ones & 1) : (ones & 1);
+	}
+
+	return 1;
+}
+
+uint16 simUartSample(const uint8 *data, uint16 len, uint32 baud, uint16 parity, uint16 stop,
+					 uint32 rx_baud, uint16 rx_parity, uint16 rx_stop, uint8 *out, uint16 max) {
+
+	line_t line;
+	double bit = 1.0 / baud;
+	double rx_bit = 1.0 / rx_baud;
+	double t = 0.0;
+	double end;
+	uint16 n = 0;
+
+	line.data = data;
+	line.len = len;
+	line.bits = bitsPerChar(parity, stop);
+	line.parity = parity;
+
+	end = (double)len * line.bits * bit;
+
+	/** a second stop bit is idle line to a receiver, rx_stop only matters when sending **/
+	rx_stop = rx_stop;
+
+	while (n < max && t < end) {
+
+		long k = (long)(t / bit);
+		double start;
+		uint8 byte = 0;
+		uint16 i;
+
+		/** wait for a falling edge at a bit boundary of the sender **/
+		if ((double)k * bit < t) {
+
+			k++;
+		}
+
+		while (k < (long)len * line.bits && !(lineLevel(&line, k - 1) && !lineLevel(&line, k))) {
+
+			k++;
+		}
+
+		if (k >= (long)len * line.bits) {
+
+			break;
+		}
+
+		start = k * bit;
+
+		/** a start bit that isn't low in its middle was a glitch **/
+		if (lineLevel(&line, (long)((start + 0.5 * rx_bit) / bit))) {
+
+			t = start + 0.5 * rx_bit;
+			continue;
+		}
+
+		for (i = 0; i < 8; i++) {
+
+			byte |= lineLevel(&line, (long)((start + (1.5 + i) * rx_bit) / bit)) << i;
+		}
+
+		/** parity and framing errors still deliver the byte, like the chip does **/
+		out[n++] = byte;
+
+		/** the receiver looks for the next start bit after the middle of the first stop bit **/
+		t = start + (9.5 + (rx_parity ? 1 : 0)) * rx_bit;
+	}
+
+	return n;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "hal.h"
+#include "hal_private.h"
+
+/**************************************
+
+  no heap allocation in steady state. the program is linked with malloc wrapped (see the Makefile),
+  the sim allocates its message payloads with calloc, so what is counted is the firmware's own and
+  the battery library's.
+
+  boot, pairing and the first AT+CONNECT may allocate once. after that, minutes of pipe traffic both
+  ways with idle gaps for the sniff policy, an escape to echo with AT commands and back, a disconnect
+  with the scan schedule and a reconnect from the stored profile allocate nothing. the battery library
+  allocates every BATTERY_READING_MESSAGE it sends, those are the only allocations allowed.
+
+  **************************************/
+
+int app_main(void);
+
+void *__real_malloc(size_t size);
+
+static uint32 allocations;
+
+void *__wrap_malloc(size_t size) {
+
+	allocations++;
+
+	return __real_malloc(size);
+}
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	byte = byte; end = end;
+}
+
+/** traffic both ways, then a gap of silence **/
+static void traffic(uint16 rounds) {
+
+	static const uint8 data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	uint16 i;
+
+	for (i = 0; i < rounds; i++) {
+
+		simPhoneSend(data, (uint16)(1 + rand() % (sizeof(data) - 1)));
+		simUartSend(data, (uint16)(1 + rand() % (sizeof(data) - 1)));
+		(void)simRunUntil(simNow() + SIM_MS(rand() % 50));
+
+		if (rand() % 20 == 0) {
+
+			(void)simRunUntil(simNow() + SIM_SEC(2));
+		}
+	}
+
+	(void)simRunUntil(simNow() + SIM_MS(500));
+	(void)simPhoneTake(0);
+}
+
+static bool escape(void) {
+
+	(void)simRunUntil(simNow() + SIM_MS(1100));
+	simPhoneSend((const uint8*)"+++", 3);
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+
+	return strstr(simPhoneTake(0), "OK") != 0;
+}
+
+int main(void) {
+
+	uint32 boot, readings;
+	uint16 mv;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	sim_uart.rx = controllerRx;
+	srand(2020);
+
+	(void)app_main();
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+	CHECK(simBridgePipe(1152, 1, 0, 1, 0));
+	traffic(100);
+
+	boot = allocations;
+	allocations = 0;
+	readings = sim_counters.battery_readings;
+
+	traffic(2000);
+
+	CHECK(escape());
+	CHECK(strstr(simBridgeCommand("AT+STATS\r\n"), "OK") != 0);
+	CHECK(strstr(simBridgeCommand("AT+LATENCY\r\n"), "OK") != 0);
+	CHECK(simBridgePipe(1152, 1, 0, 1, 0));
+	traffic(200);
+
+	/** the scan schedule runs, the stored profile takes the phone straight back to the pipe **/
+	simPhoneDisconnect();
+	(void)simRunUntil(simNow() + SIM_SEC(40));
+	CHECK(simBridgeConnect());
+	traffic(200);
+
+	/** the library polls, a lower battery shows at the next reading **/
+	simBatteryMv(1500);
+	(void)simRunUntil(simNow() + SIM_SEC(35));
+	mv = ((halTaskData*)getHalTask()) ->voltage;
+	CHECK(mv == 1500 * (22 + 15) / 15);
+
+	readings = sim_counters.battery_readings - readings;
+	printf("test_alloc: %lu allocations at boot, %lu after, %lu of them battery readings, over %lu s\n",
+		   (unsigned long)boot, (unsigned long)allocations, (unsigned long)readings,
+		   (unsigned long)(simNow() / SIM_SEC(1)));
+
+	CHECK(sim_uart.rx_bytes > 20000 && sim_phone.rx_bytes > 20000);
+	CHECK(readings > 0);
+	CHECK(allocations == readings);
+	CHECK(sim_counters.panics == 0);
+
+	return checkDone("test_alloc");
+}
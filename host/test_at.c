@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "at_command.h"
+#include "sppb.h"
+
+/**************************************
+
+  echo state command scan, fuzzed:
+
+	parseLineEnd() alone, over random streams of command characters and line ends arriving in random
+	pieces. resumed at the bytes already searched it must find the same end as a search of everything.
+
+	the whole firmware, AT commands split across rfcomm packets a few ms apart, each answered once and
+	in order, none lost to a partial packet. a command to an idle echo state takes the link out of sniff.
+
+  **************************************/
+
+int app_main(void);
+
+#define SCAN_STREAMS		2000
+#define SCAN_MAX			300
+#define COMMANDS			300
+#define SEED				777
+
+static const struct {
+
+	const char *line;
+	const char *reply;
+
+} commands[] = {
+
+	{ "AT+LATRESET",			"OK" },
+	{ "at+packtime=5",			"OK" },
+	{ "AT+PACKTIME = 0",		"OK" },
+	{ "AT+PACKTIME=5000",		"UNRECOGNIZED" },
+	{ "AT+CONNECT=1,1,0,2,0",	"BAUDRATE ERROR" },
+	{ "AT+CONNECT=1,1 0,2,0",	"UNRECOGNIZED" },
+	{ "AT+NOSUCH",				"UNRECOGNIZED" },
+	{ "hello",					"UNRECOGNIZED" }
+};
+
+#define COUNT(a)			(sizeof(a) / sizeof(a[0]))
+
+/** end of the last \r\n at 2 or later, searched backwards from size **/
+static uint16 lastLineEnd(const uint8 *s, uint16 size) {
+
+	uint16 i;
+
+	for (i = size; i > 2; i--) {
+
+		if (s[i - 1] == '\n' && s[i - 2] == '\r') {
+
+			return i;
+		}
+	}
+
+	return 0;
+}
+
+static void scanFuzz(void) {
+
+	static const char alphabet[] = "AT+=1,x\r\r\n\n";
+	uint8 buf[SCAN_MAX];
+	uint16 n;
+
+	for (n = 0; n < SCAN_STREAMS; n++) {
+
+		uint16 len = 1 + rand() % SCAN_MAX;
+		uint16 size = 0;
+		bool same = TRUE;
+		uint16 i;
+
+		for (i = 0; i < len; i++) {
+
+			buf[i] = (uint8)alphabet[rand() % (sizeof(alphabet) - 1)];
+		}
+
+		while (size < len) {
+
+			uint16 from = size;
+			uint16 end;
+
+			size += 1 + rand() % (len - size < 16 ? len - size : 16);
+			end = parseLineEnd(buf, from, size);
+
+			/** an earlier piece may have held the last end, this one none **/
+			if (end && end != lastLineEnd(buf, size)) {
+
+				same = FALSE;
+			}
+
+			if (!end && lastLineEnd(buf, size) > from) {
+
+				same = FALSE;
+			}
+		}
+
+		CHECK(same);
+	}
+}
+
+/** the replies in the order they came, one per line **/
+static uint16 replyLines(char *text, const char **line, uint16 max) {
+
+	uint16 n = 0;
+	char *p;
+
+	for (p = strtok(text, "\r\n"); p && n < max; p = strtok(0, "\r\n")) {
+
+		line[n++] = p;
+	}
+
+	return n;
+}
+
+int main(void) {
+
+	static char replies[COMMANDS * 32];
+	static const char batch[] = "AT+CONNECT=0,1,0,2,0\r\nAT+STATS\r\n";
+	const char *line[COMMANDS + 1];
+	uint16 expected[COMMANDS];
+	uint16 i, n;
+	uint16 split = 0;
+	uint16 wrong = 0;
+	const link_policy_t *link = &((sppb_task_t*)getSppbTask()) ->link;
+
+	srand(SEED);
+	scanFuzz();
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+	(void)simPhoneTake(0);
+
+	/** echo state traffic drives the link policy like the pipe's **/
+	(void)simRunUntil(simNow() + SIM_SEC(2));
+	CHECK(link ->stage > 0);
+	CHECK(strstr(simBridgeCommand("AT+LATRESET\r\n"), "OK") != 0);
+	CHECK(link ->stage == 0 && link ->wakeups == 1);
+	(void)simPhoneTake(0);
+
+	/** each command in up to 4 packets, the pieces well within the 100 ms command timeout **/
+	for (i = 0; i < COMMANDS; i++) {
+
+		char text[40];
+		uint16 len, sent = 0;
+
+		expected[i] = rand() % COUNT(commands);
+		len = (uint16)strlen(strcpy(text, commands[expected[i]].line));
+		strcpy(text + len, "\r\n");
+		len += 2;
+
+		while (sent < len) {
+
+			uint16 piece = len - sent;
+
+			if (rand() % 2 && piece > 1) {
+
+				piece = 1 + rand() % (piece - 1);
+				split++;
+			}
+
+			simPhoneSend((const uint8*)text + sent, piece);
+			sent += piece;
+			(void)simRunUntil(simNow() + SIM_MS(rand() % 20));
+		}
+	}
+
+	(void)simRunUntil(simNow() + SIM_MS(500));
+	strncpy(replies, simPhoneTake(0), sizeof(replies) - 1);
+	n = replyLines(replies, line, COUNT(line));
+
+	CHECK(n == COMMANDS);
+
+	for (i = 0; i < n && i < COMMANDS; i++) {
+
+		if (strcmp(line[i], commands[expected[i]].reply)) {
+
+			wrong++;
+		}
+	}
+
+	printf("test_at: %u commands, %u split, %u replies, %u wrong\n", COMMANDS, split, n, wrong);
+	CHECK(wrong == 0);
+	CHECK(split > COMMANDS / 2);
+
+	/** the command behind AT+CONNECT=0 in its packet runs once the search is replied, the uart is silent
+		so the search fails **/
+	simPhoneSend((const uint8*)batch, strlen(batch));
+	(void)simRunUntil(simNow() + SIM_SEC(30));
+	strncpy(replies, simPhoneTake(0), sizeof(replies) - 1);
+	n = replyLines(replies, line, COUNT(line));
+
+	CHECK(n >= 3);
+	CHECK(n >= 1 && !strcmp(line[0], "AUTOBAUD ERROR"));
+	CHECK(n >= 2 && !strncmp(line[1], "+STATS:", 7));
+	CHECK(n >= 3 && !strcmp(line[n - 1], "OK"));
+	CHECK(sim_counters.panics == 0);
+
+	return checkDone("test_at");
+}
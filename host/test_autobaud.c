@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stream.h>
+
+#include "sim.h"
+#include "check.h"
+#include "autobaud.h"
+#include "uart_timing.h"
+
+/**************************************
+
+  auto-baud scorer, without the rest of the firmware: a controller sends text or modbus rtu frames
+  at every candidate rate and parity, each candidate is configured in turn and scores what the bridge
+  uart makes of the line at its own rate, as much as a dwell brings. the scorer must lock on the
+  controller's rate. random bytes must not lock, and a candidate scores no more than
+  AUTOBAUD_MAX_BYTES whatever the rate.
+
+  the candidates' divisors are within UART_RATE_MAX_ERROR of their rates, and the non-standard rate
+  table of uart_timing.c gives the divisor and error its comments say.
+
+  **************************************/
+
+#define STREAM_MAX			1024
+#define CHUNK				32			/** bytes per MESSAGE_MORE_DATA **/
+
+/** autobaud.c order **/
+static const uint16 rates[] = { 96, 1152, 192, 384, 576, 48, 2304, 4608, 9216 };
+
+/** uart_custom_rates[] in uart_timing.c, the error as its comments give it in per mille **/
+static const struct {
+
+	uint16 baudrate;
+	uint16 error;
+
+} custom_rates[] = {
+
+	{ 12, 17 }, { 24, 17 }, { 48, 17 }, { 144, 0 }, { 288, 0 }, { 768, 1 }, { 1280, 1 }, { 2500, 0 },
+	{ 2560, 0 }, { 5000, 0 }, { 10000, 0 }
+};
+
+static uint8 stream[STREAM_MAX];
+
+static uint16 modbusCrc(const uint8 *p, uint16 len) {
+
+	uint16 crc = 0xFFFF;
+	uint16 i, b;
+
+	for (i = 0; i < len; i++) {
+
+		crc ^= p[i];
+
+		for (b = 0; b < 8; b++) {
+
+			crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+		}
+	}
+
+	return crc;
+}
+
+static uint16 modbusFrame(uint8 *p, const uint8 *pdu, uint16 len) {
+
+	uint16 crc;
+
+	memcpy(p, pdu, len);
+	crc = modbusCrc(p, len);
+	p[len] = (uint8)crc;
+	p[len + 1] = (uint8)(crc >> 8);
+
+	return len + 2;
+}
+
+/** read holding registers requests and their responses, back-to-back **/
+static uint16 modbusStream(uint16 len) {
+
+	uint16 n = 0;
+	uint16 seq = 0;
+
+	while (n + 32 <= len) {
+
+		uint8 pdu[16];
+		uint16 i;
+
+		pdu[0] = 0x11;
+		pdu[1] = 0x03;
+		pdu[2] = 0x00;
+		pdu[3] = (uint8)seq;
+		pdu[4] = 0x00;
+		pdu[5] = 0x04;
+		n += modbusFrame(stream + n, pdu, 6);
+
+		pdu[2] = 8;
+
+		for (i = 0; i < 8; i++) {
+
+			pdu[3 + i] = (uint8)(seq * 7 + i);
+		}
+		n += modbusFrame(stream + n, pdu, 11);
+		seq++;
+	}
+
+	return n;
+}
+
+static uint16 textStream(uint16 len) {
+
+	uint16 n = 0;
+	uint16 seq = 0;
+
+	while (n + 32 <= len) {
+
+		n += (uint16)sprintf((char*)stream + n, "T%u=%u.%u C, door %s\r\n", seq % 8, 20 + seq % 5, seq % 10, seq % 3 ? "closed" : "open");
+		seq++;
+	}
+
+	return n;
+}
+
+static uint16 noiseStream(uint16 len) {
+
+	uint16 i;
+
+	for (i = 0; i < len; i++) {
+
+		stream[i] = (uint8)rand();
+	}
+
+	return len;
+}
+
+/** what one dwell of each candidate brings, fed the way the pipe does **/
+static void listen(autobaud_t *a, uint16 len, uint32 baud, uint16 parity) {
+
+	do {
+
+		uint8 rx[STREAM_MAX];
+		uint16 n, i;
+
+		autobaudConfigure(a, VM_UART_STOP_ONE);
+		n = simUartSample(stream, len, baud, parity, 1, simUartBridgeBaud(), simUartBridgeParity(), 1, rx, sizeof(rx));
+
+		for (i = 0; i < n && !autobaudFull(a); i += CHUNK) {
+
+			autobaudFeed(a, rx + i, n - i < CHUNK ? n - i : CHUNK);
+		}
+
+	} while (autobaudNext(a));
+}
+
+/** bytes a dwell brings at baud, at most STREAM_MAX **/
+static uint16 dwellBytes(uint32 baud, uint16 parity) {
+
+	uint32 n = baud * AUTOBAUD_DWELL / 1000 / (10 + (parity ? 1 : 0));
+
+	return n > STREAM_MAX ? STREAM_MAX : (uint16)n;
+}
+
+int main(void) {
+
+	autobaud_t a;
+	uint16 r, parity;
+	uint16 misses = 0;
+	uint16 i;
+
+	simReset();
+	srand(99);
+
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+		for (parity = 0; parity < 3; parity++) {
+
+			uint32 baud = (uint32)rates[r] * 100;
+			uint16 len = dwellBytes(baud, parity);
+			uint16 kind;
+
+			for (kind = 0; kind < 2; kind++) {
+
+				uint16 n = kind ? modbusStream(len) : textStream(len);
+				bool locked;
+
+				autobaudStart(&a, parity);
+				listen(&a, n, baud, parity);
+
+				locked = autobaudLocked(&a) && autobaudBaudrate(&a) == rates[r] && autobaudParity(&a) == parity;
+				CHECK(locked);
+				CHECK(uartRateError(rates[r], autobaudDivisor(&a)) <= UART_RATE_MAX_ERROR);
+
+				if (!locked) {
+
+					misses++;
+					fprintf(stderr, "  %s at %lu baud parity %u: locked %u on %u, score %d\n", kind ? "modbus" : "text",
+							(unsigned long)baud, parity, autobaudLocked(&a), autobaudBaudrate(&a), autobaudBestScore(&a));
+				}
+			}
+
+			/** noise locks on nothing **/
+			autobaudStart(&a, parity);
+			listen(&a, noiseStream(len), baud, parity);
+			CHECK(!autobaudLocked(&a));
+		}
+	}
+
+	/** the work per candidate is bounded **/
+	autobaudStart(&a, 0);
+
+	for (i = 0; i < 8; i++) {
+
+		autobaudFeed(&a, stream, STREAM_MAX);
+	}
+
+	CHECK(autobaudFull(&a));
+	CHECK(autobaudScore(&a) >= 0);
+	CHECK(a.bytes == AUTOBAUD_MAX_BYTES);
+
+	/** divisor = round(baud x 4096 / 10^6) and the error of the table's comments **/
+	for (i = 0; i < sizeof(custom_rates) / sizeof(custom_rates[0]); i++) {
+
+		uint16 divisor = uartRateDivisor(custom_rates[i].baudrate);
+
+		CHECK(divisor == ((uint32)custom_rates[i].baudrate * 409600UL + 500000UL) / 1000000UL);
+		CHECK(uartRateError(custom_rates[i].baudrate, divisor) == custom_rates[i].error);
+	}
+
+	printf("test_autobaud: %u rates x 3 parities x text, modbus, %u missed\n", (uint16)(sizeof(rates) / sizeof(rates[0])), misses);
+
+	return checkDone("test_autobaud");
+}
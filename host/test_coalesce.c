@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "stats.h"
+
+/**************************************
+
+  uart -> spp coalescing on the vm path, rs-485 as the full duplex fast path doesn't coalesce, with
+  the controller sending at the line rate: a short burst leaves in one rfcomm packet after the
+  AT+COALESCE window, AT+COALESCE=0 sends every read, and a link slower than the uart backs up the
+  spp sink, which is waited out without exceptions or lost bytes.
+
+  **************************************/
+
+int app_main(void);
+
+#define BURST			1100
+
+static uint8 phone_rx[BURST];
+static uint16 phone_rx_len;
+static sim_time_t first_packet;
+
+static void phoneRx(const uint8 *data, uint16 len, sim_time_t when) {
+
+	if (!phone_rx_len) {
+
+		first_packet = when;
+	}
+
+	if (phone_rx_len + len <= sizeof(phone_rx)) {
+
+		memcpy(phone_rx + phone_rx_len, data, len);
+	}
+
+	phone_rx_len += len;
+}
+
+static void phoneReset(void) {
+
+	(void)simPhoneTake(0);
+	phone_rx_len = 0;
+	first_packet = 0;
+	sim_phone.rx_packets = 0;
+	sim_phone.rx = phoneRx;
+}
+
+/** the controller's bytes, one char time each at 115200 **/
+static void controllerBurst(uint16 len) {
+
+	uint8 data[BURST];
+	uint16 i;
+
+	for (i = 0; i < len; i++) {
+
+		data[i] = (uint8)(i * 7 + 1);
+	}
+
+	simUartSend(data, len);
+}
+
+static bool burstIntact(uint16 len) {
+
+	uint16 i;
+
+	if (phone_rx_len != len) {
+
+		return FALSE;
+	}
+
+	for (i = 0; i < len; i++) {
+
+		if (phone_rx[i] != (uint8)(i * 7 + 1)) {
+
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+int main(void) {
+
+	const char *reply;
+	sim_time_t start;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+
+	/** the window is range checked **/
+	reply = simBridgeCommand("AT+COALESCE=101\r\n");
+	CHECK(strstr(reply, "UNRECOGNIZED") != 0);
+	reply = simBridgeCommand("AT+COALESCE=20\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+
+	CHECK(simBridgePipe(1152, 1, 0, 1, 1));
+
+	/** 10 bytes take under 1 ms on the wire, they wait for the 20 ms window and leave together **/
+	phoneReset();
+	start = simNow();
+	controllerBurst(10);
+	(void)simRunUntil(simNow() + SIM_MS(100));
+	CHECK(burstIntact(10));
+	CHECK(sim_phone.rx_packets == 1);
+	CHECK(first_packet - start >= SIM_MS(20));
+	CHECK(first_packet - start < SIM_MS(20) + SIM_MS(10));
+
+	/** back to echo, without coalescing every uart read goes out on its own **/
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	reply = simBridgeCommand("+++");
+	CHECK(strstr(reply, "OK") != 0);
+	reply = simBridgeCommand("AT+COALESCE=0\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+	CHECK(simBridgePipe(1152, 1, 0, 1, 1));
+
+	phoneReset();
+	start = simNow();
+	controllerBurst(10);
+	(void)simRunUntil(simNow() + SIM_MS(100));
+	CHECK(burstIntact(10));
+	CHECK(first_packet - start < SIM_MS(10));
+
+	/** a link a sixth of the uart rate, the spp sink backs up and the bridge waits for it to drain **/
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	reply = simBridgeCommand("+++");
+	CHECK(strstr(reply, "OK") != 0);
+	reply = simBridgeCommand("AT+COALESCE=8\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+	CHECK(simBridgePipe(1152, 1, 0, 1, 1));
+
+	sim_config.spp_bytes_per_s = 2000;
+	memset(stats_counter, 0, sizeof(stats_counter));
+	phoneReset();
+	controllerBurst(BURST);
+	(void)simRunUntil(simNow() + SIM_SEC(2));
+
+	CHECK(stats_counter[STAT_SPP_SINK_WAITS] > 0);
+	CHECK(stats_counter[STAT_EXCEPTIONS] == 0);
+	CHECK(sim_uart.overruns == 0);
+	CHECK(burstIntact(BURST));
+
+	CHECK(sim_counters.panics == 0);
+
+	return checkDone("test_coalesce");
+}
@@ -0,0 +1,200 @@
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+
+/**************************************
+
+  rs-485 driver window of spp -> uart frames, at every line setting and both polarities:
+
+	no byte is sent with the driver off, and the driver is released within one character of the last
+	stop bit plus one timer tick, the vm timers count in ms. a controller answering after the modbus
+	3.5 character turnaround must find the bus free.
+
+  the rates include 9600, whose divisor is 0.8% slow, and the highest ones, where a character is
+  shorter than the ms the timers round to. frames packed while earlier ones are still on the wire go
+  out under the same window, which still ends one character after the last of them.
+
+  **************************************/
+
+int app_main(void);
+
+#define PIO_DIRECTION		(1 << 3)
+#define FRAME_MAX			256
+
+static const uint16 rates[] = { 12, 96, 192, 576, 1152, 2500, 9216, 10000, 13824 };
+
+static uint16 polarity;
+
+static struct {
+
+	uint16		rx_len;
+	uint8		rx[FRAME_MAX * 4];
+	sim_time_t	last_stop;
+
+	bool		driving;
+	uint16		windows;			/** driver switched on **/
+	sim_time_t	released;
+
+} line;
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	if (line.rx_len < sizeof(line.rx)) {
+
+		line.rx[line.rx_len] = byte;
+	}
+
+	line.rx_len++;
+	line.last_stop = end;
+}
+
+static void pioChanged(uint16 changed, uint16 levels) {
+
+	bool driving;
+
+	if (!(changed & PIO_DIRECTION)) {
+
+		return;
+	}
+
+	driving = (simPioDirection() & PIO_DIRECTION) && (polarity == 1) == ((levels & PIO_DIRECTION) != 0);
+
+	if (driving && !line.driving) {
+
+		line.windows++;
+	}
+	else if (!driving && line.driving) {
+
+		line.released = simNow();
+	}
+
+	line.driving = driving;
+}
+
+static sim_time_t charUs(uint32 baud, uint16 parity, uint16 stop) {
+
+	return ((sim_time_t)(1 + 8 + (parity ? 1 : 0) + stop) * 1000000 + baud - 1) / baud;
+}
+
+static void frameFill(uint8 *p, uint16 len, uint8 seed) {
+
+	uint16 i;
+
+	for (i = 0; i < len; i++) {
+
+		p[i] = (uint8)(seed + i * 7);
+	}
+}
+
+/** one frame of len bytes through the pipe at the current settings **/
+static void frameCheck(uint16 len, uint32 baud, uint16 parity, uint16 stop) {
+
+	uint8 frame[FRAME_MAX];
+	uint32 lost = sim_uart.lost;
+	sim_time_t tail;
+	bool in_time;
+
+	memset(&line, 0, sizeof(line));
+	frameFill(frame, len, (uint8)baud);
+
+	simPhoneSend(frame, len);
+	(void)simRunUntil(simNow() + SIM_MS(200) + charUs(baud, parity, stop) * len);
+
+	tail = line.released - line.last_stop;
+	in_time = line.released >= line.last_stop && tail <= charUs(baud, parity, stop) + SIM_MS(1);
+
+	CHECK(line.rx_len == len && !memcmp(line.rx, frame, len));
+	CHECK(sim_uart.lost == lost);
+	CHECK(line.windows && !line.driving);
+	CHECK(in_time);
+
+	if (sim_uart.lost != lost || !in_time) {
+
+		fprintf(stderr, "  %lu baud parity %u stop %u polarity %u, %u bytes: lost %lu, released %lld us after the last stop bit\n",
+				(unsigned long)baud, parity, stop, polarity, len, (unsigned long)(sim_uart.lost - lost),
+				(long long)line.released - (long long)line.last_stop);
+	}
+}
+
+/** count frames of len bytes, gap apart so that each is packed on its own and queues behind the ones
+	still on the wire. they go out back-to-back under one driver window **/
+static void queueCheck(uint16 count, uint16 len, sim_time_t gap, uint32 baud, uint16 parity, uint16 stop) {
+
+	uint8 frames[FRAME_MAX * 4];
+	uint32 lost = sim_uart.lost;
+	uint16 i;
+
+	memset(&line, 0, sizeof(line));
+	frameFill(frames, count * len, (uint8)~baud);
+
+	for (i = 0; i < count; i++) {
+
+		simPhoneSend(frames + i * len, len);
+		(void)simRunUntil(simNow() + gap);
+	}
+
+	CHECK(line.driving && line.rx_len < count * len);
+
+	(void)simRunUntil(simNow() + SIM_MS(200) + charUs(baud, parity, stop) * count * len);
+
+	CHECK(line.rx_len == count * len && !memcmp(line.rx, frames, count * len));
+	CHECK(sim_uart.lost == lost);
+	CHECK(line.windows == 1 && !line.driving);
+	CHECK(line.released >= line.last_stop && line.released - line.last_stop <= charUs(baud, parity, stop) + SIM_MS(1));
+}
+
+/** back to echo, the escape needs a second of silence on both sides **/
+static void pipeLeave(void) {
+
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	(void)simBridgeCommand("+++");
+}
+
+int main(void) {
+
+	uint16 r, parity, stop;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+	sim_uart.rx = controllerRx;
+	sim_pio_hook = pioChanged;
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+
+	for (polarity = 0; polarity < 2; polarity++) {
+		for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+			for (parity = 0; parity < 3; parity++) {
+				for (stop = 1; stop <= 2; stop++) {
+
+					uint32 baud;
+
+					CHECK(simBridgePipe(rates[r], stop, parity, polarity, 1));
+					baud = simUartBridgeBaud();
+
+					frameCheck(1, baud, parity, stop);
+					frameCheck(64, baud, parity, stop);
+					frameCheck(FRAME_MAX, baud, parity, stop);
+
+					pipeLeave();
+				}
+			}
+		}
+	}
+
+	/** frames queued while the uart is busy **/
+	for (polarity = 0; polarity < 2; polarity++) {
+
+		CHECK(simBridgePipe(96, 1, 0, polarity, 1));
+		queueCheck(4, 64, SIM_MS(30), simUartBridgeBaud(), 0, 1);
+		pipeLeave();
+
+		CHECK(simBridgePipe(1152, 1, 2, polarity, 1));
+		queueCheck(4, 64, SIM_MS(4), simUartBridgeBaud(), 2, 1);
+		pipeLeave();
+	}
+
+	return checkDone("test_driver");
+}
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "sppb.h"
+
+/**************************************
+
+  +++ in pipe state:
+
+	frames still queued for a slow uart when the escape is confirmed reach the controller before
+	the OK, a '+' payload that turns out not to be the escape still gets its gather latency sample,
+	and a fuzz of bursts framed by silence, many of them '+' near misses, counts false positives
+	(pipe left without a real escape) and false negatives (a real escape missed).
+
+  within a burst the chunks are at most 200 ms apart, between bursts the line is silent for 1.5 s,
+  so the 1 s guard time never sits on a boundary the air latency could move.
+
+  **************************************/
+
+int app_main(void);
+
+#define FUZZ_BURSTS		300
+#define FUZZ_SEED		12345
+#define PAYLOAD_MAX		(FUZZ_BURSTS * 16)
+
+static uint8 uart_rx[PAYLOAD_MAX];
+static uint16 uart_rx_len;
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	end = end;
+
+	if (uart_rx_len < sizeof(uart_rx)) {
+
+		uart_rx[uart_rx_len] = byte;
+	}
+
+	uart_rx_len++;
+}
+
+static uint32 gatherSamples(void) {
+
+	const latency_hist_t *h = &((sppb_task_t*)getSppbTask()) ->lat[LAT_S2U_GATHER];
+	uint32 n = 0;
+	uint16 i;
+
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+
+		n += h ->count[i];
+	}
+
+	return n;
+}
+
+static uint8 fuzzByte(void) {
+
+	/** mostly escape chars, the rest printable **/
+	return rand() % 2 ? '+' : (uint8)('a' + rand() % 26);
+}
+
+/** one burst of 1..6 bytes in up to 3 chunks, its content in burst **/
+static uint16 fuzzBurst(uint8 *burst) {
+
+	uint16 len = 1 + rand() % 6;
+	uint16 i;
+
+	for (i = 0; i < len; i++) {
+
+		burst[i] = fuzzByte();
+	}
+
+	/** a real escape once in a while **/
+	if (rand() % 10 == 0) {
+
+		memcpy(burst, "+++", 3);
+		len = 3;
+	}
+
+	return len;
+}
+
+static void sendBurst(const uint8 *burst, uint16 len) {
+
+	static const sim_time_t gaps[] = { 0, SIM_MS(5), SIM_MS(200) };
+	uint16 sent = 0;
+
+	while (sent < len) {
+
+		uint16 n = 1 + rand() % (len - sent);
+
+		simPhoneSend(burst + sent, n);
+		sent += n;
+		(void)simRunUntil(simNow() + gaps[rand() % 3]);
+	}
+}
+
+int main(void) {
+
+	uint8 *payload = malloc(PAYLOAD_MAX);
+	uint16 payload_len = 0;
+	uint16 false_positives = 0, false_negatives = 0, escapes = 0;
+	uint16 i;
+	const char *reply;
+	uint32 gathered;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+	sim_uart.rx = controllerRx;
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+
+	/** 1000 bytes take 8.3 s at 1200 baud, more than the uart sink holds, the escape is confirmed
+		with frames still queued **/
+	CHECK(simBridgePipe(12, 1, 0, 2, 0));
+
+	for (i = 0; i < 1000; i++) {
+
+		payload[i] = (uint8)('0' + i % 64);
+	}
+
+	simPhoneSend(payload, 1000);
+	(void)simRunUntil(simNow() + SIM_MS(1100));
+	CHECK(uart_rx_len < 1000);
+
+	reply = simBridgeCommand("+++");
+	CHECK(strstr(reply, "OK") != 0);
+	
+	/** the last of them may still be in the uart sink when the OK goes out **/
+	(void)simRunUntil(simNow() + SIM_SEC(8));
+	CHECK(uart_rx_len == 1000 && !memcmp(uart_rx, payload, 1000));
+
+	/** echo answers, so it really left pipe **/
+	reply = simBridgeCommand("AT+STATS\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+
+	/** "++" after the guard time is payload and gets its gather sample **/
+	uart_rx_len = 0;
+	CHECK(simBridgePipe(1152, 1, 0, 1, 1));
+	gathered = gatherSamples();
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	simPhoneSend((const uint8*)"++", 2);
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	CHECK(uart_rx_len == 2 && !memcmp(uart_rx, "++", 2));
+	CHECK(gatherSamples() == gathered + 1);
+
+	/** "???" in pipe is answered there and never reaches the uart **/
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	(void)simPhoneTake(0);
+	simPhoneSend((const uint8*)"???", 3);
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	CHECK(strstr(simPhoneTake(0), "OK") != 0);
+	CHECK(!((sppb_task_t*)getSppbTask()) ->packing);
+	CHECK(uart_rx_len == 2);
+
+	/** with frames still queued it waits for them, what the peer sends behind it follows the report **/
+	(void)simBridgeCommand("+++");
+	CHECK(simBridgePipe(12, 1, 0, 1, 1));
+	uart_rx_len = 0;
+	simPhoneSend(payload, 1000);
+	(void)simRunUntil(simNow() + SIM_MS(1100));
+	(void)simPhoneTake(0);
+	simPhoneSend((const uint8*)"???", 3);
+	(void)simRunUntil(simNow() + SIM_MS(1100));
+	simPhoneSend((const uint8*)"ab", 2);
+	(void)simRunUntil(simNow() + SIM_MS(100));
+	CHECK(uart_rx_len < 1000);
+	CHECK(strstr(simPhoneTake(0), "OK") == 0);
+	(void)simRunUntil(simNow() + SIM_SEC(9));
+	CHECK(strstr(simPhoneTake(0), "OK") != 0);
+	CHECK(uart_rx_len == 1002 && !memcmp(uart_rx, payload, 1000) && !memcmp(uart_rx + 1000, "ab", 2));
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+
+	/** fuzz, full duplex so anything the phone gets is an echo reply **/
+	(void)simBridgeCommand("+++");
+	CHECK(simBridgePipe(1152, 1, 0, 2, 0));
+	uart_rx_len = 0;
+	srand(FUZZ_SEED);
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+
+	for (i = 0; i < FUZZ_BURSTS; i++) {
+
+		uint8 burst[8];
+		uint16 len = fuzzBurst(burst);
+		bool escape = len == 3 && !memcmp(burst, "+++", 3);
+		bool left;
+
+		(void)simPhoneTake(0);
+		sendBurst(burst, len);
+		(void)simRunUntil(simNow() + SIM_MS(1500));
+
+		left = strstr(simPhoneTake(0), "OK") != 0;
+
+		if (escape) {
+
+			escapes++;
+		}
+		else {
+
+			memcpy(payload + payload_len, burst, len);
+			payload_len += len;
+		}
+
+		if (left && !escape) {
+
+			false_positives++;
+		}
+		else if (!left && escape) {
+
+			false_negatives++;
+		}
+
+		if (left) {
+
+			CHECK(simBridgePipe(1152, 1, 0, 2, 0));
+			(void)simRunUntil(simNow() + SIM_MS(1500));
+		}
+	}
+
+	printf("test_escape: %u bursts, %u escapes, %u false positives, %u false negatives\n",
+		   FUZZ_BURSTS, escapes, false_positives, false_negatives);
+
+	CHECK(escapes > 0);
+	CHECK(false_positives == 0);
+	CHECK(false_negatives == 0);
+	CHECK(uart_rx_len == payload_len && !memcmp(uart_rx, payload, payload_len));
+
+	CHECK(sim_counters.panics == 0);
+
+	free(payload);
+
+	return checkDone("test_escape");
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+
+#include "sim.h"
+#include "check.h"
+
+/**************************************
+
+  what the rgb led shows in each state of the booted firmware, against the combined patterns of
+  the old calcIndication():
+
+	pairable and echo while charging: blue flashes only, the battery colour stays hidden
+	pipe while charging: the battery level between the blue flashes, never both lit
+	pipe on a low battery: the red slow flash only, the blue one is hidden
+
+  **************************************/
+
+int app_main(void);
+
+#define PIO_CHARGER				(1 << 10)
+#define LED_GREEN				(1 << 0)
+#define LED_RED					(1 << 1)
+#define LED_BLUE				(1 << 2)
+#define LED_RGB					(LED_GREEN | LED_RED | LED_BLUE)
+
+static uint16 lit;				/** every colour lit since the last watch() **/
+static uint16 blue_flashes;
+static bool mixed;				/** blue lit with another colour **/
+
+static void pioChanged(uint16 changed, uint16 levels) {
+
+	levels &= LED_RGB & simPioDirection();
+	lit |= levels;
+
+	if ((changed & LED_BLUE) && (levels & LED_BLUE)) {
+
+		blue_flashes++;
+	}
+
+	if ((levels & LED_BLUE) && (levels & ~LED_BLUE)) {
+
+		mixed = TRUE;
+	}
+}
+
+/** the led over ms **/
+static void watch(uint32 ms) {
+
+	lit = simPioOutput() & simPioDirection() & LED_RGB;
+	blue_flashes = 0;
+	mixed = FALSE;
+
+	(void)simRunUntil(simNow() + SIM_MS(ms));
+}
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	byte = byte; end = end;
+}
+
+int main(void) {
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	sim_uart.rx = controllerRx;
+	sim_pio_hook = pioChanged;
+
+	(void)app_main();
+
+	CHECK(simBridgePowerOn());
+	watch(3000);
+	CHECK(lit == LED_BLUE);
+	CHECK(blue_flashes >= 10);
+
+	CHECK(simBridgeConnect());
+	watch(5000);
+	CHECK(lit == LED_BLUE);
+	CHECK(blue_flashes >= 4);
+
+	/** 4.0 V while charging, the fine level is green **/
+	CHECK(simBridgePipe(96, 1, 0, 1, 0));
+	watch(5000);
+	CHECK(lit == (LED_BLUE | LED_GREEN));
+	CHECK(blue_flashes >= 2);
+	CHECK(!mixed);
+
+	/** 3.45 V without the charger, shown at the next battery reading **/
+	simPioInput(PIO_CHARGER, 0);
+	simBatteryMv(1400);
+	(void)simRunUntil(simNow() + SIM_SEC(35));
+	watch(5000);
+	CHECK(lit == LED_RED);
+
+	CHECK(sim_counters.panics == 0);
+
+	return checkDone("test_indication");
+}
@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <pio.h>
+
+#include "sim.h"
+#include "check.h"
+#include "spp_dev_b_leds.h"
+#include "led_timeline.h"
+
+/**************************************
+
+  compiled led timeline against the ledparse entry engine it replaced, without the rest of the
+  firmware. both play the same cases in turn on the same pios, sim_pio_hook records the levels of
+  the led pios after each instant, and they must be the same up to the end of the case:
+
+	each pattern alone, a one shot up to the instant it is over
+	every repeating pattern with every one shot played over it, the repeating one resumed after
+	every one shot with a repeating pattern asked for as it starts, started when it is over
+
+  ledsPlay() resumes and queues patterns itself, the timeline is given the same patterns on one
+  layer at the instants ledsPlay() would switch. the timeline must not wake up more often than the
+  entry engine in any case.
+
+  the cases are played for the firmware's patterns and for the fixture ones from before the
+  indication layers (fixture_led.c), whose zero time entries are merged into steps and tails.
+
+  **************************************/
+
+#define CASE_MS				12000
+#define OVER_MS				1234		/** a one shot is played over a repeating pattern this far in **/
+#define WAVE_MAX			1024
+#define FIXTURE_ENTRIES		66			/** entries of fixture/spp_dev_b_leds.led **/
+
+typedef struct {
+
+	sim_time_t	at;				/** from the start of the case **/
+	uint16		levels;
+
+} wave_t;
+
+typedef struct {
+
+	wave_t		wave[WAVE_MAX];
+	uint16		count;
+
+} waveform_t;
+
+/** a pattern played at ms from the start of the case **/
+typedef struct {
+
+	uint32		ms;
+	uint16		pattern;
+
+} cue_t;
+
+/** a pattern set with both engines playing it **/
+typedef struct {
+
+	const char				*name;
+	const led_timeline_t	*patterns;
+	const uint16			*count;
+	const uint16			*pins_used;
+	bool					(*entry)(LedPattern_t pattern);
+	void					(*timeline)(uint16 layer, uint16 pattern, bool opaque);
+
+} pattern_set_t;
+
+/** fixture_led.c **/
+extern const led_timeline_t fixture_led_patterns[];
+extern const uint16 fixture_led_patterns_count;
+extern const uint16 fixture_led_pins_used;
+bool fixtureLedsPlay(LedPattern_t pattern);
+void fixtureLedTimelineSet(uint16 layer, uint16 pattern, bool opaque);
+
+static const pattern_set_t sets[] = {
+
+	{ "firmware", led_patterns, &led_patterns_count, &led_pins_used, ledsPlay, ledTimelineSet },
+	{ "fixture", fixture_led_patterns, &fixture_led_patterns_count, &fixture_led_pins_used, fixtureLedsPlay,
+	  fixtureLedTimelineSet }
+};
+
+static const pattern_set_t *set;
+static waveform_t entry, timeline;
+static waveform_t *recording;
+static sim_time_t base;
+
+/** levels after each instant, writes at the same instant make one entry **/
+static void pioChanged(uint16 changed, uint16 levels) {
+
+	sim_time_t at = simNow() - base;
+	uint16 *n = &recording ->count;
+
+	changed = changed;
+	levels &= *set ->pins_used;
+
+	if (*n && recording ->wave[*n - 1].at == at) {
+
+		(*n)--;
+	}
+
+	if (levels != (*n ? recording ->wave[*n - 1].levels : 0) && *n < WAVE_MAX) {
+
+		recording ->wave[*n].at = at;
+		recording ->wave[*n].levels = levels;
+		(*n)++;
+	}
+}
+
+static void entryPlay(void *pattern) {
+
+	(void)set ->entry((LedPattern_t)(long)pattern);
+}
+
+static void timelinePlay(void *pattern) {
+
+	set ->timeline(0, (uint16)(long)pattern, FALSE);
+}
+
+/** ms a one shot plays **/
+static uint32 patternMs(uint16 pattern) {
+
+	const led_timeline_t *t = &set ->patterns[pattern];
+	uint32 ms = 0;
+	uint16 i;
+
+	for (i = 0; i < t ->count; i++) {
+
+		ms += t ->steps[i].time;
+	}
+
+	return ms;
+}
+
+/** a repeating pattern of one step, it leaves the entry engine without a timer **/
+static uint16 steadyPattern(void) {
+
+	uint16 p;
+
+	for (p = 0; p < *set ->count; p++) {
+
+		const led_timeline_t *t = &set ->patterns[p];
+
+		if (t ->repeat && t ->count == 1 && !t ->tail_mask) {
+
+			break;
+		}
+	}
+
+	return p;
+}
+
+/** each engine in turn from silent pios, returns the messages each took **/
+static void play(const cue_t *entry_cues, uint16 entry_n, const cue_t *timeline_cues, uint16 timeline_n,
+				 uint32 *entry_msgs, uint32 *timeline_msgs) {
+
+	uint32 messages;
+	uint16 i;
+
+	/** the entry engine **/
+	base = simNow();
+	recording = &entry;
+	entry.count = 0;
+	messages = sim_counters.messages;
+
+	for (i = 0; i < entry_n; i++) {
+
+		simAt(base + SIM_MS(entry_cues[i].ms), entryPlay, (void*)(long)entry_cues[i].pattern);
+	}
+
+	(void)simRunUntil(base + SIM_MS(CASE_MS));
+	*entry_msgs = sim_counters.messages - messages;
+
+	/** a steady pattern leaves it without a timer, the pios are cleared for the timeline **/
+	sim_pio_hook = 0;
+	(void)set ->entry((LedPattern_t)steadyPattern());
+	(void)simRunUntil(simNow() + SIM_MS(10));
+	PioSet(*set ->pins_used, 0);
+	sim_pio_hook = pioChanged;
+
+	/** the timeline **/
+	base = simNow();
+	recording = &timeline;
+	timeline.count = 0;
+	messages = sim_counters.messages;
+
+	for (i = 0; i < timeline_n; i++) {
+
+		simAt(base + SIM_MS(timeline_cues[i].ms), timelinePlay, (void*)(long)timeline_cues[i].pattern);
+	}
+
+	(void)simRunUntil(base + SIM_MS(CASE_MS));
+	*timeline_msgs = sim_counters.messages - messages;
+
+	sim_pio_hook = 0;
+	set ->timeline(0, LED_PATTERN_NONE, FALSE);
+	(void)simRunUntil(simNow() + SIM_MS(10));
+	sim_pio_hook = pioChanged;
+}
+
+/** the waveforms agree before end **/
+static bool same(uint32 end_ms) {
+
+	sim_time_t end = SIM_MS(end_ms);
+	uint16 a = 0, b = 0;
+
+	while (a < entry.count && entry.wave[a].at < end) {
+
+		a++;
+	}
+
+	while (b < timeline.count && timeline.wave[b].at < end) {
+
+		b++;
+	}
+
+	return a == b && !memcmp(entry.wave, timeline.wave, a * sizeof(wave_t));
+}
+
+static uint32 entry_total, timeline_total;
+static uint16 cases, wrong;
+static uint16 steps, tails;
+
+static void check(const char *what, uint16 r, uint16 o, const cue_t *entry_cues, uint16 entry_n,
+				  const cue_t *timeline_cues, uint16 timeline_n, uint32 end_ms) {
+
+	uint32 e, t;
+	bool ok;
+
+	play(entry_cues, entry_n, timeline_cues, timeline_n, &e, &t);
+	ok = same(end_ms);
+
+	CHECK(ok);
+	CHECK(t <= e);
+
+	if (!ok) {
+
+		fprintf(stderr, "  %s %s %u %u: the waveforms differ\n", set ->name, what, r, o);
+		wrong++;
+	}
+
+	cases++;
+	entry_total += e;
+	timeline_total += t;
+}
+
+/** every case of one set **/
+static void checkSet(const pattern_set_t *s) {
+
+	uint16 count = *s ->count;
+	uint16 r, o;
+
+	set = s;
+	cases = wrong = 0;
+	steps = tails = 0;
+	entry_total = timeline_total = 0;
+
+	for (r = 0; r < count; r++) {
+
+		cue_t alone[1];
+
+		alone[0].ms = 0;
+		alone[0].pattern = r;
+
+		check("alone", r, r, alone, 1, alone, 1, set ->patterns[r].repeat ? CASE_MS : patternMs(r));
+
+		steps += set ->patterns[r].count;
+		tails += set ->patterns[r].tail_mask != 0;
+	}
+
+	for (r = 0; r < count; r++) {
+		for (o = 0; o < count; o++) {
+
+			cue_t entry_cues[2], timeline_cues[3];
+
+			if (!set ->patterns[r].repeat || set ->patterns[o].repeat) {
+
+				continue;
+			}
+
+			/** the one shot over the repeating pattern, which starts again when it is over **/
+			entry_cues[0].ms = 0;
+			entry_cues[0].pattern = r;
+			entry_cues[1].ms = OVER_MS;
+			entry_cues[1].pattern = o;
+
+			memcpy(timeline_cues, entry_cues, sizeof(entry_cues));
+			timeline_cues[2].ms = OVER_MS + patternMs(o);
+			timeline_cues[2].pattern = r;
+
+			check("over", r, o, entry_cues, 2, timeline_cues, 3, CASE_MS);
+
+			/** the repeating pattern asked for as the one shot starts, ledsPlay() later on would cut the
+				one shot's current entry short **/
+			entry_cues[0].ms = 0;
+			entry_cues[0].pattern = o;
+			entry_cues[1].ms = 0;
+			entry_cues[1].pattern = r;
+
+			timeline_cues[0] = entry_cues[0];
+			timeline_cues[1].ms = patternMs(o);
+			timeline_cues[1].pattern = r;
+
+			check("before", r, o, entry_cues, 2, timeline_cues, 2, CASE_MS);
+		}
+	}
+
+	printf("test_led: %s, %u patterns in %u steps, %u with a tail, %u cases, %u differ, "
+		   "%lu entry engine wakeups, %lu timeline wakeups\n", set ->name, count, steps, tails, cases, wrong,
+		   (unsigned long)entry_total, (unsigned long)timeline_total);
+	CHECK(timeline_total < entry_total);
+}
+
+int main(void) {
+
+	simReset();
+	sim_pio_hook = pioChanged;
+
+	checkSet(&sets[0]);
+
+	/** the zero time entries of the fixture are merged into steps, the trailing ones into tails **/
+	checkSet(&sets[1]);
+	CHECK(steps < FIXTURE_ENTRIES);
+	CHECK(tails > 0);
+
+	return checkDone("test_led");
+}
@@ -0,0 +1,106 @@
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "stats.h"
+
+/**************************************
+
+  spp -> uart packing window at a high rate, where 3.5 characters of line silence are far shorter than
+  the gap between two rfcomm packets:
+
+	a 256-byte frame that arrives as two 128-byte packets may be split the first time, the gap is
+	learned from it and later frames go to the uart whole. short requests sent further apart than
+	that gap stay frames of their own.
+
+  **************************************/
+
+int app_main(void);
+
+#define FRAME				256
+#define FRAMES				10
+#define REQUEST				8
+
+static uint8 uart_rx[FRAME * FRAMES];
+static uint16 uart_rx_len;
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	end = end;
+
+	if (uart_rx_len < sizeof(uart_rx)) {
+
+		uart_rx[uart_rx_len] = byte;
+	}
+
+	uart_rx_len++;
+}
+
+static void frameFill(uint8 *p, uint16 len, uint8 seed) {
+
+	uint16 i;
+
+	for (i = 0; i < len; i++) {
+
+		p[i] = (uint8)(seed + i * 3);
+	}
+}
+
+int main(void) {
+
+	uint8 frame[FRAME];
+	uint16 split = 0;
+	uint32 frames;
+	uint16 i;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+	sim_uart.rx = controllerRx;
+	sim_phone.frame_size = FRAME / 2;
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+	CHECK(simBridgePipe(9216, 1, 0, 1, 1));
+
+	for (i = 0; i < FRAMES; i++) {
+
+		uint32 packets = sim_phone.tx_packets;
+
+		frames = stats_counter[STAT_SPP_TO_UART_FRAMES];
+		uart_rx_len = 0;
+		frameFill(frame, FRAME, (uint8)i);
+		simPhoneSend(frame, FRAME);
+		(void)simRunUntil(simNow() + SIM_MS(100));
+
+		CHECK(sim_phone.tx_packets - packets == 2);
+		CHECK(uart_rx_len == FRAME && !memcmp(uart_rx, frame, FRAME));
+
+		if (stats_counter[STAT_SPP_TO_UART_FRAMES] - frames != 1) {
+
+			split++;
+
+			/** only before the gap was known **/
+			CHECK(i == 0);
+		}
+	}
+
+	printf("test_pack: %u of %u frames split\n", split, FRAMES);
+
+	/** a short request doesn't fill a packet, the gap after it is not one inside a frame **/
+	frames = stats_counter[STAT_SPP_TO_UART_FRAMES];
+
+	for (i = 0; i < FRAMES; i++) {
+
+		frameFill(frame, REQUEST, (uint8)i);
+		simPhoneSend(frame, REQUEST);
+		(void)simRunUntil(simNow() + SIM_MS(10));
+	}
+
+	(void)simRunUntil(simNow() + SIM_MS(100));
+	CHECK(stats_counter[STAT_SPP_TO_UART_FRAMES] - frames == FRAMES);
+
+	CHECK(sim_uart.lost == 0);
+
+	return checkDone("test_pack");
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+#include "stats.h"
+#include "sppb.h"
+
+/**************************************
+
+  spp -> uart frame queue under load: 10k frames of random sizes, sent back-to-back or a few ms
+  apart, so that many are packed while the ones ahead of them are still waiting for the rs485 driver
+  or the uart. now and then a burst of short frames fills the descriptor table and the newest ones
+  are merged. every byte must reach the controller once and in order, nothing is dropped, and none of
+  them is copied by the vm, they go from the spp source to the uart sink with StreamMove().
+
+  **************************************/
+
+int app_main(void);
+
+#define FRAMES				10000
+#define FRAME_MAX			256
+#define PHONE_BACKLOG		2048
+#define SEED				4242
+#define BURST_EVERY			500		/** frames **/
+#define BURST				20		/** short frames 4 ms apart, more than the descriptor table holds **/
+#define BURST_LEAD			4		/** full frames back-to-back that fill the uart sink before them **/
+
+static uint8 *expected;
+static uint32 expected_len;
+
+static uint8 *uart_rx;
+static uint32 uart_rx_len;
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	end = end;
+
+	if (uart_rx_len < expected_len) {
+
+		uart_rx[uart_rx_len] = byte;
+	}
+
+	uart_rx_len++;
+}
+
+int main(void) {
+
+	static const sim_time_t gaps[] = { 0, SIM_MS(5), SIM_MS(10), SIM_MS(20), SIM_MS(40) };
+	const frame_queue_t *queue = &((sppb_task_t*)getSppbTask()) ->spp_frames;
+	uint16 deepest = 0;
+	uint32 i;
+
+	simReset();
+	simSetLoopLimit(SIM_MS(100));
+	(void)app_main();
+	sim_uart.rx = controllerRx;
+
+	expected = malloc((size_t)FRAMES * FRAME_MAX);
+	uart_rx = malloc((size_t)FRAMES * FRAME_MAX);
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+	CHECK(simBridgePipe(1152, 1, 0, 1, 1));
+	memset(stats_counter, 0, sizeof(stats_counter));
+	sim_uart.claimed = 0;
+
+	srand(SEED);
+
+	for (i = 0; i < FRAMES; i++) {
+
+		uint16 step = i % BURST_EVERY;
+		uint16 len = 1 + rand() % FRAME_MAX;
+		sim_time_t gap = gaps[rand() % (sizeof(gaps) / sizeof(gaps[0]))];
+		uint16 j;
+
+		if (step < BURST_LEAD) {
+
+			len = FRAME_MAX;
+			gap = 0;
+		}
+		else if (step < BURST_LEAD + BURST) {
+
+			len = 8;
+			gap = SIM_MS(4);
+		}
+
+		for (j = 0; j < len; j++) {
+
+			expected[expected_len + j] = (uint8)rand();
+		}
+
+		/** the phone doesn't queue without bound either **/
+		while (simPhonePending() > PHONE_BACKLOG) {
+
+			(void)simRunUntil(simNow() + SIM_MS(1));
+		}
+
+		simPhoneSend(expected + expected_len, len);
+		expected_len += len;
+		(void)simRunUntil(simNow() + gap);
+
+		if (queue ->count > deepest) {
+
+			deepest = queue ->count;
+		}
+	}
+
+	(void)simRunUntil(simNow() + SIM_SEC(2));
+
+	printf("test_queue: %lu bytes in %lu frames, %lu uart frames, %lu merged, up to %u queued\n",
+		   (unsigned long)expected_len, (unsigned long)FRAMES,
+		   (unsigned long)stats_counter[STAT_SPP_TO_UART_FRAMES], (unsigned long)stats_counter[STAT_FRAMES_MERGED], deepest);
+
+	CHECK(uart_rx_len == expected_len && !memcmp(uart_rx, expected, expected_len));
+	CHECK(stats_counter[STAT_BYTES_DROPPED] == 0);
+	CHECK(stats_counter[STAT_EXCEPTIONS] == 0);
+	CHECK(sim_uart.lost == 0 && sim_uart.overruns == 0);
+	CHECK(sim_uart.claimed == 0);
+
+	/** queued separately, not all run together **/
+	CHECK(stats_counter[STAT_SPP_TO_UART_FRAMES] > FRAMES / 4);
+	CHECK(deepest == FRAME_QUEUE_DEPTH);
+	CHECK(stats_counter[STAT_FRAMES_MERGED] > 0);
+
+	free(expected);
+	free(uart_rx);
+
+	return checkDone("test_queue");
+}
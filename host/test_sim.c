@@ -0,0 +1,74 @@
+#include <string.h>
+
+#include "sim.h"
+#include "check.h"
+
+/**************************************
+
+  smoke test of the simulator with the whole firmware: power on, connect, AT+CONNECT, bytes both
+  ways through the pipe, +++ back to echo. main() runs as app_main() until the loop limit.
+
+  **************************************/
+
+int app_main(void);
+
+static char uart_rx[256];
+static uint16 uart_rx_len;
+
+static void controllerRx(uint8 byte, sim_time_t end) {
+
+	end = end;
+
+	if (uart_rx_len < sizeof(uart_rx) - 1) {
+
+		uart_rx[uart_rx_len++] = (char)byte;
+	}
+}
+
+int main(void) {
+
+	const char *reply;
+	uint16 len;
+
+	simReset();
+	sim_uart.rx = controllerRx;
+
+	/** main() with nothing happening, the loop runs to the limit **/
+	simSetLoopLimit(SIM_SEC(1));
+	CHECK(app_main() == 0);
+	CHECK(sim_counters.panics == 0);
+	CHECK(sim_counters.messages > 0);
+
+	CHECK(simBridgePowerOn());
+	CHECK(simBridgeConnect());
+
+	reply = simBridgeCommand("AT+CONNECT=1152,1,0,2,0\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+
+	/** pipe, the phone's bytes reach the controller **/
+	simPhoneSend((const uint8*)"hello", 5);
+	(void)simRunUntil(simNow() + SIM_MS(200));
+	CHECK(uart_rx_len == 5 && !memcmp(uart_rx, "hello", 5));
+	CHECK(simUartBridgeBaud() == 115234);
+
+	/** and the controller's reach the phone **/
+	simUartSend((const uint8*)"world", 5);
+	(void)simRunUntil(simNow() + SIM_MS(200));
+	reply = simPhoneTake(&len);
+	CHECK(len == 5 && !memcmp(reply, "world", 5));
+
+	/** +++ framed by a second of silence is back to echo **/
+	(void)simRunUntil(simNow() + SIM_MS(1500));
+	reply = simBridgeCommand("+++");
+	CHECK(strstr(reply, "OK") != 0);
+	CHECK(uart_rx_len == 5);
+
+	reply = simBridgeCommand("AT+STATS\r\n");
+	CHECK(strstr(reply, "OK") != 0);
+
+	CHECK(sim_counters.panics == 0);
+	CHECK(sim_counters.boot_mode_sets == 0);
+	CHECK(sim_uart.lost == 0 && sim_uart.collisions == 0 && sim_uart.overruns == 0);
+
+	return checkDone("test_sim");
+}
@@ -4,159 +4,122 @@
 #include "spp_dev_private.h"
 #include "indication.h"
 #include "spp_dev_b_leds.h"
+#include "led_timeline.h"
 
-static uint16 currentState = IND_NONE;
+static uint16 batteryLevel(uint32 voltage) {
 
-uint16 calcIndication(void);
+	if (voltage > IND_BATT_FINE_MV) {
 
-uint16 calcIndication(void) {
+		return BATT_FINE;
+	}
+	else if (voltage > IND_BATT_MODEST_MV) {
+
+		return BATT_MODEST;
+	}
 
-	halTaskData* hal_task;
-	sppb_task_t* sppb_task;
+	return BATT_LOW;
+}
+
+void indicationBattery(void) {
 
-	
-	hal_task = (halTaskData*)getHalTask();
-	sppb_task = (sppb_task_t*)getSppbTask();
+	halTaskData* hal_task = (halTaskData*)getHalTask();
+	sppb_task_t* sppb_task = (sppb_task_t*)getSppbTask();
+	uint16 pattern = LED_PATTERN_NONE;
+	uint16 warning = LED_PATTERN_NONE;
 
-	switch(hal_task ->state)
+	switch (hal_task ->state)
 	{
 		case INITIALISING:
 
 			if (hal_task ->voltage == 0xFFFF || hal_task ->charging_state == CHARGING_UNKNOWN) {
 
-				return IND_UNKNOWN;
+				pattern = BATT_UNKNOWN;
 			}
 			else {
 
-				if (hal_task ->voltage > 3900) {
-
-					return IND_BATT_FINE;
-				}
-				else if (hal_task ->voltage > 3600) {
-
-					return IND_BATT_MODEST;
-				}
-				else {
-					return IND_BATT_LOW;
-				}
+				pattern = batteryLevel(hal_task ->voltage);
 			}
 			break;
-			
-		case ACTIVATING:
 
-			return IND_NONE;
-			break;
-			
 		case ACTIVE:
 
-			switch(sppb_task ->state) 
-			{
-				case SPPB_STATE_NUM:
-				case SPPB_INITIALISING:
-				case SPPB_READY:
-				case SPPB_DISCONNECTING:
-
-					return IND_NONE;
-					break;
-
-				case SPPB_PAIRABLE:
-				case SPPB_CONNECTING:
-
-					return IND_INQUIRY_PAGE_ON;
-					break;
-
-				case SPPB_CONNECTED:
-
-					switch(sppb_task ->conn_state) {
+			/** the scan and echo flashes own the led, the battery only shows with the pipe **/
+			if (sppb_task ->state != SPPB_CONNECTED || sppb_task ->conn_state != CONN_PIPE) {
 
-						case CONN_ECHO:
-
-							return IND_ECHO;
-							break;
-
-						case CONN_PIPE:
+				break;
+			}
 
-							switch(hal_task ->charging_state) {
+			switch (hal_task ->charging_state) {
 
-								case CHARGING_CHARGING:
+				case CHARGING_CHARGING:
 
-									if (hal_task ->voltage > 3900) {
-										return IND_PIPE_CHG_BATT_FINE;
-									}
-									else if (hal_task ->voltage > 3600) {
+					pattern = batteryLevel(hal_task ->voltage);
+					break;
 
-										return IND_PIPE_CHG_BATT_MODEST;
-									}
-									else {
-										return IND_PIPE_CHG_BATT_LOW;
-									}
-									break;
+				case CHARGING_NOT_CHARGING:
 
-								case CHARGING_NOT_CHARGING:
+					if (hal_task ->voltage <= IND_BATT_MODEST_MV) {
 
-									if (hal_task ->voltage >3600) {
-										return IND_PIPE_BATT_NOT_LOW;
-									}
-									else {
-										return IND_PIPE_BATT_LOW;
-									}
-									break;
-									
-								case CHARGING_UNKNOWN:
-									
-									return currentState;
-							}
-							break;
+						warning = BATT_LOW_FLASH;
 					}
-
 					break;
-				}
-			
-			
-			break;
-		case DEACTIVATING:
-
-			return IND_NONE;
-			break;
-	}
 
-	/** should not go here **/
-	return IND_NONE;
-}
+				case CHARGING_UNKNOWN:
 
-void update_indication(void) {
-	
-	uint16 state = calcIndication();
+					/** keep what is shown **/
+					return;
+			}
+			break;
 
-	if (state == currentState) {
+		default:
 
-		return;
+			break;
 	}
-	
-	currentState = state;
-	
-	ledsPlay(currentState);
-}
-
-
-
-
-
-
-
-
 
+	ledTimelineSet(IND_LAYER_ERROR, warning, TRUE);
+	ledTimelineSet(IND_LAYER_BATTERY, pattern, FALSE);
+}
 
+void indicationLink(void) {
 
+	sppb_task_t* sppb_task = (sppb_task_t*)getSppbTask();
+	uint16 pattern = LED_PATTERN_NONE;
+	bool opaque = TRUE;
 
+	switch (sppb_task ->state)
+	{
+		case SPPB_PAIRABLE:
+		case SPPB_CONNECTING:
 
+			pattern = LINK_SCAN;
+			break;
 
+		case SPPB_CONNECTED:
 
+			if (sppb_task ->conn_state == CONN_PIPE) {
 
+				/** the battery colour shows between the pipe flashes **/
+				pattern = LINK_PIPE;
+				opaque = FALSE;
+			}
+			else {
 
+				pattern = LINK_ECHO;
+			}
+			break;
 
+		default:
 
+			break;
+	}
 
+	ledTimelineSet(IND_LAYER_LINK, pattern, opaque);
 
+	/** the battery layers follow the pipe **/
+	indicationBattery();
+}
 
+void indicationBeep(LedPattern_t beep) {
 
+	ledTimelineSet(IND_LAYER_BUZZER, beep, FALSE);
+}
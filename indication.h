@@ -9,66 +9,46 @@
 
 Indication Logic
 
-First, check hal state.
-
-1.Hal init
-1.charging? Display batt level
-2.not charging? Display batt level
-2.Activating, no leds, just beep
-3.active
-1.bt ??C pairable, connecting, Fast blue flash, no batt or charging indication
-2.connected - echo, Fast white flash, no batt or charging indication
-3.connected ??C pipe, Slow blue flash, with or without batt, depends on charging
-4.disconnecting, ready, connection off, so no blue; if charging, persistent batt, otherwise, off.
-4.Deactivating, no leds, just beep.
-
-
-IND_NONE
-IND_UNKNOWN
-IND_BATT_LOW
-IND_BATT_MODEST
-IND_BATT_FINE
-IND_BLUE_FAST_FLASH
-IND_WHITE_FAST_FLASH
-IND_SLOW_BLUE_FLASH
-IND_BATT_LOW_BLUE_BREATH
-IND_BATT_MODEST_BLUE_BREATH
-IND_BATT_FINE_BLUE_BREATH
+Every input drives its own layer of led_timeline, the layers are composited per step, the top
+layer lighting the rgb led owns it, an opaque one owns it in its dark steps too, and the buzzer
+sounds for any layer. Setting the pattern a layer already plays does nothing. The led shows what
+the combined patterns of calcIndication() showed, up to the phase of the flashes.
+
+1.error, top layer, opaque, hal state, charging state, voltage and pipe
+	active, pipe, not charging and low: slow red flash, the link flash is hidden
+2.link, sppb state
+	pairable, connecting: fast blue flash, opaque
+	connected - echo: three fast and one slow blue flash, opaque
+	connected - pipe: slow blue flash, the battery level shows between the flashes
+	ready, disconnecting: off
+3.battery, hal state, charging state, voltage and pipe
+	hal init: battery level, white until it is known
+	active, pipe and charging: battery level
+	activating, deactivating: off
+4.buzzer
+	activating, deactivating: beep twice
 
 ****************************************************/
 
-#define IND_NONE 						ALL_LEDS_OFF		/** ready & disconnecting **/
-#define IND_UNKNOWN						WHITE_ON
-#define IND_BATT_LOW					RED_ON
-#define IND_BATT_MODEST					RED_GREEN_ON
-#define IND_BATT_FINE					GREEN_ON  /**/
-
-#define IND_INQUIRY_PAGE_ON				BLUE_FAST_FLASH		/** pairable & connecting **/
-#define IND_ECHO					    BLUE_THRICE_FAST_ONICE_SLOW_FLASH	/*WHITE_FAST_FLASH   GREEN_FAST_FLASH*/
-
-#define IND_PIPE_BATT_NOT_LOW			BLUE_SLOW_FLASH
-#define IND_PIPE_BATT_LOW				RED_SLOW_FLASH
+typedef enum {
 
-#define IND_PIPE_CHG_BATT_LOW			RED_ON_BLUE_SLOW_FLASH
-#define IND_PIPE_CHG_BATT_MODEST		RED_GREEN_ON_BLUE_SLOW_FLASH
-#define IND_PIPE_CHG_BATT_FINE			GREEN_ON_BLUE_SLOW_FLASH
+	IND_LAYER_ERROR,
+	IND_LAYER_LINK,
+	IND_LAYER_BATTERY,
+	IND_LAYER_BUZZER
 
-/***************************************************
-  
-  This function update leds, call this function when:
-  
-  1. PIO change
-  2. Battery Change
-  3. state change
-  
-****************************************************/
+} ind_layer_t;
 
-void update_indication(void);
+#define IND_BATT_FINE_MV				3900
+#define IND_BATT_MODEST_MV				3600	/** also the not charging low warning **/
 
+/** hal state, charging state or voltage changed, sets the error and battery layers **/
+void indicationBattery(void);
 
+/** sppb state or connected sub state changed, the battery layers follow **/
+void indicationLink(void);
 
+/** one shot on the buzzer layer **/
+void indicationBeep(LedPattern_t beep);
 
 #endif /* INDICATION_H */
-
-
-
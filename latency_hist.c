@@ -0,0 +1,50 @@
+#include <csrtypes.h>
+
+#include "latency_hist.h"
+#include "echo_text.h"
+
+
+void latencyHistReset(latency_hist_t* h, uint16 count) {
+
+	uint16 i;
+
+	for (; count; count--, h++) {
+
+		for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+
+			h ->count[i] = 0;
+		}
+	}
+}
+
+void latencyHistAdd(latency_hist_t* h, uint32 ms) {
+
+	uint16 bucket = 0;
+
+	while (ms && bucket < LATENCY_HIST_BUCKETS - 1) {
+
+		ms >>= 1;
+		bucket++;
+	}
+
+	if (h ->count[bucket] != 0xFFFF) {
+
+		h ->count[bucket]++;
+	}
+}
+
+char* latencyHistFormat(char* p, const latency_hist_t* h, const char* tag) {
+
+	uint16 i;
+
+	p = echoTextString(p, "+LATENCY:");
+	p = echoTextString(p, tag);
+
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+
+		*p++ = ',';
+		p = echoTextUint(p, h ->count[i]);
+	}
+
+	return echoTextString(p, "\r\n");
+}
@@ -0,0 +1,29 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  log2 latency histogram in milliseconds. bucket 0 counts 0 ms, bucket n counts [2^(n-1), 2^n) ms,
+  the last bucket also takes everything above. counters saturate instead of wrapping.
+
+  **************************************/
+
+#define LATENCY_HIST_BUCKETS	12		/** last bucket is >= 1024 ms **/
+
+typedef struct {
+
+	uint16 count[LATENCY_HIST_BUCKETS];
+
+} latency_hist_t;
+
+/** clear count histograms starting at h **/
+void latencyHistReset(latency_hist_t* h, uint16 count);
+
+void latencyHistAdd(latency_hist_t* h, uint32 ms);
+
+/** "+LATENCY:<tag>,<b0>,...,<b11>\r\n" at p, returns new end **/
+char* latencyHistFormat(char* p, const latency_hist_t* h, const char* tag);
+
+#endif /** LATENCY_HIST_H **/
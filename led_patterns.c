@@ -0,0 +1,100 @@
+/**************************************
+
+  generated by tools/led_compile.py from spp_dev_b_leds.led, do not edit.
+
+  **************************************/
+
+#include "led_timeline.h"
+
+const uint16 led_pins_used = 0x0807;
+const uint16 led_pins_mixed = 0x0800;
+
+/** BATT_UNKNOWN **/
+static const led_step_t steps_BATT_UNKNOWN[1] = {
+	{ 0x0007, 0x0007,    0 }
+};
+
+/** BATT_LOW **/
+static const led_step_t steps_BATT_LOW[1] = {
+	{ 0x0002, 0x0002,    0 }
+};
+
+/** BATT_MODEST **/
+static const led_step_t steps_BATT_MODEST[1] = {
+	{ 0x0003, 0x0003,    0 }
+};
+
+/** BATT_FINE **/
+static const led_step_t steps_BATT_FINE[1] = {
+	{ 0x0001, 0x0001,    0 }
+};
+
+/** BATT_LOW_FLASH **/
+static const led_step_t steps_BATT_LOW_FLASH[2] = {
+	{ 0x0002, 0x0002,  200 },
+	{ 0x0002, 0x0000, 2000 }
+};
+
+/** LINK_SCAN **/
+static const led_step_t steps_LINK_SCAN[2] = {
+	{ 0x0004, 0x0004,  100 },
+	{ 0x0004, 0x0000,  100 }
+};
+
+/** LINK_ECHO **/
+static const led_step_t steps_LINK_ECHO[8] = {
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,   50 },
+	{ 0x0004, 0x0000,   50 },
+	{ 0x0004, 0x0004,  500 },
+	{ 0x0004, 0x0000, 2000 }
+};
+
+/** LINK_PIPE **/
+static const led_step_t steps_LINK_PIPE[2] = {
+	{ 0x0004, 0x0004,  200 },
+	{ 0x0004, 0x0000, 2000 }
+};
+
+/** BEEP_ONCE **/
+static const led_step_t steps_BEEP_ONCE[2] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+/** BEEP_TWICE **/
+static const led_step_t steps_BEEP_TWICE[4] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+/** BEEP_THREE_TIMES **/
+static const led_step_t steps_BEEP_THREE_TIMES[6] = {
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 },
+	{ 0x0800, 0x0800,  300 },
+	{ 0x0800, 0x0000,  100 }
+};
+
+const led_timeline_t led_patterns[11] = {
+	{ steps_BATT_UNKNOWN, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_BATT_LOW, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_BATT_MODEST, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_BATT_FINE, 1, TRUE, 0x0000, 0x0000 },
+	{ steps_BATT_LOW_FLASH, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_LINK_SCAN, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_LINK_ECHO, 8, TRUE, 0x0000, 0x0000 },
+	{ steps_LINK_PIPE, 2, TRUE, 0x0000, 0x0000 },
+	{ steps_BEEP_ONCE, 2, FALSE, 0x0000, 0x0000 },
+	{ steps_BEEP_TWICE, 4, FALSE, 0x0000, 0x0000 },
+	{ steps_BEEP_THREE_TIMES, 6, FALSE, 0x0000, 0x0000 }
+};
+
+const uint16 led_patterns_count = 11;
@@ -0,0 +1,196 @@
+#include <csrtypes.h>
+#include <message.h>
+#include <pio.h>
+#include <vm.h>
+
+#include "led_timeline.h"
+
+#define LED_TIMELINE_STEP		(0x0)
+
+typedef struct {
+
+	uint16	pattern;		/** LED_PATTERN_NONE when idle **/
+	uint16	position;		/** next step **/
+	bool	timed;			/** FALSE for a steady pattern **/
+	uint32	due;			/** clock of the next step **/
+	uint16	pins;			/** levels of this layer **/
+	bool	opaque;			/** owns the led while it plays, dark steps included **/
+
+} led_layer_t;
+
+typedef struct {
+
+	TaskData		task;
+
+	led_layer_t		layer[LED_LAYERS];
+
+	/** levels last written and pios already set as outputs **/
+	uint16			pins;
+	uint16			driven;
+
+} led_timeline_state_t;
+
+static void ledTimelineHandler(Task task, MessageId id, Message message);
+
+static led_timeline_state_t led = {
+
+	{ ledTimelineHandler },
+	{ { LED_PATTERN_NONE }, { LED_PATTERN_NONE }, { LED_PATTERN_NONE }, { LED_PATTERN_NONE } }
+};
+
+
+/** only the pios whose level changes are written **/
+static void ledTimelineWrite(uint16 bits) {
+
+	uint16 change = led_pins_used & ((led.pins ^ bits) | ~led.driven);
+
+	if (change == 0) {
+
+		return;
+	}
+
+	led.pins = (led.pins & ~change) | (bits & change);
+	led.driven |= change;
+
+#ifdef SPECIAL_LED_PINS
+	/** led pins are special cases **/
+	if (change & 0x8000) {
+
+		PioSetLed0((bits & 0x8000) != 0);
+	}
+	if (change & 0x4000) {
+
+		PioSetLed1((bits & 0x4000) != 0);
+	}
+	change &= 0x3fff;
+#endif
+
+	PioSetDir(change, change);
+	PioSet(change, bits & change);
+}
+
+/** play the next step of a layer **/
+static void ledLayerStep(led_layer_t* l) {
+
+	const led_timeline_t* t = &led_patterns[l ->pattern];
+	const led_step_t* s;
+
+	if (l ->position >= t ->count) {
+
+		if (!t ->repeat) {
+
+			l ->pattern = LED_PATTERN_NONE;
+			l ->pins = 0;
+			return;
+		}
+
+		l ->pins = (l ->pins & ~t ->tail_mask) | t ->tail_bits;
+		l ->position = 0;
+	}
+
+	s = &t ->steps[l ->position];
+	l ->pins = (l ->pins & ~s ->mask) | s ->bits;
+	l ->due += s ->time;
+	l ->position++;
+
+	/** a steady pattern needs no timer **/
+	l ->timed = !t ->repeat || t ->count != 1 || t ->tail_mask;
+}
+
+/** composite the layers into the pios and wait for the next step of any of them **/
+static void ledTimelineUpdate(uint32 now) {
+
+	uint16 bits = 0;
+	bool owned = FALSE;
+	bool timed = FALSE;
+	uint32 next = 0;
+	uint16 i;
+
+	for (i = 0; i < LED_LAYERS; i++) {
+
+		led_layer_t* l = &led.layer[i];
+
+		if (l ->pattern == LED_PATTERN_NONE) {
+
+			continue;
+		}
+
+		bits |= l ->pins & led_pins_mixed;
+
+		if (!owned && ((l ->pins & ~led_pins_mixed) || l ->opaque)) {
+
+			/** the top layer lighting the led, or an opaque one, sets its colour **/
+			bits |= l ->pins & ~led_pins_mixed;
+			owned = TRUE;
+		}
+
+		if (l ->timed && (!timed || (int32)(l ->due - next) < 0)) {
+
+			next = l ->due;
+			timed = TRUE;
+		}
+	}
+
+	ledTimelineWrite(bits);
+
+	if (timed) {
+
+		MessageSendLater(&led.task, LED_TIMELINE_STEP, 0, (int32)(next - now) > 0 ? next - now : 0);
+	}
+}
+
+static void ledTimelineHandler(Task task, MessageId id, Message message) {
+
+	uint32 now = VmGetClock();
+	uint16 i;
+
+	task = task; message = message;
+
+	if (id != LED_TIMELINE_STEP) {
+
+		return;
+	}
+
+	for (i = 0; i < LED_LAYERS; i++) {
+
+		led_layer_t* l = &led.layer[i];
+
+		/** steps are timed from the due clock, layers keep their phase when the message is late **/
+		while (l ->pattern != LED_PATTERN_NONE && l ->timed && (int32)(l ->due - now) <= 0) {
+
+			ledLayerStep(l);
+		}
+	}
+
+	ledTimelineUpdate(now);
+}
+
+void ledTimelineSet(uint16 layer, uint16 pattern, bool opaque) {
+
+	led_layer_t* l = &led.layer[layer];
+	uint32 now = VmGetClock();
+
+	if (pattern != LED_PATTERN_NONE && pattern >= led_patterns_count) {
+
+		return;
+	}
+
+	if (pattern == l ->pattern && opaque == l ->opaque && (pattern == LED_PATTERN_NONE || led_patterns[pattern].repeat)) {
+
+		return;
+	}
+
+	l ->pattern = pattern;
+	l ->opaque = opaque;
+	l ->position = 0;
+	l ->pins = 0;
+
+	if (pattern != LED_PATTERN_NONE) {
+
+		l ->due = now;
+		ledLayerStep(l);
+	}
+
+	(void)MessageCancelAll(&led.task, LED_TIMELINE_STEP);
+	ledTimelineUpdate(now);
+}
@@ -0,0 +1,59 @@
+#ifndef LED_TIMELINE_H
+#define LED_TIMELINE_H
+
+#include <csrtypes.h>
+
+#include "spp_dev_b_leds.h"
+
+/**************************************
+
+  compiled led/buzzer player with independent layers, replaces the entry by entry ledsPlay() of
+  the ledparse output.
+
+  tools/led_compile.py turns spp_dev_b_leds.led into led_patterns.c. each pattern becomes a list of
+  steps, a step is the pios written at one instant with their absolute levels and the time until
+  the next step. zero time entries are merged into the step they are played with, those at the end
+  of a pattern become its tail, written together with the next step. the tool checks the compiled
+  patterns give the same pio waveform as the entries before it writes them.
+
+  every layer plays one pattern on its own levels. after each step the layers are composited into
+  the pios: the top layer lighting any of the led pios owns all of them, an opaque layer owns them
+  in its dark steps too and hides the layers under it. the led_pins_mixed ones (the buzzer) are on
+  when any layer drives them. layers stepping at the same instant share one timer message, and
+  PioSet() is only called when a level really changes.
+
+  **************************************/
+
+#define LED_LAYERS				4			/** layer 0 is the top one, led_timeline.c initialises them all idle **/
+#define LED_PATTERN_NONE		0xFFFF		/** layer is idle **/
+
+typedef struct {
+
+	uint16	mask;			/** pios written **/
+	uint16	bits;			/** their levels **/
+	uint16	time;			/** ms until the next step **/
+
+} led_step_t;
+
+typedef struct {
+
+	const led_step_t*	steps;
+	uint16				count;
+	bool				repeat;		/** a one shot pattern leaves its layer idle when over **/
+	uint16				tail_mask;	/** zero time writes at the end of the pattern **/
+	uint16				tail_bits;
+
+} led_timeline_t;
+
+/** led_patterns.c, indexed by LedPattern_t **/
+extern const led_timeline_t led_patterns[];
+extern const uint16 led_patterns_count;
+extern const uint16 led_pins_used;
+extern const uint16 led_pins_mixed;
+
+/** play pattern on layer from its start, or LED_PATTERN_NONE to clear it. setting the repeating
+	pattern a layer already plays leaves it running, a one shot pattern is restarted. an opaque
+	layer owns the led while the pattern plays, a transparent one only while it lights it **/
+void ledTimelineSet(uint16 layer, uint16 pattern, bool opaque);
+
+#endif /** LED_TIMELINE_H **/
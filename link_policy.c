@@ -0,0 +1,129 @@
+#include <csrtypes.h>
+#include <connection.h>
+
+#include "link_policy.h"
+
+/** stage table, sniff intervals as the old keyboard table **/
+static const lp_power_table link_stages[LINK_POLICY_STAGES] = {
+
+	/* mode,    	min_interval, max_interval, attempt, timeout, duration */
+	{lp_active,		0,            0,			0,		 0,	      0},
+	{lp_sniff,		20,           52,			1,		 1,	      0},
+	{lp_sniff,		54,           162,			1,		 16,	  0},
+	{lp_sniff,		164,          402,			1,		 16,	  0},
+	{lp_sniff,		404,	      802,			1,		 16,	  0}
+};
+
+/** ms spent in a stage before the next one, the first is the configurable silence that ends the active
+	stage **/
+static const uint32 link_idle[LINK_POLICY_STAGES - 1] = {
+
+	0,				/** active_idle **/
+	1000,
+	30000,
+	600000
+};
+
+void linkPolicyStart(link_policy_t* l, uint32 now) {
+
+	uint16 i;
+
+	l ->stage = 0;
+	l ->stage_since = now;
+	l ->last_traffic = now;
+
+	l ->mode = lp_active;
+	l ->mode_since = now;
+	l ->wakeups = 0;
+
+	for (i = 0; i < LINK_POLICY_MODES; i++) {
+
+		l ->mode_time[i] = 0;
+	}
+}
+
+bool linkPolicyTraffic(link_policy_t* l, uint32 now) {
+
+	l ->last_traffic = now;
+
+	if (l ->stage == 0) {
+
+		return FALSE;
+	}
+
+	l ->stage = 0;
+	l ->wakeups++;
+
+	return TRUE;
+}
+
+uint32 linkPolicyStageIdle(const link_policy_t* l) {
+
+	if (l ->stage == LINK_POLICY_STAGES - 1) {
+
+		return 0;
+	}
+
+	return l ->stage == 0 ? l ->active_idle : link_idle[l ->stage];
+}
+
+bool linkPolicyIdle(link_policy_t* l, uint32 now, uint32* wait) {
+
+	/** the active stage counts from the last traffic, a sniff stage from when it was entered **/
+	uint32 elapsed = now - (l ->stage == 0 ? l ->last_traffic : l ->stage_since);
+	uint32 idle = linkPolicyStageIdle(l);
+
+	if (idle == 0) {
+
+		*wait = 0;
+		return FALSE;
+	}
+
+	if (elapsed < idle) {
+
+		/** traffic meanwhile, check again when the silence could be long enough **/
+		*wait = idle - elapsed;
+		return FALSE;
+	}
+
+	l ->stage++;
+	l ->stage_since = now;
+	*wait = linkPolicyStageIdle(l);
+
+	return TRUE;
+}
+
+const lp_power_table* linkPolicyEntry(const link_policy_t* l) {
+
+	return &link_stages[l ->stage];
+}
+
+void linkPolicyModeChange(link_policy_t* l, uint16 mode, uint32 now) {
+
+	if (l ->mode < LINK_POLICY_MODES) {
+
+		l ->mode_time[l ->mode] += now - l ->mode_since;
+	}
+
+	l ->mode = mode;
+	l ->mode_since = now;
+}
+
+uint32 linkPolicyModeTime(const link_policy_t* l, uint16 mode, uint32 now) {
+
+	uint32 t;
+
+	if (mode >= LINK_POLICY_MODES) {
+
+		return 0;
+	}
+
+	t = l ->mode_time[mode];
+
+	if (mode == l ->mode) {
+
+		t += now - l ->mode_since;
+	}
+
+	return t;
+}
@@ -0,0 +1,65 @@
+#ifndef LINK_POLICY_H
+#define LINK_POLICY_H
+
+#include <csrtypes.h>
+#include <connection.h>
+
+/**************************************
+
+  traffic driven link policy of the spp connection. the link is kept active while bytes flow in either
+  direction and steps down to deeper sniff stages after idle intervals, so a burst after a quiet
+  period wakes the link at once instead of waiting for a sniff anchor.
+
+  each stage is given to the connection library as a one-entry power table that holds until the next
+  stage is applied. traffic only records its time, no message per byte, the idle timer checks the
+  elapsed silence when it fires and re-arms itself for the remainder.
+
+  the mode the link is really in comes with CL_DM_MODE_CHANGE_EVENT, the time spent in each mode is
+  counted per connection.
+
+  **************************************/
+
+#define LINK_POLICY_STAGES			5
+#define LINK_POLICY_ACTIVE_IDLE		200		/** default ms of silence before the first sniff stage **/
+#define LINK_POLICY_MODES			3		/** lp_active, lp_sniff, lp_passive **/
+
+typedef struct {
+
+	/** configuration, AT+SNIFFIDLE **/
+	uint16	active_idle;
+
+	uint16	stage;				/** stage applied, 0 is active **/
+	uint32	stage_since;
+	uint32	last_traffic;
+
+	/** mode accounting **/
+	uint16	mode;				/** last reported lp_power_mode **/
+	uint32	mode_since;
+	uint32	mode_time[LINK_POLICY_MODES];	/** ms **/
+	uint16	wakeups;			/** times traffic forced the link out of sniff **/
+
+} link_policy_t;
+
+/** new connection, active stage, counters cleared **/
+void linkPolicyStart(link_policy_t* l, uint32 now);
+
+/** bytes moved at now, TRUE if the active stage has to be applied **/
+bool linkPolicyTraffic(link_policy_t* l, uint32 now);
+
+/** idle timer, TRUE if a deeper stage has to be applied. *wait is the ms until the next check, 0 when
+	the deepest stage is reached **/
+bool linkPolicyIdle(link_policy_t* l, uint32 now, uint32* wait);
+
+/** one-entry power table of the current stage **/
+const lp_power_table* linkPolicyEntry(const link_policy_t* l);
+
+/** ms the current stage lasts without traffic, 0 for the deepest stage **/
+uint32 linkPolicyStageIdle(const link_policy_t* l);
+
+/** CL_DM_MODE_CHANGE_EVENT **/
+void linkPolicyModeChange(link_policy_t* l, uint16 mode, uint32 now);
+
+/** ms spent in mode so far, the current one counted up to now **/
+uint32 linkPolicyModeTime(const link_policy_t* l, uint16 mode, uint32 now);
+
+#endif /** LINK_POLICY_H **/
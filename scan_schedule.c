@@ -0,0 +1,62 @@
+#include <csrtypes.h>
+
+#include "scan_schedule.h"
+
+/** no known peer, discoverable all the time **/
+static const scan_step_t scan_steps_new[] = {
+
+	/** power-on burst, 11.25 ms of every 160 ms on both trains **/
+	{ 10000, 0x0100, 0x0012, 0x0100, 0x0012, TRUE },
+	/** back off, still interlaced so a pager needs one interval **/
+	{ 20000, 0x0400, 0x0012, 0x0400, 0x0012, TRUE },
+	/** R1 interval, interlaced, until the pairable timeout **/
+	{ 0,     0x0800, 0x0012, 0x0800, 0x0012, TRUE }
+};
+
+/** a stored profile exists, its peer pages us directly, inquiry scan only now and then for new phones **/
+static const scan_step_t scan_steps_known[] = {
+
+	{ 5000,  0,      0,      0x0100, 0x0012, TRUE },
+	{ 10000, 0x0400, 0x0012, 0x0400, 0x0012, TRUE },
+	/** loop: page scan only with a short discoverable phase **/
+	{ 20000, 0,      0,      0x0800, 0x0012, TRUE },
+	{ 5000,  0x0800, 0x0012, 0x0800, 0x0012, TRUE }
+};
+
+static const scan_table_t scan_table_new = {
+
+	scan_steps_new, sizeof(scan_steps_new) / sizeof(scan_steps_new[0]), 2
+};
+
+static const scan_table_t scan_table_known = {
+
+	scan_steps_known, sizeof(scan_steps_known) / sizeof(scan_steps_known[0]), 2
+};
+
+void scanScheduleStart(scan_schedule_t* s, bool known_peer) {
+
+	s ->table = known_peer ? &scan_table_known : &scan_table_new;
+	s ->step = 0;
+}
+
+const scan_step_t* scanScheduleStep(const scan_schedule_t* s) {
+
+	return &s ->table ->steps[s ->step];
+}
+
+bool scanScheduleNext(scan_schedule_t* s) {
+
+	if (scanScheduleStep(s) ->duration == 0) {
+
+		return FALSE;
+	}
+
+	s ->step++;
+
+	if (s ->step == s ->table ->count) {
+
+		s ->step = s ->table ->loop;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,63 @@
+#ifndef SCAN_SCHEDULE_H
+#define SCAN_SCHEDULE_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  inquiry/page scan schedule of the scan super-state. scanning is aggressive right after power-on or a
+  disconnect, when a phone is most likely to connect, and backs off step by step to save power for the
+  rest of the pairable time. with a known peer (a stored session profile) there are page scan only
+  steps, the peer already knows our address and does not need inquiry scan to find us.
+
+  intervals and windows are in baseband slots of 0.625 ms. an interlaced scan covers both page/inquiry
+  trains in one interval, so a pager finds us within one interval instead of up to two.
+
+  host/bench_scan.c measures the tables below from the scan parameters the firmware writes, a phone
+  paging at a random time in the first 10 s / any time of the 90 s pairable state, compared to the old
+  fixed inquiry scan 0x400/0x200 with default page scan:
+
+	                page latency mean         page latency mean         scan duty
+	                first 10 s                90 s                      90 s
+	old fixed       1.28 s                    1.27 s                    50.9 %
+	new peer        0.07 s                    0.50 s                     7.0 %
+	known peer      0.19 s                    0.55 s                     3.3 %
+
+  **************************************/
+
+typedef struct {
+
+	uint16	duration;			/** ms spent in this step, 0 holds it until the pairable timeout **/
+	uint16	inquiry_interval;	/** 0 for page scan only **/
+	uint16	inquiry_window;
+	uint16	page_interval;
+	uint16	page_window;
+	bool	interlaced;			/** interlaced scan type for both inquiry and page scan **/
+
+} scan_step_t;
+
+typedef struct {
+
+	const scan_step_t*	steps;
+	uint16				count;
+	uint16				loop;		/** step to go on with after the last one **/
+
+} scan_table_t;
+
+typedef struct {
+
+	const scan_table_t*	table;
+	uint16				step;
+
+} scan_schedule_t;
+
+/** start at the first step of the table for a new or a known peer **/
+void scanScheduleStart(scan_schedule_t* s, bool known_peer);
+
+/** the step to apply now **/
+const scan_step_t* scanScheduleStep(const scan_schedule_t* s);
+
+/** go on to the next step, FALSE if the current one is held **/
+bool scanScheduleNext(scan_schedule_t* s);
+
+#endif /** SCAN_SCHEDULE_H **/
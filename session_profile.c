@@ -0,0 +1,111 @@
+#include <csrtypes.h>
+#include <bdaddr.h>
+#include <ps.h>
+
+#include "session_profile.h"
+
+typedef struct {
+
+	bdaddr			addr;
+	struct connect	config;
+
+} profile_record_t;
+
+#define PROFILE_RECORD_WORDS	(sizeof(profile_record_t))
+
+/** slot holding addr, PROFILE_SLOTS if none, the first empty slot is returned in empty **/
+static uint16 profileFind(const bdaddr* addr, profile_record_t* record, uint16* empty) {
+
+	uint16 slot;
+
+	*empty = PROFILE_SLOTS;
+
+	for (slot = 0; slot < PROFILE_SLOTS; slot++) {
+
+		if (PsRetrieve(PROFILE_PS_KEY + slot, record, PROFILE_RECORD_WORDS) != PROFILE_RECORD_WORDS) {
+
+			if (*empty == PROFILE_SLOTS) {
+
+				*empty = slot;
+			}
+		}
+		else if (BdaddrIsSame(&record ->addr, addr)) {
+
+			return slot;
+		}
+	}
+
+	return PROFILE_SLOTS;
+}
+
+bool profileLoad(const bdaddr* addr, struct connect* config) {
+
+	profile_record_t record;
+	uint16 empty;
+
+	if (profileFind(addr, &record, &empty) == PROFILE_SLOTS) {
+
+		return FALSE;
+	}
+
+	*config = record.config;
+
+	return TRUE;
+}
+
+bool profileAny(void) {
+
+	profile_record_t record;
+	uint16 slot;
+
+	for (slot = 0; slot < PROFILE_SLOTS; slot++) {
+
+		if (PsRetrieve(PROFILE_PS_KEY + slot, &record, PROFILE_RECORD_WORDS) == PROFILE_RECORD_WORDS) {
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+void profileSave(const bdaddr* addr, const struct connect* config) {
+
+	profile_record_t record;
+	uint16 empty;
+	uint16 slot = profileFind(addr, &record, &empty);
+
+	if (slot != PROFILE_SLOTS) {
+
+		/** same peer, same settings, spare the flash **/
+		if (record.config.baudrate == config ->baudrate && record.config.keeptime == config ->keeptime &&
+			record.config.parity == config ->parity && record.config.polarity == config ->polarity &&
+			record.config.stop == config ->stop) {
+
+			return;
+		}
+	}
+	else if (empty != PROFILE_SLOTS) {
+
+		slot = empty;
+	}
+	else {
+
+		/** all slots taken, replace round robin **/
+		uint16 next = 0;
+
+		if (PsRetrieve(PROFILE_PS_KEY_NEXT, &next, 1) != 1 || next >= PROFILE_SLOTS) {
+
+			next = 0;
+		}
+
+		slot = next;
+		next = (next + 1) % PROFILE_SLOTS;
+		(void)PsStore(PROFILE_PS_KEY_NEXT, &next, 1);
+	}
+
+	record.addr = *addr;
+	record.config = *config;
+
+	(void)PsStore(PROFILE_PS_KEY + slot, &record, PROFILE_RECORD_WORDS);
+}
@@ -0,0 +1,33 @@
+#ifndef SESSION_PROFILE_H
+#define SESSION_PROFILE_H
+
+#include <csrtypes.h>
+#include <bdaddr.h>
+
+#include "at_command.h"
+
+/**************************************
+
+  per-peer session profile. the last AT+CONNECT that took a peer to the pipe is kept in persistent
+  store under its bluetooth address, so the next connection from the same peer is configured from it
+  and goes straight to the pipe without the echo/AT handshake. the +++ escape still reaches the echo
+  state, a new AT+CONNECT from there replaces the stored profile.
+
+  PROFILE_SLOTS peers are remembered, a new peer takes a free slot or else the oldest written one.
+
+  **************************************/
+
+#define PROFILE_PS_KEY			10		/** first user ps key, slots are PROFILE_PS_KEY + n **/
+#define PROFILE_SLOTS			4
+#define PROFILE_PS_KEY_NEXT		(PROFILE_PS_KEY + PROFILE_SLOTS)	/** slot the next new peer replaces **/
+
+/** TRUE and the stored settings in config if addr has a profile **/
+bool profileLoad(const bdaddr* addr, struct connect* config);
+
+/** TRUE if any peer has a profile **/
+bool profileAny(void);
+
+/** store config for addr, persistent store is only written if it changed **/
+void profileSave(const bdaddr* addr, const struct connect* config);
+
+#endif /** SESSION_PROFILE_H **/
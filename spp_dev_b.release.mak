@@ -26,42 +26,67 @@ LIBRARY_VERSION=
 
 LIBS=-lconnection -lspp -lregion -lservice -lbdaddr -lsdp_parse -lbattery 
 INPUTS=\
-      spp_dev_b_leds.led\
       spp_dev_b_buttons.button\
       README.html\
       spp_dev_b.psr\
       led_timing.def\
-      at_command.parse\
       sppb.h\
       app_state.h\
       at_command.h\
+      autobaud.h\
       battery_probe.h\
       battery_probe_private.h\
       bitmacro.h\
       command_return_code.h\
       debug.h\
+      deadline.h\
+      echo_text.h\
+      escape_detect.h\
       errman.h\
+      frame_queue.h\
       hal.h\
       hal_config.h\
       hal_private.h\
       indication.h\
+      latency_hist.h\
+      led_timeline.h\
+      link_policy.h\
       messagebase.h\
+      scan_schedule.h\
+      session_profile.h\
       spp_dev_auth.h\
       spp_dev_b_buttons.h\
       spp_dev_b_leds.h\
+      stats.h\
+      trace.h\
+      trace_events.h\
+      uart_timing.h\
       spp_dev_private.h\
       sppb.c\
       at_command.c\
       at_command_parse.c\
+      autobaud.c\
       battery_probe.c\
       debug.c\
+      deadline.c\
+      echo_text.c\
+      escape_detect.c\
       errman.c\
+      frame_queue.c\
       hal.c\
       indication.c\
+      latency_hist.c\
+      led_patterns.c\
+      led_timeline.c\
+      link_policy.c\
       main.c\
+      scan_schedule.c\
+      session_profile.c\
       spp_dev_auth.c\
       spp_dev_b_buttons.c\
-      spp_dev_b_leds.c
+      stats.c\
+      trace.c\
+      uart_timing.c
 # Project-specific options
 characters=1
 faultalerts=0
@@ -16,22 +16,14 @@ Copyright (C) Cambridge Silicon Radio Ltd. 2006-2009
 
 typedef enum LedPatternTag
 {
-    ALL_LEDS_OFF ,
-    WHITE_ON ,
-    RED_ON ,
-    RED_GREEN_ON ,
-    GREEN_ON ,
-    BLUE_FAST_FLASH ,
-    BLUE_THRICE_FAST_ONICE_SLOW_FLASH ,
-    GREEN_FAST_FLASH ,
-    WHITE_FAST_FLASH ,
-    BLUE_SLOW_FLASH ,
-    RED_SLOW_FLASH ,
-    RED_ON_BLUE_SLOW_FLASH ,
-    RED_GREEN_ON_BLUE_SLOW_FLASH ,
-    GREEN_ON_BLUE_SLOW_FLASH ,
-    RED_GREEN_BLUE_ALT ,
-    RAINBOW ,
+    BATT_UNKNOWN ,
+    BATT_LOW ,
+    BATT_MODEST ,
+    BATT_FINE ,
+    BATT_LOW_FLASH ,
+    LINK_SCAN ,
+    LINK_ECHO ,
+    LINK_PIPE ,
     BEEP_ONCE ,
     BEEP_TWICE ,
     BEEP_THREE_TIMES
@@ -35,8 +35,16 @@ enum {
 /*    SPP_ECHO_PIORESETLOW_TIMEOUT,*/
     
 	SPPB_PIPE_SPP_SINK_READY,					/** spp sink is ready to send, schedule this message when MESSAGE_MORE_DATA **/
-	SPPB_PIPE_COUNT_DOWN,						/** instead of message time-out, we use count down scheme to do timeout **/
-    SPP_PIPE_PACK_FINISH                       /*pack finish*/
+	SPPB_PIPE_IDLE_TIMEOUT_IND,					/** deadline, no pipe traffic for SPPB_PIPE_IDLE_TIMEOUT **/
+    SPP_PIPE_PACK_FINISH,                      /*pack finish*/
+	SPPB_PIPE_COALESCE_TIMEOUT,					/** uart bytes held long enough, send them to spp even if the frame is not full **/
+	SPPB_PIPE_DRIVER_RELEASE,					/** last byte moved to the uart is out on the wire, stop driving PIO3 **/
+	SPPB_PIPE_ESCAPE_GUARD,						/** silence after a possible escape sequence **/
+	SPPB_ECHO_AUTOBAUD_NEXT,					/** done listening to an auto-baud candidate **/
+	SPPB_SCAN_SCHEDULE_NEXT,					/** time for the next step of the scan schedule **/
+	SPPB_LINK_POLICY_IDLE,						/** pipe quiet long enough for the next link policy stage? **/
+	SPPB_DEADLINE_TICK,							/** vm timer of the deadline service **/
+	SPPB_PIPE_STATS_READY						/** in-band AT+STATS query is next in the spp source and the spp sink has room **/
     
 
 };
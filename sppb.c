@@ -15,6 +15,7 @@
 #include <pio.h>
 #include <sink.h>
 #include <source.h>
+#include <vm.h>
 
 #include <string.h>
 
@@ -22,23 +23,14 @@
 #include "sppb.h"
 #include "command_return_code.h"
 #include "indication.h"
-/*
-#define USE_SYSTEM_STREAM_CONNECT
-*/
+#include "uart_timing.h"
+#include "echo_text.h"
+#include "stats.h"
+#include "trace.h"
+
 /** task data **/
 static sppb_task_t sppb;
 
-/* Application power table  */
-#define APP_POWER_TABLE_ENTRIES (sizeof(app_keyboard_power_table) / sizeof(lp_power_table))
-static const lp_power_table app_keyboard_power_table[]=
-{
-	/* mode,    	min_interval, max_interval, attempt, timeout, duration */
-	{lp_sniff,		20,           52,			1,		 1,	      1},
-	{lp_sniff,		54,           162,			1,		 16,	  30},
-	{lp_sniff,		164,          402,			1,		 16,	  600},
-	{lp_sniff,		404,	      802,			1,		 16,	  0}
-};
-
 /* Sniff Subrating parameters used if remote device supports Sniff Subrating */
 /* These values are for testing only. Real applications should consider other values. */
 #define APP_SSR_MAX_REMOTE_LATENCY      512     /* The maximum time the remote device need not be present when subrating (in 0.625ms units). Must be at least 2 times sniff interval. */
@@ -127,20 +119,38 @@ static void connecting_state_enter(void);
 static void connecting_state_exit(void);
 static void connected_state_enter(void);
 static void connected_state_exit(void);
+static void connected_profile_resume(void);
 static void disconnecting_state_enter(void);
 static void disconnecting_state_exit(void);
 
 /** scan is the super-state of pairable & connecting **/
 static void scan_state_enter(void);		
 static void scan_state_exit(void);
+static void scan_step_apply(void);
 
 /** sub state handlers **/
 static void echo_state_handler(Task task, MessageId id, Message message);
 static void pipe_state_handler(Task task, MessageId id, Message message);
 static void echo_state_enter(void);
 static void echo_state_exit(void);
+static void echo_autobaud_start(void);
+static void echo_command_scan(void);
+static bool echo_run_batch(void);
+static void echo_autobaud_stop(void);
 static void pipe_state_enter(void);
 static void pipe_state_exit(void);
+static void pipe_uart_tx_start(Task task);
+static void pipe_driver_hold(Task task);
+static void pipe_driver_release(void);
+static void pipe_escape_drained(void);
+static void link_stage_apply(void);
+static void link_activity(void);
+static void pipe_activity(void);
+static uint16 pipe_pack_window(void);
+static uint16 pipe_coalesce_threshold(void);
+static void pipe_stats_report(void);
+static void pipe_stats_drained(void);
+static void pipe_uart_send_decided(void);
 
 
 void process_spp_more_data(void);
@@ -150,13 +160,14 @@ void process_uart_more_space(void);
 
 void source_push(Source source, Sink sink);
 
-static void buffer1_to_sink(Sink sink, uint8* buffer, uint16 num);
 /** static void sink_pull(Sink sink, Source source); **/
 
 
 /*static  void buffer_to_sink(Sink sink, buffered_bytes_t* buffer);*/ 
 
 static void send_echo_message(Sink sink, at_command_return_code_t ret_code);
+static uint16 echo_reply(Sink sink, at_command_return_code_t ret_code);
+static uint16 echo_claim(Sink sink, const char* p);
 
 
 Task getSppbTask(void)
@@ -173,6 +184,7 @@ static void unhandledSppState(sppb_state_t state, MessageId id)
 void setSppState(const sppb_state_t state)
 {
     DEBUG(("SPP State - C=%d N=%d\n",sppb.state, state));
+    statInc(STAT_STATE_CHANGES);
     sppb.state = state;
 }
 
@@ -189,7 +201,7 @@ static void initialising_state_enter(void) {
 
 	aSource = StreamUartSource();
 
-	update_indication();
+	indicationLink();
 	
 	if( aSource )
 	{
@@ -226,7 +238,7 @@ static void initialising_state_handler(Task task, MessageId id, Message message)
 				sppb.spp_initialised = TRUE;
 				
 				initialising_state_exit();
-				sppb.state = SPPB_READY;
+				setSppState(SPPB_READY);
 				ready_state_enter();
             }
 			else {
@@ -253,25 +265,18 @@ static void initialising_state_handler(Task task, MessageId id, Message message)
   */
 static void ready_state_enter() {
 	
-	app_ext_state_change_message_t* message;
-	
-	update_indication();
-	
-	message = (app_ext_state_change_message_t*)malloc(sizeof(app_ext_state_change_message_t));
+	indicationLink();
 	
 	DEBUG(("spp ready state enter...\n"));
 	
-	message ->state = APP_EXT_STATE_IDLE;
-	MessageSend(sppb.hal_task, APP_EXT_STATE_CHANGE_MESSAGE, message);
+	MessageSend(sppb.hal_task, APP_EXT_STATE_IDLE_MESSAGE, 0);
 }
 
 static void ready_state_exit() {
-	app_ext_state_change_message_t* message =  (app_ext_state_change_message_t*)malloc(sizeof(app_ext_state_change_message_t));
 	
 	DEBUG(("spp ready state exit...\n"));
 	
-	message ->state = APP_EXT_STATE_WORKING;
-	MessageSend(sppb.hal_task, APP_EXT_STATE_CHANGE_MESSAGE, message);	
+	MessageSend(sppb.hal_task, APP_EXT_STATE_WORKING_MESSAGE, 0);	
 }
 
 void ready_state_handler(Task task, MessageId id, Message message) {
@@ -315,17 +320,48 @@ static void scan_state_enter() {
     ConnectionWriteClassOfDevice(CLASS_OF_DEVICE);
     /* Start Inquiry mode */
     /** setSppState(SPPB_PAIRABLE); **/
-    /* Set devB device to inquiry scan mode, waiting for discovery */
-    ConnectionWriteInquiryscanActivity(0x400, 0x200);
     ConnectionSmSetSdpSecurityIn(TRUE);
-    /* Make this device discoverable (inquiry scan), and connectable (page scan) */
-    ConnectionWriteScanEnable(hci_scan_enable_inq_and_page);
+    /* Make this device discoverable (inquiry scan), and connectable (page scan), backing off by the schedule */
+    scanScheduleStart(&sppb.scan, profileAny());
+    scan_step_apply();
+}
+
+/** write the scan parameters of the current schedule step and time the next one **/
+static void scan_step_apply(void) {
+	
+	const scan_step_t* step = scanScheduleStep(&sppb.scan);
+	hci_scan_type type = step ->interlaced ? hci_scan_type_interlaced : hci_scan_type_standard;
+	
+	DEBUG(("spp scan state, step %d, page %d/%d, inquiry %d/%d...\n", sppb.scan.step, 
+		step ->page_window, step ->page_interval, step ->inquiry_window, step ->inquiry_interval));
+	
+	ConnectionWritePagescanActivity(step ->page_interval, step ->page_window);
+	ConnectionWritePageScanType(type);
+	
+	if (step ->inquiry_interval) {
+		
+		ConnectionWriteInquiryscanActivity(step ->inquiry_interval, step ->inquiry_window);
+		ConnectionWriteInquiryScanType(type);
+		ConnectionWriteScanEnable(hci_scan_enable_inq_and_page);
+	}
+	else {
+		
+		/** page scan only, a known peer knows where to find us **/
+		ConnectionWriteScanEnable(hci_scan_enable_page);
+	}
+	
+	if (step ->duration) {
+		
+		MessageSendLater(getSppbTask(), SPPB_SCAN_SCHEDULE_NEXT, 0, step ->duration);
+	}
 }
 
 static void scan_state_exit() {
 
 	DEBUG(("spp scan state exit...\n"));
 
+	(void)MessageCancelAll(getSppbTask(), SPPB_SCAN_SCHEDULE_NEXT);
+	
 	/* turn off scan **/
 	ConnectionWriteScanEnable(hci_scan_enable_off);
 }
@@ -339,7 +375,7 @@ static void pairable_state_enter() {
 
 	DEBUG(("spp pairable state enter...\n"));
 	
-	update_indication();
+	indicationLink();
 		
 	/** start timer **/
     MessageCancelAll(getSppbTask(), SPPB_PAIRABLE_TIMEOUT_IND);
@@ -361,12 +397,14 @@ static void pairable_state_handler(Task task, MessageId id, Message message) {
 		case SPP_CONNECT_IND:
 
 			DEBUG(("spp pairable state, SPP_CONNECT_IND message arrived...\n"));
+			
+			sppb.peer_addr = ((SPP_CONNECT_IND_T*)message) ->addr;
 		
 		    /* Received command that a device is trying to connect. Send response. */
             sppDevAuthoriseConnectInd(&sppb,(SPP_CONNECT_IND_T*)message);
 			
 			pairable_state_exit();
-            sppb.state = SPPB_CONNECTING;
+            setSppState(SPPB_CONNECTING);
 			connecting_state_enter();
 			break;
 			
@@ -395,10 +433,20 @@ static void pairable_state_handler(Task task, MessageId id, Message message) {
 			}
 			break;
 
+		case SPPB_SCAN_SCHEDULE_NEXT:
+			
+			if (scanScheduleNext(&sppb.scan)) {
+				
+				scan_step_apply();
+			}
+			break;
+			
 		case SPPB_PAIRABLE_TIMEOUT_IND:
 			{
 				DEBUG(("spp pairable state, SPPB_PAIRABLE_TIMEOUT_IND message arrived...\n"));
 				
+				/** scan is left as it is, only the schedule stops at its current step **/
+				(void)MessageCancelAll(getSppbTask(), SPPB_SCAN_SCHEDULE_NEXT);
 				pairable_state_exit();
 				setSppState(SPPB_READY);
 				ready_state_enter();				
@@ -420,7 +468,7 @@ static void connecting_state_enter() {
 	
 	DEBUG(("spp connecting state enter...\n"));
 	
-	update_indication();
+	indicationLink();
 
 }
 
@@ -449,21 +497,34 @@ static void connecting_state_handler(Task task, MessageId id, Message message) {
 					
                 	sppb.spp = cfm->spp;
 					sppb.spp_sink = cfm ->sink;
+					sppb.spp_frame_size = cfm ->payload_size;
                     
+                    linkPolicyStart(&sppb.link, VmGetClock());
                     ConnectionReadRemoteSuppFeatures(getSppbTask(), sppb.spp_sink); 
                 	setSppState(SPPB_CONNECTED);
+					sppb.spp_sink_busy = 0;
 					connected_state_enter();
+					connected_profile_resume();
 				}
 				else {
 					
 					/** go back **/
 					connecting_state_exit();
-					sppb.state = SPPB_PAIRABLE;
+					setSppState(SPPB_PAIRABLE);
 					pairable_state_enter();
 				}
 			}
 			break;	
 			
+		case SPPB_SCAN_SCHEDULE_NEXT:
+			
+			/** still scanning until the connection is up **/
+			if (scanScheduleNext(&sppb.scan)) {
+				
+				scan_step_apply();
+			}
+			break;
+			
 		default:
 			unhandledSppState(sppb.state, id);
 			break;		
@@ -485,7 +546,7 @@ void connected_state_enter() {
 	sink = sppb.spp_sink;
 	source = StreamSourceFromSink(sink);
 	
-	sppb.spp_sink_busy = 0;
+	/** spp_sink_busy is left alone, coming back from pipe the sink may still be full **/
 	SourceDrop( source , SourceSize( source ));
 	
 	SourceConfigure( source, VM_SOURCE_MESSAGES, VM_MESSAGES_SOME );
@@ -496,6 +557,34 @@ void connected_state_enter() {
 	echo_state_enter();
 }
 
+/** a peer with a stored session profile skips the AT handshake, +++ still escapes to echo **/
+static void connected_profile_resume(void) {
+	
+	struct connect config;
+	
+	if (!profileLoad(&sppb.peer_addr, &config)) {
+		
+		return;
+	}
+	
+	DEBUG(("spp connected state, session profile found, baudrate %d...\n", config.baudrate));
+	
+	/** same checks and uart setup as AT+CONNECT, a stale profile leaves us in echo **/
+	connect(getSppbTask(), &config);
+	
+	if (CMD_RET_IS_OK(sppb.command_result) && sppb.command_connect) {
+		
+		echo_state_exit();
+		sppb.conn_state = CONN_PIPE;
+		pipe_state_enter();
+	}
+	else {
+		
+		sppb.command_result = 0xFFFF;
+		sppb.command_connect = FALSE;
+	}
+}
+
 
 void connected_state_exit() {
 
@@ -518,6 +607,12 @@ void connected_state_exit() {
 			break;
 	}
 	
+	deadlineCancel(&sppb.deadlines, SPPB_LINK_POLICY_IDLE);
+	DEBUG(("spp link policy, active %ld ms, sniff %ld ms, wakeups %d...\n",
+		linkPolicyModeTime(&sppb.link, lp_active, VmGetClock()),
+		linkPolicyModeTime(&sppb.link, lp_sniff, VmGetClock()), sppb.link.wakeups));
+	traceDumpDebug();
+	
 	/** clear spp related message **/
 	(void)MessageCancelAll(getSppbTask(), SPP_MESSAGE_MORE_DATA); /** here we do it anyway **/
 	if (sppb.spp_sink) {
@@ -529,6 +624,7 @@ void connected_state_exit() {
 	(void)MessageCancelAll(getSppbTask(), SPP_MESSAGE_MORE_SPACE);
 	sppb.spp_sink = 0;
 	sppb.spp_sink_busy = 0;
+	sppb.spp_frame_size = 0;
 	
 	/** dont clear sppb.spp, the next state need it, it covers both connected state AND disconnecting state **/
 }
@@ -536,22 +632,26 @@ void connected_state_exit() {
 static void echo_state_enter(void) {
 
 	DEBUG(("spp connected state echo subState enter...\n"));
+	statInc(STAT_SUBSTATE_CHANGES);
 
-	update_indication();
+	indicationLink();
 
 	sppb.command_started = FALSE;
 	sppb.command_result = 0xFFFF;
+	sppb.command_scanned = 0;
+	sppb.command_pending = FALSE;
+	sppb.command_end = 0;
 
 	/** start timer **/
-	MessageSendLater(getSppbTask(), SPPB_ECHO_TIMEOUT_IND, 0, SPPB_ECHO_DURATION);
+	deadlineSet(&sppb.deadlines, SPPB_ECHO_TIMEOUT_IND, SPPB_ECHO_DURATION);
 }
 
 static void echo_state_exit(void) {
 
 	DEBUG(("spp connected state echo subState exit...\n"));
 	
-	/** stop timer, MessageCancelFirst() may also work **/
-	(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_TIMEOUT_IND);
+	/** stop timer **/
+	deadlineCancel(&sppb.deadlines, SPPB_ECHO_TIMEOUT_IND);
 	
 	/** clear echo command timer **/
 	(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_COMMAND_TIMEOUT);
@@ -559,75 +659,199 @@ static void echo_state_exit(void) {
 	/** cancel waiting job message, not used now but may add this feature in future **/
 	(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_SINK_READY);
 	
+	echo_autobaud_stop();
+	
 	sppb.command_started = FALSE;
 	sppb.command_result = 0xFFFF;
+	sppb.command_scanned = 0;
+	sppb.command_pending = FALSE;
+	sppb.command_end = 0;
+}
+
+/** AT+CONNECT with baudrate 0, listen to the uart with one candidate setting after the other **/
+static void echo_autobaud_start(void) {
+	
+	Source source = StreamUartSource();
+	
+	DEBUG(("spp connected state echo subState, auto-baud started...\n"));
+	
+	sppb.autobauding = TRUE;
+	autobaudStart(&sppb.autobaud, sppb.uart_config.parity);
+	autobaudConfigure(&sppb.autobaud, sppb.uart_stop == 2 ? VM_UART_STOP_TWO : VM_UART_STOP_ONE);
+	
+	/** take the uart source back from the disposer **/
+	StreamDisconnect(source, 0);
+	SourceDrop(source, SourceSize(source));
+	SourceConfigure(source, VM_SOURCE_MESSAGES, VM_MESSAGES_SOME);
+	MessageSinkTask(StreamUartSink(), getSppbTask());
+	
+	MessageSendLater(getSppbTask(), SPPB_ECHO_AUTOBAUD_NEXT, 0, AUTOBAUD_DWELL);
+}
+
+static void echo_autobaud_stop(void) {
+	
+	if (sppb.autobauding) {
+		
+		(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_AUTOBAUD_NEXT);
+		(void)MessageCancelAll(getSppbTask(), MESSAGE_MORE_DATA);
+		StreamConnectDispose(StreamUartSource());
+		sppb.autobauding = FALSE;
+	}
 }
 
-static void echo_source(Source source) {
+/** parse one command line, FALSE if it held nothing but line ends **/
+static bool echo_source(const uint8* s, uint16 length) {
 	
 	/** init command result as invalid value **/
 	sppb.command_result = 0xFFFF;
+	sppb.command_connect = FALSE;
 			
 	/** parse **/
-	parseSource(source, getSppbTask());
-			
-	if (SourceSize(source) > 0) {	/** multiple command in once is not allowed **/
+	if (parseData(s, s + length, getSppbTask()) != s + length) {	/** unterminated garbage **/
 				
-		SourceDrop(source, SourceSize(source));
 		sppb.command_result = CMD_RET_UNRECOGNIZED;
 	}
 	else if (sppb.command_result == 0xFFFF) {
 				
-		/** unknown reason but we make sure **/
-		sppb.command_result = CMD_RET_UNRECOGNIZED;
+		return FALSE;
+	}
+	
+	return TRUE;
+}
+
+/** length of the first command in s, up to and including its terminating \r\n, size if there is none **/
+static uint16 echo_command_length(const uint8* s, uint16 size) {
+	
+	uint16 i;
+	
+	/** from byte 2 on, so the leading \r\n is not taken for the end **/
+	for (i = 2; i < size; i++) {
+		
+		if (s[i] == 0x0a && s[i-1] == 0x0d) {
+			
+			return i + 1;
+		}
 	}
+	
+	return size;
+}
+
+/** the first length bytes of the source are run as one batch when the spp sink is ready **/
+static void echo_batch(uint16 length) {
+	
+	sppb.command_end = length;
+	sppb.command_pending = TRUE;
 			
 	/** start echo job **/
-	/**MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);**/     /**DT??**/
+	statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+	MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);
 }
 
-static void echo_state_handler(Task task, MessageId id, Message message) {
+/** run the pending batch in order and reply to all of it with one flush, TRUE if an AT+CONNECT in it
+	switches to pipe. AT+CONNECT=0 stops the batch for the auto-baud search, the commands behind it
+	stay in the batch and run once the search is replied **/
+static bool echo_run_batch(void) {
 	
-	switch (id) {
+	Source source = StreamSourceFromSink(sppb.spp_sink);
+	const uint8* s = SourceMap(source);
+	uint16 done = 0;
+	uint16 claimed = 0;
+	bool to_pipe = FALSE;
+	bool autobaud = FALSE;
+	
+	while (done < sppb.command_end) {
 		
-		case SPP_MESSAGE_MORE_DATA:
-		{
-			Source source;
-			uint16 size;
-			const uint8* buf;
-						
-			DEBUG(("spp connected state echo subState, SPP_MESSAGE_MORE_DATA message arrived...\n"));
+		uint16 length = echo_command_length(s + done, sppb.command_end - done);
+		
+		if (echo_source(s + done, length)) {
 			
-			if (sppb.command_started == FALSE) {
+			if (sppb.command_result == CMD_RET_AUTOBAUD) {
 				
-				MessageSendLater(getSppbTask(), SPPB_ECHO_COMMAND_TIMEOUT, 0, 100);
-				sppb.command_started = TRUE;
+				autobaud = TRUE;
+				done += length;
+				break;
 			}
 			
-			source = StreamSourceFromSink(sppb.spp_sink);
-			size = SourceSize(source);	/** size won't be zero **/
-			buf = SourceMap(source);
+			claimed += echo_reply(sppb.spp_sink, sppb.command_result);
 			
-
-			if (size > 2 && buf[size-2] == 0x0d && buf[size-1] == 0x0a) {	/** trailing 0x0d0a, command finished **/
-				
-				MessageCancelAll(getSppbTask(), SPPB_ECHO_COMMAND_TIMEOUT);
-				sppb.command_started = FALSE;
+			if (CMD_RET_IS_OK(sppb.command_result) && sppb.command_connect) {
 				
-				echo_source(source);
-                MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);     /**fan**/
-			}
-			else 
-            {
-               
-                SourceDrop(source, size);
-				
-				/** do nothing, waiting for more bytes or timeout **/
+				to_pipe = TRUE;
 			}
+		}
+		
+		done += length;
+	}
+	
+	if (claimed) {
+		
+		(void)SinkFlush(sppb.spp_sink, claimed);
+	}
+	
+	SourceDrop(source, done);
+	sppb.command_scanned = sppb.command_scanned > done ? sppb.command_scanned - done : 0;
+	sppb.command_end -= done;
+	
+	if (autobaud) {
+		
+		/** still pending, the search replies **/
+		echo_autobaud_start();
+		return FALSE;
+	}
+	
+	sppb.command_pending = FALSE;
+	
+	return to_pipe;
+}
+
+/** search only the bytes that arrived since the last call for the terminating \r\n, a partial command
+	stays in the source until it completes or SPPB_ECHO_COMMAND_TIMEOUT **/
+static void echo_command_scan(void) {
+	
+	Source source = StreamSourceFromSink(sppb.spp_sink);
+	uint16 size = SourceSize(source);
+	uint16 end;
+	
+	/** one batch at a time, what arrives meanwhile is looked at when it is replied **/
+	if (sppb.command_pending || size == 0) {
+		
+		return;
+	}
+	
+	/** every complete command found joins the batch, a partial one behind them waits **/
+	end = parseLineEnd(SourceMap(source), sppb.command_scanned, size);
+	sppb.command_scanned = size;
+	
+	if (end) {
+		
+		MessageCancelAll(getSppbTask(), SPPB_ECHO_COMMAND_TIMEOUT);
+		sppb.command_started = FALSE;
+		
+		echo_batch(end);
+	}
+	else if (sppb.command_started == FALSE) {
+		
+		/** do nothing, waiting for more bytes or timeout **/
+		MessageSendLater(getSppbTask(), SPPB_ECHO_COMMAND_TIMEOUT, 0, 100);
+		sppb.command_started = TRUE;
+	}
+}
+
+static void echo_state_handler(Task task, MessageId id, Message message) {
+	
+	switch (id) {
+		
+		case SPP_MESSAGE_MORE_DATA:
+		{
+			DEBUG(("spp connected state echo subState, SPP_MESSAGE_MORE_DATA message arrived...\n"));
+			
+			echo_command_scan();
+			
+			/** AT commands are traffic too, the link leaves sniff to answer them **/
+			link_activity();
 
-			/* reschedule timeout message **/
-			(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_TIMEOUT_IND);
-			MessageSendLater(getSppbTask(), SPPB_ECHO_TIMEOUT_IND, 0, SPPB_ECHO_DURATION);
+			/* push the timeout back, no message queue work **/
+			deadlineSet(&sppb.deadlines, SPPB_ECHO_TIMEOUT_IND, SPPB_ECHO_DURATION);
 		}
 		break;
 		
@@ -637,8 +861,10 @@ static void echo_state_handler(Task task, MessageId id, Message message) {
 			sppb.command_started = FALSE;
 			
 			/** we know it's a garbage command, but we process it anyway **/
-			echo_source(source);
-            MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);     /**fan**/
+			if (!sppb.command_pending) {
+				
+				echo_batch(SourceSize(source));
+			}
 		}
 		break;
         
@@ -647,6 +873,7 @@ static void echo_state_handler(Task task, MessageId id, Message message) {
             PioSetDir(PIO3, 0);
 	      /*  PioSet(PIO3, 0);
             sppb.command_result = CMD_RET_OK;*/
+            statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
             MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);     /**fan**/
             
         }
@@ -656,13 +883,107 @@ static void echo_state_handler(Task task, MessageId id, Message message) {
 
 			DEBUG(("spp connected state echo subState, SPPB_ECHO_SINK_READY message arrived...\n"));
 			
-			/** now the sink is ready, send echo message **/
-			send_echo_message(sppb.spp_sink, sppb.command_result);
-			if (sppb.command_result == CMD_RET_OK) {
+			{
+				bool to_pipe;
+				
+				if (sppb.command_result == CMD_RET_AUTOBAUD_LOCKED || sppb.command_result == CMD_RET_AUTOBAUD_FAILED
+					|| (sppb.command_result == CMD_RET_OK && sppb.command_end == 0)) {
+					
+					/** a reply with no batch, the search of the last batch is over or pipe was escaped **/
+					send_echo_message(sppb.spp_sink, sppb.command_result);
+					to_pipe = CMD_RET_IS_OK(sppb.command_result) && sppb.command_connect;
+					sppb.command_result = 0xFFFF;
+					sppb.command_pending = FALSE;
+					
+					if (sppb.command_end) {
+						
+						/** the commands behind AT+CONNECT=0 in its batch **/
+						sppb.command_pending = TRUE;
+						to_pipe = echo_run_batch() || to_pipe;
+					}
+				}
+				else {
+					
+					/** now the sink is ready, run the batch and send its echo messages **/
+					to_pipe = echo_run_batch();
+				}
+				
+				if (sppb.command_pending) {
+					
+					/** auto-baud started **/
+					break;
+				}
+				
+				if (to_pipe) {
+					
+					profileSave(&sppb.peer_addr, &sppb.uart_config);
+					
+					echo_state_exit();
+					sppb.conn_state = CONN_PIPE;
+					pipe_state_enter();
+				}
+				else {
+					
+					/** commands that arrived while this batch was replied **/
+					echo_command_scan();
+				}
+			}
+			break;
+		
+		case MESSAGE_MORE_DATA:
+			{
+				Source source = StreamUartSource();
+				uint16 size = SourceSize(source);
+				
+				if (sppb.autobauding && size) {
+					
+					autobaudFeed(&sppb.autobaud, SourceMap(source), size);
+					
+					if (autobaudFull(&sppb.autobaud)) {
+						
+						/** scored enough, the rest of the dwell is not needed **/
+						(void)MessageCancelAll(getSppbTask(), SPPB_ECHO_AUTOBAUD_NEXT);
+						MessageSend(getSppbTask(), SPPB_ECHO_AUTOBAUD_NEXT, 0);
+					}
+				}
+				SourceDrop(source, size);
+			}
+			break;
+			
+		case SPPB_ECHO_AUTOBAUD_NEXT:
+			
+			if (autobaudNext(&sppb.autobaud)) {
+				
+				autobaudConfigure(&sppb.autobaud, sppb.uart_stop == 2 ? VM_UART_STOP_TWO : VM_UART_STOP_ONE);
+				
+				/** bytes from before the switch belong to the last candidate **/
+				SourceDrop(StreamUartSource(), SourceSize(StreamUartSource()));
+				MessageSendLater(getSppbTask(), SPPB_ECHO_AUTOBAUD_NEXT, 0, AUTOBAUD_DWELL);
+			}
+			else {
+				
+				echo_autobaud_stop();
 				
-				echo_state_exit();
-				sppb.conn_state = CONN_PIPE;
-				pipe_state_enter();
+				if (autobaudLocked(&sppb.autobaud)) {
+					
+					/** the best candidate is current, configure it for good **/
+					autobaudConfigure(&sppb.autobaud, sppb.uart_stop == 2 ? VM_UART_STOP_TWO : VM_UART_STOP_ONE);
+					
+					sppb.uart_baudrate = autobaudBaudrate(&sppb.autobaud);
+					sppb.uart_divisor = autobaudDivisor(&sppb.autobaud);
+					sppb.uart_bits = uartBitsPerChar(autobaudParity(&sppb.autobaud), sppb.uart_stop);
+					sppb.uart_config.baudrate = sppb.uart_baudrate;
+					sppb.uart_config.parity = autobaudParity(&sppb.autobaud);
+					sppb.command_result = CMD_RET_AUTOBAUD_LOCKED;
+				}
+				else {
+					
+					sppb.command_result = CMD_RET_AUTOBAUD_FAILED;
+					sppb.command_connect = FALSE;
+				}
+				
+				statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+				MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);
 			}
 			break;
 		
@@ -671,7 +992,7 @@ static void echo_state_handler(Task task, MessageId id, Message message) {
 			DEBUG(("spp connected state echo subState, SPPB_ECHO_TIMEOUT_IND message arrived...\n"));
 			
 			connected_state_exit();
-			sppb.state = SPPB_DISCONNECTING;
+			setSppState(SPPB_DISCONNECTING);
 			disconnecting_state_enter(); 	/* need discussing the design **/
 			break;
         case SPP_MESSAGE_MORE_SPACE:
@@ -695,9 +1016,10 @@ void pipe_state_enter(void) {
 	Source source;
 	
 	DEBUG(("spp connected state pipe subState enter...\n"));
+	statInc(STAT_SUBSTATE_CHANGES);
 	
     
-	update_indication();
+	indicationLink();
 	
 	sink = StreamUartSink();
 	source = StreamUartSource();
@@ -714,20 +1036,29 @@ void pipe_state_enter(void) {
 	
 		/** init locals **/
 	sppb.uart_sink_busy = FALSE;
-	sppb.count_down = SPPB_PIPE_IDLE_TIMEOUT;	
-	sppb.dirty = FALSE;
+	sppb.packing = FALSE;
+	sppb.spp_last_full = FALSE;
+	sppb.awaiting_reply = FALSE;
+	sppb.coalescing = FALSE;
+	sppb.frame_driver_wait = FALSE;
+	sppb.uart_held = FALSE;
+	sppb.uart_sending = FALSE;
+	sppb.fast_path = FALSE;
+	sppb.driver_on = FALSE;
+	sppb.uart_sink_size = SinkSlack(sink);
+	
+	/** the guard time before an escape counts from here **/
+	escapeDetectReset(&sppb.escape, VmGetClock());
+	escapeDetectReset(&sppb.stats_escape, VmGetClock());
+	sppb.escape_scanned = 0;
+	sppb.escape_draining = FALSE;
+	sppb.stats_pending = 0;
 
     sppb.buartseting = FALSE;
+    frameQueueReset(&sppb.spp_frames);
     MessageCancelAll(getSppbTask(), SPP_PIPE_PACK_FINISH);
 
 	
-#ifdef USE_SYSTEM_STREAM_CONNECT
-	
-	StreamConnect(StreamUartSource(), sppb.spp_sink);
-	StreamConnect(StreamSourceFromSink(sppb.spp_sink), StreamUartSink());
-	
-#else
-	
 	/** set uart as send more_data/more_space messages only once, see api reference **/
 	SourceConfigure( source, VM_SOURCE_MESSAGES, VM_MESSAGES_SOME);
 	SinkConfigure( sink, VM_SINK_MESSAGES, VM_MESSAGES_SOME);
@@ -735,10 +1066,21 @@ void pipe_state_enter(void) {
 	/** register myself as source/sink message receiver **/
 	MessageSinkTask(sink, getSppbTask());
 	
-	/** start countdown clock 
-	MessageSendLater(getSppbTask(), SPPB_PIPE_COUNT_DOWN, 0, 1000);**/
+	/** without direction control the uart -> spp bytes need no vm attention, let firmware move them.
+		spp -> uart stays on the vm path, in-band commands must be seen before they reach the uart **/
+	sppb.fast_path = (sppb.uart_polarity == 2);
+	
+	if (sppb.fast_path) {
+		
+		if (!StreamConnect(source, sppb.spp_sink)) {
+			
+			DEBUG(("    StreamConnect failed, uart -> spp stays on the vm path\n"));
+			sppb.fast_path = FALSE;
+		}
+	}
 	
-#endif	
+	/** start idle clock, moved on every byte **/
+	deadlineSet(&sppb.deadlines, SPPB_PIPE_IDLE_TIMEOUT_IND, SPPB_PIPE_IDLE_TIMEOUT * 1000UL);
 }
 
 void pipe_state_exit(void) {
@@ -749,21 +1091,16 @@ void pipe_state_exit(void) {
 	
 
 	
-#ifdef USE_SYSTEM_STREAM_CONNECT
-	
-	StreamDisconnect(StreamUartSource(), sppb.spp_sink);
-	StreamDisconnect(StreamSourceFromSink(sppb.spp_sink), StreamUartSink());
-	
-	SourceDrop(StreamUartSource(), SourceSize(StreamUartSource()));
-	SourceDrop(StreamSourceFromSink(sppb.spp_sink), SourceSize(StreamSourceFromSink(sppb.spp_sink)));
-	
-	StreamConnectDispose(StreamUartSource());
-	
-#else	
-	
 	Source aSource;
 	
 	aSource = StreamUartSource();
+	
+	/** take the spp sink back from firmware, echo replies are written to it **/
+	if (sppb.fast_path) {
+		
+		StreamDisconnect(aSource, 0);
+		sppb.fast_path = FALSE;
+	}
 
 	/** clear uart source and related resource **/
 	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_SPP_SINK_READY);
@@ -784,12 +1121,21 @@ void pipe_state_exit(void) {
 	/** spp_sink and related resource is maintained by super state, no need to clean-up here **/
 	
 	/** stop clock **/
-	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_COUNT_DOWN);
-	sppb.count_down = 0;
-	sppb.dirty = 0;
+	deadlineCancel(&sppb.deadlines, SPPB_PIPE_IDLE_TIMEOUT_IND);
+	sppb.packing = FALSE;
+	sppb.awaiting_reply = FALSE;
+	sppb.coalescing = FALSE;
+	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_COALESCE_TIMEOUT);
+	pipe_driver_release();
+	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_ESCAPE_GUARD);
+	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_STATS_READY);
+	sppb.escape_scanned = 0;
+	sppb.escape_draining = FALSE;
+	sppb.stats_pending = 0;
     
 
     sppb.buartseting = FALSE;
+    frameQueueReset(&sppb.spp_frames);
     MessageCancelAll(getSppbTask(), SPP_PIPE_PACK_FINISH);
     
 
@@ -798,88 +1144,425 @@ void pipe_state_exit(void) {
 	/** so don't clear spp sink related thing, they are maintained by super state, 
 		left them to connected state handler **/
 	/** (void)MessageCancelAll(getSppbTask(), SPP_MESSAGE_MORE_SPACE); **/
-#endif
+}
+
+/** drive the uart direction pio for the front frame, keeptime is the lead before the first byte is sent **/
+static void pipe_uart_tx_start(Task task) {
+	
+	if (frameQueueIsEmpty(&sppb.spp_frames)) {
+		
+		return;
+	}
 	
+	sppb.buartseting = TRUE;
+	sppb.frame_tx_start = VmGetClock();
+	sppb.frame_driver_wait = TRUE;
+	
+	/** the previous frame may still be on the wire, keep the driver until this one is out too **/
+	(void)MessageCancelAll(task, SPPB_PIPE_DRIVER_RELEASE);
+	
+	if (sppb.driver_on)
+	{
+		/** bus is already ours, send back-to-back without another lead **/
+		MessageSend(task, SPPB_PIPE_UART_SINK_READY, 0);
+	}
+    else if(sppb.uart_polarity==0)
+    {
+        ResetUartTX();
+        sppb.driver_on = TRUE;
+        MessageSendLater(task, SPPB_PIPE_UART_SINK_READY, 0, sppb.uart_keeptime);
+    }
+    else if(sppb.uart_polarity==1)
+    {
+        SetUartTX();
+        sppb.driver_on = TRUE;
+        MessageSendLater(task, SPPB_PIPE_UART_SINK_READY, 0, sppb.uart_keeptime);
+    }
+    else
+    {
+        /** no direction pio to drive **/
+        MessageSend(task, SPPB_PIPE_UART_SINK_READY, 0);
+    }
 }
 
-static void pipe_state_handler(Task task, MessageId id, Message message) {
+/** bytes just moved to the uart go out after the ones still in the uart sink, release the driver one
+	guard after the last stop bit. the wire time is worked out in us from the bytes left in the sink, at
+	the rate the divisor really produces, and rounded to ms once for the timer. adding up per-move times
+	against the ms clock would be off by up to a ms either way **/
+static void pipe_driver_hold(Task task) {
 	
-	switch (id) {
+	uint32 wire;
+	
+	if (!sppb.driver_on) {
 		
-		case SPP_MESSAGE_MORE_DATA:
+		return;
+	}
+	
+	if (sppb.uart_divisor) {
+		
+		Sink sink = StreamUartSink();
+		uint16 slack = SinkSlack(sink);
+		
+		if (slack > sppb.uart_sink_size) {
 			
-			DEBUG(("spp connected state pipe subState, SPP_MESSAGE_MORE_DATA message arrived...\n"));
-			{
-                const uint8* buf;
-			  	Source source = StreamSourceFromSink(sppb.spp_sink);
-				uint16 size = SourceSize(source);				
-				buf = SourceMap(source);  
-                sppb.dirty = TRUE;
-				
-			   if ((size > 2) && (buf[size-2] == 0x0d) && (buf[size-1] == 0x0a)&&(buf[0]== 0x0d)&&(buf[1]== 0x0a)) 
-               {	
-                   
-                   DEBUG(("   spp connected state pipe subState,SET command arrived\n"));
-				   echo_source(source); 
-                   send_echo_message(sppb.spp_sink, sppb.command_result);
-                   if(sppb.command_result != CMD_RET_OK)
-                   {
-                       pipe_state_exit();
-                       connected_state_enter();   
-                   }
-                   sppb.uart_sink_busy = FALSE;
-                   sppb.spp_sink_busy = FALSE;
-                   sppb.buartseting = FALSE;
-                   SourceDrop(source, size);
-			   }
-               else 
-               {
-                   if(sppb.buartseting == TRUE)
-                   {
-                       SourceDrop(source, size);
-                   }
-                   else
-                   {
-                       MessageCancelAll(getSppbTask(), SPP_PIPE_PACK_FINISH);
-                       MessageSendLater(task, SPP_PIPE_PACK_FINISH, 0, SPP_PIPE_PACK_TIMEOUT); 
-                   }
+			sppb.uart_sink_size = slack;
+		}
+		
+		/** the bytes in the sink and the guard, which also covers a character still in the shift register **/
+		wire = uartDivisorBytesToUs(sppb.uart_divisor, sppb.uart_bits, sppb.uart_sink_size - slack + SPP_PIPE_DRIVER_GUARD);
+	}
+	else {
+		
+		/** line timing unknown, hold for the lead time as before **/
+		wire = (uint32)sppb.uart_keeptime * 1000;
+	}
+	
+	(void)MessageCancelAll(task, SPPB_PIPE_DRIVER_RELEASE);
+	MessageSendLater(task, SPPB_PIPE_DRIVER_RELEASE, 0, uartUsToMs(wire));
+}
 
-               }
-           }
+static void pipe_driver_release(void) {
+	
+	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_DRIVER_RELEASE);
+	
+	if (sppb.driver_on) {
+		
+		ReleaseUartTX();
+		sppb.driver_on = FALSE;
+	}
+}
+
+/** a confirmed escape leaves pipe once the queued frames are out and the rs485 driver is released,
+	the OK goes out in echo when the spp sink has room **/
+static void pipe_escape_drained(void) {
+	
+	if (!sppb.escape_draining || !frameQueueIsEmpty(&sppb.spp_frames) || sppb.buartseting || sppb.driver_on) {
+		
+		return;
+	}
+	
+	/** leave pipe before replying, the spp sink may be connected to the uart in firmware **/
+	pipe_state_exit();
+	connected_state_enter();
+	
+	sppb.command_result = CMD_RET_OK;
+	sppb.command_connect = FALSE;
+	sppb.command_pending = TRUE;
+	statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+	MessageSendConditionally(getSppbTask(), SPPB_ECHO_SINK_READY, 0, &sppb.spp_sink_busy);
+}
+
+/** spp -> uart packing window: the 3.5 character line silence of the configured baudrate, stretched to
+	twice the usual gap between rfcomm packets of one frame, unless AT+PACKTIME fixed it **/
+static uint16 pipe_pack_window(void) {
+	
+	uint16 window;
+	
+	if (sppb.pack_timeout) {
+		
+		return sppb.pack_timeout;
+	}
+	
+	if (sppb.uart_baudrate == 0) {
+		
+		return SPP_PIPE_PACK_TIMEOUT;
+	}
+	
+	window = uartUsToMs(uartCharsToUs(sppb.uart_baudrate, sppb.uart_bits, SPP_PIPE_PACK_SILENCE_X10));
+	
+	if (window < sppb.pack_gap_avg / 4) {	/** pack_gap_avg is x8 **/
+		
+		window = sppb.pack_gap_avg / 4;
+	}
+	
+	if (window < SPP_PIPE_PACK_MIN_TIMEOUT) {
+		
+		window = SPP_PIPE_PACK_MIN_TIMEOUT;
+	}
+	else if (window > SPP_PIPE_PACK_TIMEOUT) {
+		
+		window = SPP_PIPE_PACK_TIMEOUT;
+	}
+	
+	return window;
+}
+
+/** a confirmed AT+STATS query is reported once the frames ahead of it left the spp source and the spp
+	sink has room **/
+static void pipe_stats_drained(void) {
+	
+	if (!sppb.stats_pending || !frameQueueIsEmpty(&sppb.spp_frames)) {
+		
+		return;
+	}
+	
+	(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_STATS_READY);
+	statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+	MessageSendConditionally(getSppbTask(), SPPB_PIPE_STATS_READY, 0, &sppb.spp_sink_busy);
+}
+
+/** in-band AT+STATS, the query is dropped and the report goes back to the peer, the pipe stays up.
+	no frame is queued, the query is at the front of the source and what came after it waited **/
+static void pipe_stats_report(void) {
+	
+	Source source = StreamSourceFromSink(sppb.spp_sink);
+	
+	TRACE(TRACE_STATS_QUERY, 0, 0);
+	
+	SourceDrop(source, sppb.stats_pending);
+	sppb.stats_pending = 0;
+	sppb.escape_scanned = 0;
+	
+	/** the query opened a frame while it could have been payload **/
+	sppb.packing = FALSE;
+	
+	/** the firmware must not write to the spp sink while the report is claimed **/
+	if (sppb.fast_path) {
+		
+		StreamDisconnect(StreamUartSource(), sppb.spp_sink);
+	}
+	
+	send_echo_message(sppb.spp_sink, CMD_RET_STATS);
+	
+	if (sppb.fast_path && !StreamConnect(StreamUartSource(), sppb.spp_sink)) {
+		
+		DEBUG(("    StreamConnect failed, uart -> spp stays on the vm path\n"));
+		sppb.fast_path = FALSE;
+	}
+	
+	if (SourceSize(source)) {
+		
+		/** bytes that arrived behind the query **/
+		MessageSend(getSppbTask(), SPP_MESSAGE_MORE_DATA, 0);
+	}
+}
+
+/** uart -> spp, number of held bytes that is worth a packet of its own **/
+static uint16 pipe_coalesce_threshold(void) {
+	
+	uint16 threshold = sppb.spp_frame_size ? sppb.spp_frame_size : SPP_PIPE_COALESCE_SIZE;
+	uint16 slack = SinkSlack(sppb.spp_sink);
+	
+	/** no point waiting for more than the spp sink can take **/
+	if (slack && slack < threshold) {
+		
+		threshold = slack;
+	}
+	
+	return threshold;
+}
+
+/** uart -> spp, SPPB_PIPE_SPP_SINK_READY is posted for the held bytes, a repost keeps the first decision **/
+static void pipe_uart_send_decided(void) {
+	
+	if (!sppb.uart_sending) {
+		
+		sppb.uart_sending = TRUE;
+		sppb.uart_send = VmGetClock();
+	}
+}
+
+static void pipe_state_handler(Task task, MessageId id, Message message) {
+	
+	switch (id) {
+		
+		case SPP_MESSAGE_MORE_DATA:
+			
+			if (sppb.escape_draining) {
+				
+				/** the peer waits for the OK of its escape, what it sends meanwhile is dropped with it **/
+				break;
+			}
+			
+			if (sppb.stats_pending) {
+				
+				/** the peer waits for its report, what it sends meanwhile stays in the source until then **/
+				break;
+			}
+			
+			{
+			  	Source source = StreamSourceFromSink(sppb.spp_sink);
+				uint16 held = frameQueueBytes(&sppb.spp_frames);
+				uint16 size = SourceSize(source) - held;		/** bytes not packed into a frame yet **/
+				uint16 fresh = 0;
+				bool escape = FALSE;
+				
+                TRACE(TRACE_SPP_MORE_DATA, size, held);
+                pipe_activity();
+                
+                /** only bytes that arrived since the last message go through the escape detector **/
+                if (size > sppb.escape_scanned) {
+                	
+                	const uint8* s = SourceMap(source) + held + sppb.escape_scanned;
+                	uint32 now = VmGetClock();
+                	
+                	fresh = size - sppb.escape_scanned;
+                	escape = escapeDetectFeed(&sppb.escape, s, fresh, now);
+                	
+                	/** both detectors see every byte, their sequences may begin alike **/
+                	if (escapeDetectFeed(&sppb.stats_escape, s, fresh, now)) {
+                		
+                		escape = TRUE;
+                	}
+                	sppb.escape_scanned = size;
+                }
+				
+			   if (fresh == 0)
+			   {
+			   	   /** nothing new **/
+			   }
+			   else if (escape) 
+               {	
+                   /** may be the escape sequence, hold it until the line stays silent for the guard time.
+                   	if it turns out to be payload its frame is gathered from here **/
+                   if (!sppb.packing) {
+                   	
+                   	sppb.packing = TRUE;
+                   	sppb.pack_start = VmGetClock();
+                   }
+                   sppb.spp_last_arrival = VmGetClock();
+                   
+                   MessageCancelAll(getSppbTask(), SPP_PIPE_PACK_FINISH);
+                   MessageCancelAll(getSppbTask(), SPPB_PIPE_ESCAPE_GUARD);
+                   MessageSendLater(task, SPPB_PIPE_ESCAPE_GUARD, 0, escapeDetectGuard(&sppb.escape));
+			   }
+               else if (sppb.fast_path)
+               {
+                   /** no direction window to fill, forward as it arrives **/
+                   MessageCancelAll(getSppbTask(), SPPB_PIPE_ESCAPE_GUARD);
+                   if (!frameQueuePush(&sppb.spp_frames, size, VmGetClock())) {
+                   	
+                   	statInc(STAT_FRAMES_MERGED);
+                   }
+                   sppb.escape_scanned = 0;
+                   
+                   if (sppb.buartseting == FALSE) {
+                   	
+                   	pipe_uart_tx_start(task);
+                   }
+               }
+               else 
+               {
+                   uint32 now = VmGetClock();
+                   uint32 gap = now - sppb.spp_last_arrival;
+                   
+                   MessageCancelAll(getSppbTask(), SPPB_PIPE_ESCAPE_GUARD);
+                   
+                   /** gap between two rfcomm packets of the same frame, smoothed with 1/8 weight. a full packet
+                   	before the gap means more of its frame was coming, so the gap counts even when the window
+                   	closed before the rest came, that is the gap the window is too short for **/
+                   if (sppb.packing || (sppb.spp_last_full && gap <= SPP_PIPE_PACK_TIMEOUT)) {
+                   	
+                   	if (gap > SPP_PIPE_PACK_TIMEOUT) {
+                   		
+                   		gap = SPP_PIPE_PACK_TIMEOUT;
+                   	}
+                   	
+                   	/** the first one is taken as it is, the window can't wait for eight splits **/
+                   	sppb.pack_gap_avg = sppb.pack_gap_avg ? sppb.pack_gap_avg - sppb.pack_gap_avg / 8 + (uint16)gap : (uint16)gap * 8;
+                   }
+                   
+                   if (!sppb.packing) {
+                   	
+                   	sppb.packing = TRUE;
+                   	sppb.pack_start = now;
+                   }
+                   sppb.spp_last_arrival = now;
+                   sppb.spp_last_full = fresh >= sppb.spp_frame_size;
+                   
+                   /** keep gathering even if uart is busy, the packed frame is queued behind the one being sent **/
+                   MessageCancelAll(getSppbTask(), SPP_PIPE_PACK_FINISH);
+                   MessageSendLater(task, SPP_PIPE_PACK_FINISH, 0, pipe_pack_window()); 
+               }
+           }
            break;
                 
         case  SPP_PIPE_PACK_FINISH :
             {             
                 Source source = StreamSourceFromSink(sppb.spp_sink);
-				uint16 size = SourceSize(source);
+				uint16 size = SourceSize(source) - frameQueueBytes(&sppb.spp_frames);
+				uint32 now = VmGetClock();
+				
+                TRACE(TRACE_PACK_FINISH, size, 0);
+				statInc(STAT_PACK_TIMEOUTS);
 				
-                DEBUG(("spp connected state pipe subState,SPP_PIPE_PACK_FINISH arrived active uart\n"));    	
-			    sppb.Spp_ReceiveNum = size;
-				memcpy(sppb.pSpp_ReceiveBuf, SourceMap(source), size);/*if size more than 256 what can i do???*/
-				sppb.buartseting = TRUE;
-                SourceDrop(source, size);          
+				/** the bytes stay in the spp source, only the frame boundary is recorded **/
+				if (!frameQueuePush(&sppb.spp_frames, size, sppb.packing ? sppb.pack_start : now)) {
+					
+					TRACE(TRACE_FRAME_MERGED, 0, 0);
+					statInc(STAT_FRAMES_MERGED);
+				}
+				sppb.escape_scanned = 0;
+				
+				if (sppb.packing) {
+					
+					latencyHistAdd(&sppb.lat[LAT_S2U_GATHER], now - sppb.pack_start);
+					
+					sppb.request_time = sppb.pack_start;
+					sppb.awaiting_reply = TRUE;
+					sppb.packing = FALSE;
+				}
 
-               if(sppb.uart_polarity==0)
-                {
-                    ResetUartTX();
-                    MessageSendLater(task, SPP_ECHO_PIOSTATE_TIMEOUT, 0, sppb.uart_keeptime);
-                }
-                else if(sppb.uart_polarity==1)
-                {
-                    SetUartTX();
-                    MessageSendLater(task, SPP_ECHO_PIOSTATE_TIMEOUT, 0, sppb.uart_keeptime);
-                }
-                else
-                    MessageSend(task, SPP_ECHO_PIOSTATE_TIMEOUT,0);                     
+				/** if uart is idle start driving it now, otherwise the frame goes out after the ones ahead of it **/
+				if (sppb.buartseting == FALSE) {
+					
+					pipe_uart_tx_start(task);
+				}
            }
             
         break;
         
-        case  SPP_ECHO_PIOSTATE_TIMEOUT:        
+        case  SPPB_PIPE_ESCAPE_GUARD:
+        	{
+        		bool to_echo = escapeDetectExpired(&sppb.escape);
+        		bool report = escapeDetectExpired(&sppb.stats_escape);
+        		
+        		if (to_echo) {
+        			
+        			TRACE(TRACE_ESCAPE, 0, 0);
+        			
+        			/** the frames ahead of the escape reach the uart first **/
+        			sppb.escape_draining = TRUE;
+        			pipe_escape_drained();
+        		}
+        		else if (report) {
+        			
+        			/** the unpacked bytes are the query, it is answered after the frames ahead of it **/
+        			sppb.stats_pending = SourceSize(StreamSourceFromSink(sppb.spp_sink)) - frameQueueBytes(&sppb.spp_frames);
+        			pipe_stats_drained();
+        		}
+        		else {
+        			
+        			/** only part of the sequence, it was payload after all **/
+        			MessageSend(task, SPP_PIPE_PACK_FINISH, 0);
+        		}
+        	}
+        	break;
+        	
+        case  SPPB_PIPE_STATS_READY:
+        	
+        	if (SinkSlack(sppb.spp_sink) == 0) {
+        		
+        		sppb.spp_sink_busy = TRUE;
+        		statInc(STAT_SPP_SINK_WAITS);
+        		MessageSendConditionally(getSppbTask(), SPPB_PIPE_STATS_READY, 0, &sppb.spp_sink_busy);
+        	}
+        	else {
+        		
+        		pipe_stats_report();
+        	}
+        	break;
+        	
+        case  SPPB_PIPE_DRIVER_RELEASE:        
         {
-             DEBUG(("spp connected state pipe subState,SPP_ECHO_PIOSTATE_TIMEOUT arrived uart had been actived and send data\n"  ));
-             PioSetDir(PIO3, 0);          
-             MessageSendLater(getSppbTask(), SPPB_PIPE_UART_SINK_READY, 0, 1);           
+             TRACE(TRACE_DRIVER_RELEASE, 0, 0);
+             
+             /** a frame still going out in parts reschedules the release with its next move **/
+             if (sppb.buartseting == FALSE) {
+             	
+             	pipe_driver_release();
+             	pipe_escape_drained();
+             }
         }    
         break;
                 
@@ -888,37 +1571,53 @@ static void pipe_state_handler(Task task, MessageId id, Message message) {
             
           { 
 
-			DEBUG(("spp connected state, SPP_MESSAGE_MORE_SPACE message arrived...\n"));
-	
-			DEBUG(( "    spp sink has %d byte more space, spp_sink_busy erase... \n", (SinkSlack(sppb.spp_sink)) ));
+			TRACE(TRACE_SPP_MORE_SPACE, SinkSlack(sppb.spp_sink), 0);
 			sppb.spp_sink_busy = FALSE;
         }
 			break;
 		
 		case MESSAGE_MORE_DATA:
 
-			DEBUG(("spp connected state pipe subState, MESSAGE_MORE_DATA message arrived...\n"));
-              			
 			{
 				Source source = StreamUartSource();
 				uint16 size = SourceSize(source);
            
 				if (size) 
                 {
+                	pipe_activity();
+                	
+                	if (!sppb.uart_held) {
+                		
+                		sppb.uart_held = TRUE;
+                		sppb.uart_arrival = VmGetClock();
+                	}
 #if 0                    
 					sppb.Uart_ReceiveNum = size;
 					memcpy(sppb.pUart_ReceiveBuf, SourceMap(source), size);
 					SourceDrop(source, size);
 #endif
-					MessageSendConditionally(getSppbTask(), SPPB_PIPE_SPP_SINK_READY, 0, &sppb.uart_sink_busy);
+					if (size >= pipe_coalesce_threshold() || sppb.coalesce_timeout == 0) {
+						
+						/** a full rfcomm frame, or AT+COALESCE=0, send it now **/
+						(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_COALESCE_TIMEOUT);
+						(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_SPP_SINK_READY);
+						sppb.coalescing = FALSE;
+						pipe_uart_send_decided();
+						statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+						MessageSendConditionally(getSppbTask(), SPPB_PIPE_SPP_SINK_READY, 0, &sppb.spp_sink_busy);
+					}
+					else if (!sppb.coalescing) {
+						
+						/** armed once from the first held byte, later bytes don't push it back **/
+						sppb.coalescing = TRUE;
+						MessageSendLater(getSppbTask(), SPPB_PIPE_COALESCE_TIMEOUT, 0, sppb.coalesce_timeout);
+					}
 				}
 				else 
                 {
 					SourceDrop(source, size);
 				}
-				sppb.dirty = TRUE;
-				
-				DEBUG(( "    uart source has %d bytes now... job scheduled... \n",size));
+				TRACE(TRACE_UART_MORE_DATA, size, 0);
 			}
 			break;
 			
@@ -926,83 +1625,138 @@ static void pipe_state_handler(Task task, MessageId id, Message message) {
          
            {
                 
-			DEBUG(("spp connected state pipe subState, MESSAGE_MORE_SPACE message arrived...\n"));	
             sppb.uart_sink_busy = FALSE;
-			DEBUG(("    uart has %d byte more space, busy flag erased...\n", (SinkSlack(StreamUartSink())) ));
+			TRACE(TRACE_UART_MORE_SPACE, SinkSlack(StreamUartSink()), 0);
             
           }          
 			break;
-#if 0			
-		case SPPB_PIPE_COUNT_DOWN:
 			
-/*			DEBUG(("spp connected state pipe subState, SPPB_PIPE_COUNT_DOWN message arrived...\n"));*/
-			if (sppb.dirty) 
-            {
+		case SPPB_PIPE_COALESCE_TIMEOUT:
+			
+			TRACE(TRACE_COALESCE_TIMEOUT, 0, 0);
+			
+			sppb.coalescing = FALSE;
+			pipe_uart_send_decided();
+			(void)MessageCancelAll(getSppbTask(), SPPB_PIPE_SPP_SINK_READY);
+			statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+			MessageSendConditionally(getSppbTask(), SPPB_PIPE_SPP_SINK_READY, 0, &sppb.spp_sink_busy);
+			break;
+		case SPPB_PIPE_IDLE_TIMEOUT_IND:
+			
+			TRACE(TRACE_IDLE_TIMEOUT, 0, 0);
+			
+			if (sppb.fast_path) {
 				
-				sppb.count_down = SPPB_PIPE_IDLE_TIMEOUT;
-				sppb.dirty = FALSE;
-				MessageSendLater(getSppbTask(), SPPB_PIPE_COUNT_DOWN, 0, 1000);
+				/** uart -> spp bytes bypass the vm and are never seen, polarity 2 has no idle disconnect,
+					see sppb.h. spp -> uart traffic arms the timeout again, nothing else is done **/
 			}
-			else 
-            {
-				
-				sppb.count_down = sppb.count_down - 1;
+			else {
 				
-				if (sppb.count_down == 0) 
-                {
-					 
-					connected_state_exit();
-					sppb.state = SPPB_DISCONNECTING;
-					disconnecting_state_enter();
-				}
-				else 
-                {
-					
-					MessageSendLater(getSppbTask(), SPPB_PIPE_COUNT_DOWN, 0, 1000);
-				}
+				connected_state_exit();
+				setSppState(SPPB_DISCONNECTING);
+				disconnecting_state_enter();
 			}
 			break;
-#endif			
+			
 		case SPPB_PIPE_UART_SINK_READY:
 			
-            DEBUG(("spp connected state pipe subState, SPPB_PIPE_UART_SINK_READY message arrived...\n"));
            {    
-			 	Source source;
 				Sink sink;
+				const frame_desc_t* frame;
 				
 				sink = StreamUartSink();
-				source = StreamSourceFromSink(sppb.spp_sink);
+				frame = frameQueueFront(&sppb.spp_frames);
+				
+				TRACE(TRACE_UART_SINK_READY, frame ? frame ->length : 0, 0);
+				
+				if (frame && sppb.frame_driver_wait) {
+					
+					/** first ready of this window, the lead time is over whether the sink has room or not **/
+					sppb.frame_tx_ready = VmGetClock();
+					sppb.frame_driver_wait = FALSE;
+					latencyHistAdd(&sppb.lat[LAT_S2U_DRIVER], sppb.frame_tx_ready - sppb.frame_tx_start);
+				}
 				
 				if (sink == 0 || !SinkIsValid(sink)) 
                 {	
 					raise_exception(3, 1);
-				}								
-                if (SinkSlack(sink) == 0) { /** this should not happen **/
+				}
+				else if (frame == 0) {
+					
+					/** queue flushed by an in-band command meanwhile **/
+					sppb.buartseting = FALSE;
+					pipe_escape_drained();
+					pipe_stats_drained();
+				}
+				else if (sppb.uart_sink_busy || SinkSlack(sink) == 0) {
 					
-					DEBUG(("    UART_SINK_READY arrived but sink is not available............ERROR!!!\n"));
+					TRACE(TRACE_UART_SINK_WAIT, 0, 0);
+					statInc(STAT_SINK_FULL);
 					
-					raise_exception(1, 1);
+					sppb.uart_sink_busy = TRUE;
+					statInc(STAT_UART_SINK_WAITS);
+					MessageSendConditionally(getSppbTask(), SPPB_PIPE_UART_SINK_READY, 0, &sppb.uart_sink_busy);
 				}
-             
-           else  if ((sppb.Spp_ReceiveNum)&&(sppb.uart_sink_busy==FALSE)) 
-             {                        
-
-			      DEBUG(("spp connected state pipe subState, message is valid...\n"));
-                   
-                  sppb.uart_sink_busy = TRUE; 
+				else 
+				{                        
+				  Source source = StreamSourceFromSink(sppb.spp_sink);
+				  uint16 count = frame ->length;
+				  uint16 count_moved;
+				  
+                  /** a frame larger than the uart buffer goes out in several moves under the same direction window **/
+                  if (count > SinkSlack(sink)) {
+                  	
+                  	count = SinkSlack(sink);
+                  }
                   
-			      buffer1_to_sink(StreamUartSink(), sppb.pSpp_ReceiveBuf, sppb.Spp_ReceiveNum);
-                  sppb.buartseting = FALSE;
+                  count_moved = StreamMove(sink, source, count);
+                  (void)SinkFlush(sink, count_moved);
+                  pipe_driver_hold(task);
+                  statAdd(STAT_SPP_TO_UART_BYTES, count_moved);
+                  TRACE(TRACE_UART_MOVED, count_moved, frame ->length);
                   
-                  memset(sppb.pSpp_ReceiveBuf, 0, sppb.Spp_ReceiveNum);
-                  sppb.Spp_ReceiveNum = 0; 
-			  }
+                  if (count_moved != count) {
+                  	
+                  	TRACE(TRACE_UART_MOVE_SHORT, count_moved, count);
+                  	raise_exception(3, 3);
+                  	
+                  	/** give up this frame rather than stall the queue **/
+                  	statAdd(STAT_BYTES_DROPPED, frame ->length - count_moved);
+                  	SourceDrop(source, frame ->length - count_moved);
+                  	count_moved = frame ->length;
+                  }
+                  
+                  sppb.uart_sink_busy = TRUE; 
+                  
+                  if (count_moved < frame ->length) {
+                  	
+                  	/** rest of this frame when the uart drained **/
+                  	frameQueueConsume(&sppb.spp_frames, count_moved);
+                  	statInc(STAT_UART_SINK_WAITS);
+                  	MessageSendConditionally(getSppbTask(), SPPB_PIPE_UART_SINK_READY, 0, &sppb.uart_sink_busy);
+                  }
+                  else {
+                  	
+                  	uint32 now = VmGetClock();
+                  	
+                  	latencyHistAdd(&sppb.lat[LAT_S2U_SINK], now - sppb.frame_tx_ready);
+                  	latencyHistAdd(&sppb.lat[LAT_S2U_TOTAL], now - frame ->arrival);
+                  	
+                  	frameQueueConsume(&sppb.spp_frames, count_moved);
+                  	sppb.buartseting = FALSE;
+                  	statInc(STAT_SPP_TO_UART_FRAMES);
+                  	
+                  	/** frames packed while this one was waiting **/
+                  	pipe_uart_tx_start(task);
+                  	pipe_escape_drained();
+                  	pipe_stats_drained();
+                  }
+				}
            }
 			break;
 			
 		case SPPB_PIPE_SPP_SINK_READY:
             
-            DEBUG(("spp connected state pipe subState, SPPB_PIPE_SPP_SINK_READY message arrived...\n"));
 			{
              
 				Source source;
@@ -1014,25 +1768,28 @@ static void pipe_state_handler(Task task, MessageId id, Message message) {
 				if (sink == 0 || !SinkIsValid(sink)) 
                 {
 					raise_exception(3, 1);
-                    DEBUG(("    SinkIsValid arrived3, 6 .........ERROR ??? \n"));
+                    TRACE(TRACE_SPP_SINK_INVALID, 0, 0);
 				}
 				else if (source == 0 || !SourceIsValid(source)) 
                 {
 					raise_exception(3, 1);
-                    DEBUG(("    SourceIsValid 3, 8.........ERROR ??? \n"));
+                    TRACE(TRACE_SPP_SINK_INVALID, 0, 0);
 				}
 				
-				DEBUG(( "    ---- begin of SPPB_PIPE_SPP_SINK_READY processing ----\n" ));
-				
 				if (SourceSize(source) == 0) {	/** nothing to send **/
 					
-					DEBUG(("    SPP_SINK_READY arrived but source has no data to send.........ERROR ??? \n"));
+					TRACE(TRACE_SPP_SINK_EMPTY, 0, 0);
 				}
-				else if (SinkSlack(sink) == 0) { /** this should not happen **/
+				else if (SinkSlack(sink) == 0) {
 					
-					DEBUG(("    SPP_SINK_READY arrived but sink is not available3, 1...........ERROR !!! \n"));
+					/** back-pressure from the link, not an error. the sink drains into the air and
+						SPP_MESSAGE_MORE_SPACE clears the flag **/
+					TRACE(TRACE_SPP_SINK_FULL, 0, 0);
+					statInc(STAT_SINK_FULL);
 					
-					raise_exception(3, 1);
+					sppb.spp_sink_busy = TRUE;
+					statInc(STAT_SPP_SINK_WAITS);
+					MessageSendConditionally(getSppbTask(), SPPB_PIPE_SPP_SINK_READY, 0, &sppb.spp_sink_busy);
 				}
 				else 
                 {
@@ -1041,44 +1798,69 @@ static void pipe_state_handler(Task task, MessageId id, Message message) {
 					uint16 count = SourceSize(source);
 					uint16 count_moved;
 					bool flush_result;
+					uint32 now;
 					
-					DEBUG(("    uart source want to send %d byte data...\n", count));
+					TRACE(TRACE_SPP_SINK_READY, count, SinkSlack(sink));
 					if (count > SinkSlack(sink)) 
                     {
-                        DEBUG(("    but spp sink has only %d byte space...\n", count));
-                        raise_exception(3, 1);
-						/*count = SinkSlack(sink);**/	
+                        /** coalesced data can outgrow the sink, the rest follows when it drains **/
+						count = SinkSlack(sink);
 					}
 					
 					count_moved = StreamMove(sink, source, count);
                     if (count_moved != count) 
                     {
-                        DEBUG(("    count_moved != count"));
+                        TRACE(TRACE_SPP_MOVE_SHORT, count_moved, count);
 						raise_exception(3, 3);
                         
 					}
 					else {
 					}
 					
-					flush_result = SinkFlush(sink, count);
+					/** only what was moved is claimed in the sink **/
+					flush_result = SinkFlush(sink, count_moved);
 					if ((flush_result == FALSE)) {
-                        DEBUG(("    flush_result!=count_moved"));
+                        TRACE(TRACE_SPP_FLUSH_FAILED, 0, 0);
 						raise_exception(3, 1);
                         
 					}
 					
 					sppb.spp_sink_busy = TRUE;
 					
-					DEBUG(("    %d bytes moved from uart source to spp sink... spp busy flag set... \n", count));
+					statInc(STAT_UART_TO_SPP_PACKETS);
+					statAdd(STAT_UART_TO_SPP_BYTES, count_moved);
+					
+					now = VmGetClock();
+					
+					if (sppb.uart_held && sppb.uart_sending) {
+						
+						/** a short sink sends the rest as another sample from the same arrival **/
+						latencyHistAdd(&sppb.lat[LAT_U2S_GATHER], sppb.uart_send - sppb.uart_arrival);
+						latencyHistAdd(&sppb.lat[LAT_U2S_SINK], now - sppb.uart_send);
+						latencyHistAdd(&sppb.lat[LAT_U2S_TOTAL], now - sppb.uart_arrival);
+					}
+					sppb.uart_sending = FALSE;
+					
+					if (sppb.awaiting_reply) {
+						
+						latencyHistAdd(&sppb.lat[LAT_ROUNDTRIP], now - sppb.request_time);
+						sppb.awaiting_reply = FALSE;
+					}
+					
+					TRACE(TRACE_SPP_MOVED, count_moved, SourceSize(source));
 					
 					if (SourceSize(source) == 0)
                     {	
-						
-						DEBUG(("    uart source has no more bytes to send... \n"));
+						sppb.uart_held = FALSE;
+					}
+					else if (!sppb.coalescing)
+					{
+						/** left over from a short sink, send it once the spp sink drained **/
+						pipe_uart_send_decided();
+						statAdd(STAT_SPP_SINK_WAITS, sppb.spp_sink_busy != 0);
+						MessageSendConditionally(getSppbTask(), SPPB_PIPE_SPP_SINK_READY, 0, &sppb.spp_sink_busy);
 					}
 				}
-				
-				DEBUG(( "    ---- end of SPPB_PIPE_SPP_SINK_READY processing ----\n" ));
 			}
 
             
@@ -1140,6 +1922,21 @@ void connected_state_handler(Task task, MessageId id, Message message) {
 			
 			break;
 			
+		case SPPB_LINK_POLICY_IDLE:
+			{
+				uint32 wait;
+				
+				if (linkPolicyIdle(&sppb.link, VmGetClock(), &wait)) {
+					
+					link_stage_apply();
+				}
+				else if (wait) {
+					
+					deadlineSet(&sppb.deadlines, SPPB_LINK_POLICY_IDLE, wait);
+				}
+			}
+			break;
+			
 		case SPP_MESSAGE_MORE_SPACE:
 			
 
@@ -1170,7 +1967,7 @@ void disconnecting_state_enter(void) {
 	
 	DEBUG(("spp disconnecting state enter...\n"));
 	
-	update_indication();
+	indicationLink();
 	/** check reason and output debug **/
 	SppDisconnect(sppb.spp);
 }
@@ -1204,6 +2001,13 @@ void sppb_handler(Task task, MessageId id, Message message) {
 	
 	sppb_state_t state = sppb.state;
 	
+	if (id == SPPB_DEADLINE_TICK) {
+		
+		/** expired deadlines come back through this handler **/
+		deadlineTick(&sppb.deadlines);
+		return;
+	}
+	
 	if ((id & 0xFF00) == CL_MESSAGE_BASE) {
 		
 		cl_handler(task, id, message);
@@ -1241,6 +2045,42 @@ void sppb_handler(Task task, MessageId id, Message message) {
 	}
 }
 
+/** give the current link policy stage to the connection library and time the step to the next one **/
+static void link_stage_apply(void) {
+	
+	uint32 wait = linkPolicyStageIdle(&sppb.link);
+	
+	DEBUG(("spp link policy stage %d...\n", sppb.link.stage));
+	
+	ConnectionSetLinkPolicy(sppb.spp_sink, 1, linkPolicyEntry(&sppb.link));
+	
+	if (wait) {
+		
+		deadlineSet(&sppb.deadlines, SPPB_LINK_POLICY_IDLE, wait);
+	}
+	else {
+		
+		deadlineCancel(&sppb.deadlines, SPPB_LINK_POLICY_IDLE);
+	}
+}
+
+/** bytes from or to the peer in any sub-state, leave sniff at once **/
+static void link_activity(void) {
+	
+	if (linkPolicyTraffic(&sppb.link, VmGetClock())) {
+		
+		link_stage_apply();
+	}
+}
+
+/** bytes moved through the pipe, leave sniff at once and push the idle timeout back **/
+static void pipe_activity(void) {
+	
+	link_activity();
+	
+	deadlineSet(&sppb.deadlines, SPPB_PIPE_IDLE_TIMEOUT_IND, SPPB_PIPE_IDLE_TIMEOUT * 1000UL);
+}
+
 /*************************************************************************
 NAME    
     appHandleClDmRemoteFeaturesCfm
@@ -1256,8 +2096,8 @@ static void appHandleClDmRemoteFeaturesCfm(sppb_task_t *theApp, CL_DM_REMOTE_FEA
 {
     
 	
-    /* Set link low power policy */
-    ConnectionSetLinkPolicy(theApp->spp_sink, APP_POWER_TABLE_ENTRIES, app_keyboard_power_table);    
+    /* Set link low power policy, active until the pipe goes quiet */
+    link_stage_apply();
     
     if (cfm->status == hci_success &&
         cfm->features[2] & 0x0200)                  /* remote supports Sniff Subrating */
@@ -1283,6 +2123,11 @@ void cl_handler(Task task, MessageId id, Message message) {
     case CL_DM_MODE_CHANGE_EVENT:
         
             DEBUG(("CL_DM_MODE_CHANGE_EVENT arrived&&&&&&&&&&\r\n"));
+            
+            if (sppb.state == SPPB_CONNECTED) {
+            	
+            	linkPolicyModeChange(&sppb.link, ((CL_DM_MODE_CHANGE_EVENT_T*)message) ->mode, VmGetClock());
+            }
         
             break;
             
@@ -1374,12 +2219,22 @@ void cl_handler(Task task, MessageId id, Message message) {
   ***/
 void sppb_init(Task hal_task) {
 	
-	sppb.pSpp_ReceiveBuf = malloc( KSPP_RECEIVEDBUF_NUM );
+    frameQueueInit(&sppb.spp_frames);
+    escapeDetectInit(&sppb.escape, ESCAPE_DEFAULT_CHAR, ESCAPE_DEFAULT_COUNT, ESCAPE_DEFAULT_GUARD);
+    escapeDetectInit(&sppb.stats_escape, SPP_PIPE_STATS_CHAR, ESCAPE_DEFAULT_COUNT, ESCAPE_DEFAULT_GUARD);
+    latencyHistReset(sppb.lat, SPPB_LATENCIES);
     
-    if( NULL ==  sppb.pSpp_ReceiveBuf )
-    {
-        Panic();
-    }
+    sppb.uart_baudrate = 0;
+    sppb.uart_bits = 0;
+    sppb.uart_divisor = 0;
+    sppb.uart_stop = 1;
+    sppb.autobauding = FALSE;
+    sppb.pack_timeout = 0;
+    sppb.coalesce_timeout = SPP_PIPE_COALESCE_TIMEOUT;
+    sppb.pack_gap_avg = 0;
+    sppb.link.active_idle = LINK_POLICY_ACTIVE_IDLE;
+    sppb.spp_frame_size = 0;
+    statsReset();
 #if 0    
     sppb.pUart_ReceiveBuf = malloc( KSPP_RECEIVEDBUF_NUM );
     
@@ -1390,6 +2245,7 @@ void sppb_init(Task hal_task) {
 #endif    
 	sppb.task.handler = sppb_handler;
 	sppb.hal_task = hal_task;
+	deadlineInit(&sppb.deadlines, getSppbTask(), SPPB_DEADLINE_TICK);
 	
 	sppb.spp = 0;
 	sppb.spp_sink = 0;
@@ -1448,66 +2304,45 @@ void sppb_init(Task hal_task) {
 
 #endif 
 
-void buffer1_to_sink(Sink sink, uint8* buffer, uint16 num) {
-	
-	uint16 size, offset;
-	uint8* dst;
-	
-    
-	if (sink == 0 || num == 0) {
-		
-		DEBUG(("buffer_to_sink, invalid parameter...\n"));
-		return;
-	}
-	size = SinkSlack(sink);
-	
-	if (size < num) {
-		
-		DEBUG(("buffer_to_sink, buffer size is larger than available space in sink...\n"));
-		return;
-	}
-	offset = SinkClaim(sink, num);
-	if (offset == 0xFFFF) {
-		
-		DEBUG(("buffer_to_sink, SinkClaim failed...\n"));
-		return;
-	}
-	dst = SinkMap(sink);
-	if (dst == 0) {
-		
-		DEBUG(("buffer_to_sink, SinkMap failed...\n"));
-		return;
-	}
-	memcpy(dst + offset, buffer, num);
-    
-    DEBUG(("buffer_to_sink, %d...\n",num));	
-    
-	
-	if (SinkFlush(sink, num) == 0) {
-	
-		DEBUG(("buffer_to_sink, SinkFlush fail...\n"));
-		return;
-	}
-	DEBUG(("buffer_to_sink, SinkMap sucess...\n"));	
-	return;
-}
-
-
 const char rt_ok[32] = "\r\nOK\r\n";
 const char baud_err[32] = "\r\nBAUDRATE ERROR\r\n";
 const char stop_err[32] = "\r\nSTOP ERROR\r\n";
 const char parity_err[32] = "\r\nPARITY ERROR\r\n";
 const char polarity_err[32] = "\r\npolarity ERROR\r\n";
 const char unrecognized[32] = "\r\nUNRECOGNIZED\r\n";
+const char autobaud_err[32] = "\r\nAUTOBAUD ERROR\r\n";
 
+/** variable reports are built here, the counter report needs about 200 chars **/
+static char echo_report[208];
+
+/** AT+LATENCY line tags, in sppb_latency_t order **/
+static const char* const latency_tags[SPPB_LATENCIES] = {
+	
+	"S2U_GATHER", "S2U_DRIVER", "S2U_SINK", "S2U_TOTAL",
+	"U2S_GATHER", "U2S_SINK", "U2S_TOTAL",
+	"ROUNDTRIP"
+};
 
 
-/** this function should , but not return error, need refine **/
+
+/** single reply, flushed at once **/
 void send_echo_message(Sink sink, at_command_return_code_t ret_code) {
 	
-	uint16 length, offset;
+	uint16 length = echo_reply(sink, ret_code);
+	
+	if (length) {
+		
+		/** may return zero for error **/
+		(void)SinkFlush(sink, length);
+	}
+}
+
+/** claim and write the reply behind whatever is already claimed, the caller flushes. returns the
+	claimed length, 0 if the sink had no room. this function should , but not return error, need refine **/
+static uint16 echo_reply(Sink sink, at_command_return_code_t ret_code) {
+	
+	uint16 length;
 	const char* p;
-	uint8* dest;
 	
 	switch (ret_code) {
 		
@@ -1534,6 +2369,72 @@ void send_echo_message(Sink sink, at_command_return_code_t ret_code) {
         case CMD_RET_UNSUPPORTED_P0LARITY:
             p = polarity_err;
             break;
+            
+		case CMD_RET_LATENCY:
+			{
+				uint16 i;
+				
+				/** all the lines don't fit echo_report, each one is claimed as soon as it is built **/
+				length = echo_claim(sink, "\r\n");
+				
+				for (i = 0; i < SPPB_LATENCIES; i++) {
+					
+					(void)echoTextEnd(latencyHistFormat(echo_report, &sppb.lat[i], latency_tags[i]));
+					length += echo_claim(sink, echo_report);
+				}
+				
+				return length + echo_claim(sink, "OK\r\n");
+			}
+			
+		case CMD_RET_STATS:
+			{
+				char* q = echoTextString(echo_report, "\r\n");
+				q = statsFormat(q);
+				q = echoTextString(q, "OK\r\n");
+				(void)echoTextEnd(q);
+				
+				p = echo_report;
+			}
+			break;
+			
+		case CMD_RET_TRACE:
+			
+			/** the lines are claimed straight into the sink, as many as fit with room left for the OK **/
+			length = traceDump(sink, strlen(rt_ok));
+			return length + echo_reply(sink, CMD_RET_OK);
+			
+		case CMD_RET_AUTOBAUD_LOCKED:
+			{
+				char* q = echoTextString(echo_report, "\r\n+AUTOBAUD:");
+				q = echoTextUint(q, sppb.uart_baudrate);
+				q = echoTextString(q, ",");
+				q = echoTextUint(q, autobaudParity(&sppb.autobaud));
+				q = echoTextString(q, ",");
+				q = echoTextUint(q, (uint16)autobaudBestScore(&sppb.autobaud));
+				q = echoTextString(q, "\r\nOK\r\n");
+				(void)echoTextEnd(q);
+				
+				p = echo_report;
+			}
+			break;
+			
+		case CMD_RET_AUTOBAUD_FAILED:
+			
+			p = autobaud_err;
+			break;
+			
+		case CMD_RET_BAUDRATE_APPROX:
+			{
+				char* q = echoTextString(echo_report, "\r\n+BAUDRATE:");
+				q = echoTextUint(q, uartDivisorBaud(sppb.uart_divisor));
+				q = echoTextString(q, ",");
+				q = echoTextUint(q, uartRateError(sppb.uart_baudrate, sppb.uart_divisor));
+				q = echoTextString(q, "\r\nOK\r\n");
+				(void)echoTextEnd(q);
+				
+				p = echo_report;
+			}
+			break;
 			
 		case CMD_RET_UNRECOGNIZED:
 		default:
@@ -1542,16 +2443,24 @@ void send_echo_message(Sink sink, at_command_return_code_t ret_code) {
 			break;
 	}	
 	
+	return echo_claim(sink, p);
+}
+
+/** claim and copy one string, returns its length or 0 if the sink had no room **/
+static uint16 echo_claim(Sink sink, const char* p) {
+	
+	uint16 length, offset;
+	uint8* dest;
+	
 	length = strlen(p);
 	
 	offset = SinkClaim(sink, length);
-	if (offset == 0xFFFF) return;
+	if (offset == 0xFFFF) return 0;
 	
 	dest = SinkMap(sink);
 	memcpy(dest + offset, p, length);
 	
-	/** may return zero for error **/
-	SinkFlush(sink, length);
+	return length;
 }
 
 
@@ -6,15 +6,35 @@
 
 #include "messagebase.h"
 #include "app_state.h"
+#include "frame_queue.h"
+#include "latency_hist.h"
+#include "escape_detect.h"
+#include "autobaud.h"
+#include "session_profile.h"
+#include "scan_schedule.h"
+#include "link_policy.h"
+#include "deadline.h"
 
 /** **/
 #define SPPB_PAIRABLE_DURATION 		(90000)
 #define SPPB_ECHO_DURATION			(90000)
+
+/** the pipe disconnects after this long without a byte either way. not with polarity 2 (fast_path):
+	uart -> spp is StreamConnect()ed in firmware and never seen, a quiet phone would hide a one way
+	stream from the uart, so AT+CONNECT=...,2,... disables the idle disconnect **/
 #define SPPB_PIPE_IDLE_TIMEOUT		(600)		/*in seconds **/
 
-#define SPP_PIPE_PACK_TIMEOUT    20
+#define SPP_PIPE_PACK_TIMEOUT    20		/** packing window upper bound, and the window until the uart is configured **/
+#define SPP_PIPE_PACK_MIN_TIMEOUT	2		/** packing window lower bound **/
+#define SPP_PIPE_PACK_SILENCE_X10	35		/** modbus style frame gap, 3.5 characters **/
+
+#define SPP_PIPE_DRIVER_GUARD		1		/** characters the rs485 driver stays enabled after the last stop bit **/
 
-#define KSPP_RECEIVEDBUF_NUM    256
+#define SPP_PIPE_COALESCE_TIMEOUT	8		/** uart -> spp, default max ms the first held byte waits for the rfcomm frame to fill **/
+#define SPP_PIPE_COALESCE_MAX		100		/** AT+COALESCE upper bound **/
+#define SPP_PIPE_COALESCE_SIZE		127		/** uart -> spp send threshold until the rfcomm frame size is known **/
+
+#define SPP_PIPE_STATS_CHAR			'?'		/** "???" framed by the escape guard time reports the counters in pipe state **/
 
 /** sppb state **/
 typedef enum
@@ -36,6 +56,20 @@ typedef enum
     PACK_FINISH
 } pack_state_t;
 
+/** latency histograms, per direction and phase **/
+typedef enum
+{
+	LAT_S2U_GATHER,			/** spp -> uart, first byte of a frame to frame packed **/
+	LAT_S2U_DRIVER,			/** direction window requested to the driver lead time over **/
+	LAT_S2U_SINK,			/** driver ready to the last byte of the frame flushed to the uart **/
+	LAT_S2U_TOTAL,			/** first byte of a frame to its last byte flushed to the uart **/
+	LAT_U2S_GATHER,			/** uart -> spp, first held byte to the send decision **/
+	LAT_U2S_SINK,			/** send decision to the bytes flushed to the spp sink **/
+	LAT_U2S_TOTAL,			/** first held byte to the bytes flushed to the spp sink **/
+	LAT_ROUNDTRIP,			/** first spp byte of a request to first uart reply byte sent to spp **/
+	SPPB_LATENCIES
+} sppb_latency_t;
+
 /** sppb connected sub state **/
 typedef enum
 {
@@ -52,9 +86,18 @@ typedef struct
 	/** hal task **/
 	Task				hal_task;
 	
+	/** echo and pipe idle timeouts, on one vm timer **/
+	deadline_service_t	deadlines;
+	
 		
 	/** bluetooth addr, used by cl/spp **/
     bdaddr              bd_addr;
+    
+	/** peer of the spp connection, its session profile is loaded/saved under it **/
+    bdaddr              peer_addr;
+	
+	/** scan super-state, pairable & connecting **/
+	scan_schedule_t		scan;
 	
 	/** initialisation result **/	
 	bool				cl_initialised;		
@@ -64,20 +107,61 @@ typedef struct
 	/** connected state-specific parameters 						**/
     SPP*                spp;					/* connected state 	**/  /** for connected state parameters, don't clean up when transition between sub-state, 	**/
 	Sink				spp_sink;				/* connected state 	**/  /** init and clean in connected enter/exit 											**/
+	uint16				spp_frame_size;			/* connected state 	**/  /** negotiated rfcomm payload size, uart bytes are coalesced up to it 				**/
 	uint16				spp_sink_busy;			/* connected state 	**/
+	link_policy_t		link;					/* connected state 	**/  /** sniff stage driven by pipe traffic, active_idle is kept **/
 	bool				command_started;		/* echo state only  **/
+	uint16				command_scanned;		/* echo state only  **/	 /** bytes of the partial command already searched for its end **/
+	bool				command_pending;		/* echo state only  **/	 /** a batch waits for SPPB_ECHO_SINK_READY **/
+	uint16				command_end;			/* echo state only  **/	 /** bytes of complete commands in the pending batch **/
 	uint16				command_result;			/* echo state only	**/	 /** this code is used to indicate what should be returned. due to parse code, there is no otherway for sync method return value **/
+	bool				command_connect;		/* echo state only	**/	 /** the OK result came from AT+CONNECT, switch to pipe after echo **/
+	bool				autobauding;			/* echo state only	**/	 /** AT+CONNECT baudrate 0 is listening to the uart **/
+	autobaud_t			autobaud;				/* echo state only	**/
 	uint16				uart_sink_busy;			/* pipe state only	**/
-	uint16				count_down;				/* pipe state only  **/	 /** these two field are for polling timer **/
-	bool				dirty;					/* pipe state only 	**/	
     
     uint8               uart_polarity ;         /*what uart shold active before sending data*/   
     uint16               uart_keeptime;     
+    uint16               uart_baudrate;         /** AT+CONNECT encoding, 0 until configured **/
+    uint16               uart_bits;             /** bits per character on the wire **/
+    uint16               uart_divisor;          /** raw rate given to StreamUartConfigure() **/
+    uint16               uart_stop;             /** AT+CONNECT stop setting, kept by auto-baud **/
+    struct connect       uart_config;           /** last accepted AT+CONNECT, auto-baud result filled in, saved to the peer profile **/
+    
+    uint16               pack_timeout;          /** AT+PACKTIME, fixed packing window in ms, 0 for adaptive **/
+    uint16               coalesce_timeout;      /** AT+COALESCE, uart -> spp coalescing window in ms, 0 sends at once **/
+    uint16               pack_gap_avg;          /** smoothed gap between spp arrivals of one frame, ms x 8 **/
+    uint32               spp_last_arrival;      /* pipe state only	**/
+    bool                 spp_last_full;         /* pipe state only	**/	 /** the last arrival filled an rfcomm packet, more of its frame may follow **/
+    uint32               pack_start;            /* pipe state only	**/	 /** arrival of the first byte of the frame being packed **/
+    bool                 packing;               /* pipe state only	**/
+    uint32               request_time;          /* pipe state only	**/	 /** arrival of the last request, for round-trip measurement **/
+    bool                 awaiting_reply;        /* pipe state only	**/
+    
+    uint32               frame_tx_start;        /* pipe state only	**/	 /** direction window of the front frame was requested **/
+    uint32               frame_tx_ready;        /* pipe state only	**/	 /** its first uart sink ready, the driver lead time is over **/
+    bool                 frame_driver_wait;     /* pipe state only	**/
+    uint32               uart_arrival;          /* pipe state only	**/	 /** first uart byte not sent to spp yet **/
+    uint32               uart_send;             /* pipe state only	**/	 /** SPPB_PIPE_SPP_SINK_READY was posted for them **/
+    bool                 uart_held;             /* pipe state only	**/
+    bool                 uart_sending;          /* pipe state only	**/
+    
+    latency_hist_t       lat[SPPB_LATENCIES];   /** AT+LATENCY, cleared by AT+LATRESET **/
+    
+    bool                 fast_path;             /* pipe state only	**/	 /** no direction control, uart -> spp is StreamConnect()ed in firmware **/
+    bool                 coalescing;            /* pipe state only	**/	 /** uart bytes are held, SPPB_PIPE_COALESCE_TIMEOUT is running **/
+    
+    escape_detect_t      escape;                /** in-band escape back to echo state **/
+    escape_detect_t      stats_escape;          /** in-band AT+STATS, same guard as the escape **/
+    uint16               escape_scanned;        /* pipe state only	**/	 /** unpacked bytes already fed to the escape detector **/
+    bool                 escape_draining;       /* pipe state only	**/	 /** confirmed escape waits for the frames ahead of it to leave the uart **/
+    uint16               stats_pending;         /* pipe state only	**/	 /** bytes of a confirmed AT+STATS query, it waits for the frames ahead of it **/
     
-    uint8               *pSpp_ReceiveBuf;
-    uint16               Spp_ReceiveNum;
+    frame_queue_t        spp_frames;			/* pipe state only	**/	 /** frames packed from spp, held in the spp source until sent to uart **/
     
-    bool                 buartseting;          
+    bool                 buartseting;           /* pipe state only	**/	 /** uart direction is being driven for the front frame **/
+    bool                 driver_on;             /* pipe state only	**/	 /** PIO3 is driven, released by SPPB_PIPE_DRIVER_RELEASE **/
+    uint16               uart_sink_size;        /* pipe state only	**/	 /** slack of the empty uart sink, what it holds is still to go on the wire **/
 /*
     uint8               *pUart_ReceiveBuf;
     uint16               Uart_ReceiveNum;
@@ -88,13 +172,13 @@ typedef struct
 	
 } sppb_task_t;
 
-tydef struct
+typedef struct
 {
     uint8 head;
     bdaddr btaddr;
     uint32 remaintime;
-    uint8 tail
-}Time_Encryption_t
+    uint8 tail;
+}Time_Encryption_t;
 
 void sppb_init(Task hal_task);
 
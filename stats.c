@@ -0,0 +1,35 @@
+#include <csrtypes.h>
+
+#include "stats.h"
+#include "echo_text.h"
+
+
+uint32 stats_counter[STAT_COUNT];
+
+void statsReset(void) {
+
+	uint16 i;
+
+	for (i = 0; i < STAT_COUNT; i++) {
+
+		stats_counter[i] = 0;
+	}
+}
+
+char* statsFormat(char* p) {
+
+	uint16 i;
+
+	p = echoTextString(p, "+STATS:");
+
+	for (i = 0; i < STAT_COUNT; i++) {
+
+		if (i) {
+
+			*p++ = ',';
+		}
+		p = echoTextUint(p, stats_counter[i]);
+	}
+
+	return echoTextString(p, "\r\n");
+}
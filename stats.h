@@ -0,0 +1,45 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  hot path counters, read with AT+STATS in echo state or "???" framed by guard silence in pipe state.
+  counting is a single increment of a global, no call. counters are uint32 and wrap, they are kept
+  across connections from power on.
+
+  the report is "+STATS:<c0>,<c1>,...\r\n" in the order of stat_id_t below.
+
+  **************************************/
+
+typedef enum {
+
+	STAT_SPP_TO_UART_BYTES,			/** moved from spp source to uart sink **/
+	STAT_SPP_TO_UART_FRAMES,		/** frames completely sent to uart **/
+	STAT_UART_TO_SPP_BYTES,			/** vm path only, the firmware fast path is not seen **/
+	STAT_UART_TO_SPP_PACKETS,		/** spp sink flushes of uart data **/
+	STAT_FRAMES_MERGED,				/** frames merged into the previous one, frame queue full while uart was busy **/
+	STAT_BYTES_DROPPED,				/** spp bytes given up because StreamMove() fell short **/
+	STAT_SINK_FULL,					/** a sink had no slack when data was ready for it **/
+	STAT_EXCEPTIONS,				/** raise_exception() **/
+	STAT_SPP_SINK_WAITS,			/** MessageSendConditionally() posted while spp_sink_busy was set **/
+	STAT_UART_SINK_WAITS,			/** MessageSendConditionally() on uart_sink_busy, always set first so each one waits **/
+	STAT_PACK_TIMEOUTS,				/** packing window expired, a frame was packed **/
+	STAT_STATE_CHANGES,				/** sppb main state transitions **/
+	STAT_SUBSTATE_CHANGES,			/** echo / pipe entries **/
+	STAT_COUNT
+
+} stat_id_t;
+
+extern uint32 stats_counter[STAT_COUNT];
+
+#define statInc(id)			(stats_counter[(id)]++)
+#define statAdd(id, n)		(stats_counter[(id)] += (n))
+
+void statsReset(void);
+
+/** "+STATS:<c0>,...\r\n" at p, returns new end **/
+char* statsFormat(char* p);
+
+#endif /** STATS_H **/
@@ -0,0 +1,425 @@
+#!/usr/bin/env python3
+"""compile the AT command grammar into the dispatcher and its argument structs.
+
+	python3 tools/at_compile.py [at_command.grammar] [at_command.c] [at_command.h]
+
+the command names become a trie in one dense table, a row per state and a column per letter that
+appears in any name, so each byte of a name is one table lookup however many commands there are.
+the state a name ends in gives its command, the argument count and a dispatch function that
+fills the typed struct and calls the handler. the fields of a struct are in alphabetical order,
+as genparse laid them out.
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+COMMAND = re.compile(r"^\{\s*(?:\\r\\n)?\s*AT\s*\+\s*([A-Za-z]+)\s*(?:=\s*(.*?))?\s*\\r\\n\s*\}\s*:\s*(\w+)\s*$")
+FIELD = re.compile(r"^%d:(\w+)$")
+
+
+def parse(path):
+	"""[(name, fields, handler, comment)] in grammar order"""
+	commands = []
+	comment = []
+
+	for number, line in enumerate(open(path, encoding="latin-1"), 1):
+		line = line.strip()
+		if not line:
+			comment = []
+			continue
+		if line.startswith("#"):
+			comment.append(line[1:].strip())
+			continue
+
+		m = COMMAND.match(line)
+		if not m:
+			raise SystemExit("%s:%d: not a command" % (path, number))
+
+		fields = []
+		for arg in (m.group(2) or "").split(",") if m.group(2) else []:
+			f = FIELD.match(arg.strip())
+			if not f:
+				raise SystemExit("%s:%d: %r is not %%d:field" % (path, number, arg.strip()))
+			fields.append(f.group(1))
+
+		name = m.group(1).upper()
+		if name in [c[0] for c in commands]:
+			raise SystemExit("%s:%d: AT+%s twice" % (path, number, name))
+		if len(set(fields)) != len(fields):
+			raise SystemExit("%s:%d: a field twice" % (path, number))
+
+		commands.append((name, fields, m.group(3), " ".join(c for c in comment if c and not c.startswith("-"))))
+		comment = []
+
+	if not commands:
+		raise SystemExit("%s: no commands" % path)
+	return commands
+
+
+def build_trie(commands):
+	"""(letters, rows, accept): the column of each letter A-Z, 0 for none, the next state for
+	each state and column, 0 for no transition, and the command + 1 a state ends"""
+	used = sorted(set("".join(c[0] for c in commands)))
+	letters = [used.index(chr(ord("A") + i)) + 1 if chr(ord("A") + i) in used else 0 for i in range(26)]
+	rows = [[0] * len(used)]
+	accept = [0]
+
+	for index, (name, fields, handler, comment) in enumerate(commands):
+		state = 0
+		for ch in name:
+			column = letters[ord(ch) - ord("A")] - 1
+			if not rows[state][column]:
+				rows.append([0] * len(used))
+				accept.append(0)
+				rows[state][column] = len(rows) - 1
+			state = rows[state][column]
+		accept[state] = index + 1
+
+	if len(rows) > 255:
+		raise SystemExit("%d trie states do not fit the uint8 table" % len(rows))
+	return letters, rows, accept
+
+
+def walk(letters, rows, accept, name):
+	"""the command index the table finds for name, -1 for none"""
+	state = 0
+	for ch in name.upper():
+		column = letters[ord(ch) - ord("A")] if "A" <= ch <= "Z" else 0
+		if not column or not rows[state][column - 1]:
+			return -1
+		state = rows[state][column - 1]
+	return accept[state] - 1
+
+
+def verify(commands, letters, rows, accept):
+	"""every name and no prefix or extension of one is found"""
+	names = [c[0] for c in commands]
+	for index, name in enumerate(names):
+		if walk(letters, rows, accept, name) != index or walk(letters, rows, accept, name.lower()) != index:
+			raise SystemExit("the table misses AT+%s" % name)
+		for cut in range(len(name)):
+			if name[:cut] not in names and walk(letters, rows, accept, name[:cut]) != -1:
+				raise SystemExit("the table takes %r for a command" % name[:cut])
+		for ch in "ACEZ":
+			if name + ch not in names and walk(letters, rows, accept, name + ch) != -1:
+				raise SystemExit("the table takes %r for a command" % (name + ch))
+
+
+def tab_width(text):
+	"""columns text takes with tabs of 4"""
+	column = 0
+	for ch in text:
+		column = (column // 4 + 1) * 4 if ch == "\t" else column + 1
+	return column
+
+
+def signature(name, fields):
+	return "AT+%s%s" % (name, "=" + ",".join("<%s>" % f for f in fields) if fields else "")
+
+
+def generated(src):
+	return "  generated by tools/at_compile.py from %s, do not edit." % os.path.relpath(src, ROOT).replace(os.sep, "/")
+
+
+HEADER_TOP = """#ifndef AT_COMMAND_H
+#define AT_COMMAND_H
+
+#include <message.h>
+
+#ifdef __XAP__
+#include <source.h>
+#endif
+
+/**************************************
+
+@GENERATED@
+
+  AT command dispatcher. a command is one line,
+
+	[\\r\\n] AT+<NAME>[=|:<n>[,|;<n>...]] \\r\\n
+
+  with case-insensitive name and decimal uint16 arguments, all of them required. each command has an
+  argument struct below and a handler in at_command_parse.c.
+
+  **************************************/
+
+#define AT_MAX_ARGS		@MAX_ARGS@		/** arguments of the longest command **/
+
+/** handle every complete line in [s, e), returns the start of the first incomplete one **/
+const uint8 *parseData(const uint8 *s, const uint8 *e, Task task);
+
+/** end of the last \\r\\n terminated line in s[0, size), 0 if there is none. bytes before from were
+	searched by an earlier call, only the new ones are looked at **/
+uint16 parseLineEnd(const uint8 *s, uint16 from, uint16 size);
+
+/** a line that is no known command **/
+void handleUnrecognised(const uint8 *data, uint16 length, Task task);
+
+#ifdef __XAP__
+uint16 parseSource(Source rfcDataIncoming, Task task);
+#endif
+"""
+
+SOURCE_TOP = """/**************************************
+
+@GENERATED@
+
+  **************************************/
+
+#include "at_command.h"
+
+#include <source.h>
+
+
+typedef const uint8 *ptr;
+
+/** builds the typed argument struct and calls the handler **/
+typedef void (*at_dispatch_t)(Task task, const uint16 *arg);
+
+typedef struct {
+
+	uint16			args;		/** number of arguments, all required **/
+	at_dispatch_t	dispatch;
+
+} at_command_t;
+
+"""
+
+SOURCE_SCAN = """
+
+static uint8 upper(uint8 c)
+{
+	return 'a' <= c && c <= 'z' ? c + 'A' - 'a' : c;
+}
+
+static ptr skipBlank(ptr s, ptr e)
+{
+	while (s != e && (*s == ' ' || *s == '\\t'))
+		++s;
+	return s;
+}
+
+static ptr skipLineEnd(ptr s, ptr e)
+{
+	while (s != e && (*s == '\\r' || *s == '\\n'))
+		++s;
+	return s;
+}
+
+/** decimal uint16, 0 if there is none or it overflows **/
+static ptr getNumber(ptr s, ptr e, uint16 *value)
+{
+	uint32 v = 0;
+	ptr start = s;
+
+	while (s != e && '0' <= *s && *s <= '9')
+	{
+		v = v * 10 + (*s - '0');
+		if (v > 0xFFFF)
+			return 0;
+		++s;
+	}
+	if (s == start)
+		return 0;
+
+	*value = (uint16)v;
+	return s;
+}
+
+/** one line without its terminator, each byte is looked at once **/
+static bool parseLine(ptr s, ptr e, Task task)
+{
+	uint16 arg[AT_MAX_ARGS];
+	const at_command_t *cmd;
+	uint16 state = 0;
+	uint16 i;
+
+	s = skipBlank(s, e);
+	if (e - s < 2 || upper(s[0]) != 'A' || upper(s[1]) != 'T')
+		return FALSE;
+
+	s = skipBlank(s + 2, e);
+	if (s == e || *s != '+')
+		return FALSE;
+
+	/** one table lookup per byte of the name **/
+	s = skipBlank(s + 1, e);
+	while (s != e && 'A' <= upper(*s) && upper(*s) <= 'Z')
+	{
+		uint16 column = at_letters[upper(*s) - 'A'];
+
+		if (!column || !(state = at_names[state][column - 1]))
+			return FALSE;
+		++s;
+	}
+
+	if (!at_accept[state])
+		return FALSE;
+	cmd = &at_commands[at_accept[state] - 1];
+
+	s = skipBlank(s, e);
+	if (cmd->args)
+	{
+		if (s == e || (*s != '=' && *s != ':'))
+			return FALSE;
+		++s;
+
+		for (i = 0; i < cmd->args; ++i)
+		{
+			s = skipBlank(s, e);
+			if (i)
+			{
+				/** a separator between every two arguments **/
+				if (s == e || (*s != ',' && *s != ';'))
+					return FALSE;
+				s = skipBlank(s + 1, e);
+			}
+
+			s = getNumber(s, e, &arg[i]);
+			if (!s)
+				return FALSE;
+		}
+		s = skipBlank(s, e);
+	}
+
+	if (s != e)
+		return FALSE;
+
+	cmd->dispatch(task, arg);
+	return TRUE;
+}
+
+const uint8 *parseData(ptr s, ptr e, Task task)
+{
+	for (;;)
+	{
+		ptr start, end;
+
+		/** blank lines and the leading \\r\\n of a command **/
+		s = skipLineEnd(skipBlank(s, e), e);
+		if (s == e)
+			return s;
+
+		start = s;
+		while (s != e && *s != '\\r' && *s != '\\n')
+			++s;
+		if (s == e)
+			return start;	/** no terminator yet **/
+
+		end = s;
+		s = skipLineEnd(s, e);
+
+		if (!parseLine(start, end, task))
+			handleUnrecognised(start, (uint16)(s - start), task);
+	}
+}
+
+uint16 parseLineEnd(ptr s, uint16 from, uint16 size)
+{
+	uint16 end = 0;
+	uint16 i;
+
+	/** from byte 2 on, so the leading \\r\\n of a command is not taken for its end. a \\r at the end
+		of the last call still pairs with a \\n at from **/
+	for (i = from < 2 ? 2 : from; i < size; ++i)
+	{
+		if (s[i] == '\\n' && s[i - 1] == '\\r')
+			end = i + 1;
+	}
+	return end;
+}
+
+#ifdef __XAP__
+uint16 parseSource(Source rfcDataIn, Task task)
+{
+	ptr s = SourceMap(rfcDataIn);
+	ptr e = s + SourceSize(rfcDataIn);
+	ptr p = parseData(s, e, task);
+	if (p != s)
+	{
+		SourceDrop(rfcDataIn, (uint16)(p - s));
+		return 1;
+	}
+	return 0;
+}
+#endif
+"""
+
+
+def emit_header(src, out, commands):
+	lines = [HEADER_TOP.replace("@GENERATED@", generated(src)).replace("@MAX_ARGS@", str(max(len(c[1]) for c in commands)))]
+
+	for name, fields, handler, comment in commands:
+		lines.append("/** %s **/" % signature(name, fields))
+		if fields:
+			lines.append("struct %s\n{" % handler)
+			lines.extend("  uint16 %s;" % f for f in sorted(fields))
+			lines.append("};")
+			lines.append("void %s(Task , const struct %s *);" % (handler, handler))
+		else:
+			lines.append("void %s(Task );" % handler)
+		lines.append("")
+
+	lines.append("#endif")
+
+	with open(out, "w") as f:
+		f.write("\n".join(lines) + "\n")
+
+
+def emit_source(src, out, commands, letters, rows, accept):
+	lines = [SOURCE_TOP.replace("@GENERATED@", generated(src))]
+
+	for name, fields, handler, comment in commands:
+		lines.append("static void dispatch%s(Task task, const uint16 *arg)\n{" % handler.capitalize())
+		if fields:
+			lines.append("\tstruct %s c;\n" % handler)
+			lines.extend("\tc.%s = arg[%d];" % (f, i) for i, f in enumerate(fields))
+			lines.append("\n\t%s(task, &c);" % handler)
+		else:
+			lines.append("\targ = arg;\n")
+			lines.append("\t%s(task);" % handler)
+		lines.append("}\n")
+
+	rows_c = ["\t{ %d,\tdispatch%s }%s" % (len(fields), handler.capitalize(), "," if i + 1 < len(commands) else "")
+			  for i, (name, fields, handler, comment) in enumerate(commands)]
+	width = max(tab_width(r) for r in rows_c) // 4 * 4 + 8
+	rows_c = [r + "\t" * ((width - tab_width(r) + 3) // 4) + "/** %s, %s **/" % (c[0], c[3]) for r, c in zip(rows_c, commands)]
+	lines.append("/** indexed by at_accept[] **/")
+	lines.append("static const at_command_t at_commands[%d] = {\n" % len(commands))
+	lines.extend(rows_c)
+	lines.append("};\n")
+
+	lines.append("/** column of each letter A-Z in at_names[], 0 for a letter in no name **/")
+	lines.append("static const uint8 at_letters[26] = {\n\t%s\n};\n" % ", ".join(str(c) for c in letters))
+
+	lines.append("/** name trie, the next state for each state and letter column, 0 ends the walk. state 0 is")
+	lines.append("\tthe start of every name **/")
+	lines.append("static const uint8 at_names[%d][%d] = {\n" % (len(rows), len(rows[0])))
+	lines.append(",\n".join("\t{ %s }" % ", ".join("%2d" % n for n in row) for row in rows))
+	lines.append("};\n")
+
+	lines.append("/** the command + 1 whose name ends in each state, 0 for none **/")
+	lines.append("static const uint8 at_accept[%d] = {\n\t%s\n};" % (len(accept), ", ".join(str(a) for a in accept)))
+
+	with open(out, "w") as f:
+		f.write("\n".join(lines) + SOURCE_SCAN)
+
+
+def main():
+	src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(ROOT, "at_command.grammar")
+	out_c = sys.argv[2] if len(sys.argv) > 2 else os.path.join(ROOT, "at_command.c")
+	out_h = sys.argv[3] if len(sys.argv) > 3 else os.path.join(ROOT, "at_command.h")
+
+	commands = parse(src)
+	letters, rows, accept = build_trie(commands)
+	verify(commands, letters, rows, accept)
+	emit_header(src, out_h, commands)
+	emit_source(src, out_c, commands, letters, rows, accept)
+
+	print("%d commands, %d trie states x %d letters" % (len(commands), len(rows), len(rows[0])))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""compile spp_dev_b_leds.led into the led_timeline step tables.
+
+	python3 tools/led_compile.py [spp_dev_b_leds.led] [led_patterns.c]
+
+host/fixture holds the patterns from before the indication layers, compiled the same way for
+test_led:
+
+	python3 tools/led_compile.py host/fixture/spp_dev_b_leds.led host/fixture/led_patterns.c
+
+every pattern is played through a model of the entry by entry ledsPlay() engine and of a compiled
+led_timeline layer, the output is only written if the pio levels seen between instants are the
+same for all of them.
+
+the pios listed in MIXED are sounded by any layer, the others make up the rgb led which the top
+lit layer owns.
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+LED_ON, LED_OFF = 1, 0
+MIXED = ("BUZZER",)
+
+
+def parse(path):
+	pios = {}
+	patterns = []
+
+	for line in open(path, encoding="latin-1"):
+		words = line.split("//")[0].split()
+		if not words:
+			continue
+
+		if words[0] == "pio":
+			pios[words[2]] = 1 << int(words[1])
+		elif words[0] == "pattern":
+			patterns.append((words[1], "RPT" in words[2:], []))
+		else:
+			mask = 0
+			for name in words[:-2]:
+				mask |= pios[name]
+			patterns[-1][2].append((mask, LED_ON if words[-2] == "ON" else LED_OFF, int(words[-1])))
+
+	used = mixed = 0
+	for name, mask in pios.items():
+		used |= mask
+		if name in MIXED:
+			mixed |= mask
+	return used, mixed, patterns
+
+
+def compile_pattern(entries):
+	"""(steps, tail_mask, tail_bits), a step is (mask, bits, time)"""
+	steps = []
+	mask = bits = 0
+
+	for m, on, time in entries:
+		mask |= m
+		bits = (bits & ~m) | (m if on else 0)
+		if time:
+			steps.append((mask, bits, time))
+			mask = bits = 0
+
+	if not steps:
+		return [(mask, bits, 0)], 0, 0
+	return steps, mask, bits
+
+
+def entry_waveform(used, entries, rpt, end):
+	"""levels after each instant with the ledparse engine, one message per entry. a one shot is
+	followed up to the instant it is over"""
+	pins = 0
+	wave = []
+	now = position = 0
+
+	while now <= end:
+		if position >= len(entries):
+			if not rpt:
+				break
+			position = 0
+
+		m, on, time = entries[position]
+		pins = (pins & ~m) | (m if on else 0)
+		position += 1
+
+		if time or len(entries) == 1 or (not rpt and position == len(entries)):
+			if not wave or wave[-1][1] != pins:
+				wave.append((now, pins))
+		if rpt and len(entries) == 1:
+			break
+		now += time
+	return wave
+
+
+def step_waveform(compiled, rpt, end):
+	"""the same for a layer of led_timeline.c"""
+	steps, tail_mask, tail_bits = compiled
+	pins = 0
+	wave = []
+	now = position = 0
+
+	while now <= end:
+		if position >= len(steps):
+			if not rpt:
+				break
+			pins = (pins & ~tail_mask) | tail_bits
+			position = 0
+
+		m, b, time = steps[position]
+		pins = (pins & ~m) | b
+		position += 1
+
+		if not wave or wave[-1][1] != pins:
+			wave.append((now, pins))
+		if rpt and len(steps) == 1 and not tail_mask:
+			break
+		now += time
+	return wave
+
+
+def verify(used, patterns, compiled):
+	for (name, rpt, entries), c in zip(patterns, compiled):
+		a = entry_waveform(used, entries, rpt, 12000)
+		b = step_waveform(c, rpt, 12000)
+		if a != b:
+			raise SystemExit("waveform differs for %s\n  entries  %s\n  compiled %s" % (name, a[:8], b[:8]))
+
+
+def emit(src, out, used, mixed, patterns, compiled):
+	lines = [
+		"/**************************************",
+		"",
+		"  generated by tools/led_compile.py from %s, do not edit." % os.path.relpath(src, ROOT).replace(os.sep, "/"),
+		"",
+		"  **************************************/",
+		"",
+		"#include \"led_timeline.h\"",
+		"",
+		"const uint16 led_pins_used = 0x%04X;" % used,
+		"const uint16 led_pins_mixed = 0x%04X;" % mixed,
+		"",
+	]
+
+	for (name, rpt, entries), (steps, tail_mask, tail_bits) in zip(patterns, compiled):
+		lines.append("/** %s **/" % name)
+		lines.append("static const led_step_t steps_%s[%d] = {" % (name, len(steps)))
+		lines.append(",\n".join("\t{ 0x%04X, 0x%04X, %4d }" % s for s in steps))
+		lines.append("};")
+		lines.append("")
+
+	lines.append("const led_timeline_t led_patterns[%d] = {" % len(patterns))
+	rows = []
+	for (name, rpt, entries), (steps, tail_mask, tail_bits) in zip(patterns, compiled):
+		rows.append("\t{ steps_%s, %d, %s, 0x%04X, 0x%04X }" % (name, len(steps), "TRUE" if rpt else "FALSE", tail_mask, tail_bits))
+	lines.append(",\n".join(rows))
+	lines.append("};")
+	lines.append("")
+	lines.append("const uint16 led_patterns_count = %d;" % len(patterns))
+
+	with open(out, "w") as f:
+		f.write("\n".join(lines) + "\n")
+
+
+def check_enum(src, patterns):
+	"""the tables are indexed by the LedPattern_t ledparse generates next to the .led"""
+	header = os.path.join(os.path.dirname(os.path.abspath(src)), "spp_dev_b_leds.h")
+	text = open(header, encoding="latin-1").read()
+	body = re.search(r"enum LedPatternTag\s*\{(.*?)\}", text, re.S).group(1)
+	names = [n.strip() for n in body.split(",") if n.strip()]
+	if names != [p[0] for p in patterns]:
+		raise SystemExit("%s does not match the .led file, run ledparse first" % header)
+
+
+def main():
+	src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(ROOT, "spp_dev_b_leds.led")
+	out = sys.argv[2] if len(sys.argv) > 2 else os.path.join(ROOT, "led_patterns.c")
+
+	used, mixed, patterns = parse(src)
+	check_enum(src, patterns)
+	compiled = [compile_pattern(entries) for name, rpt, entries in patterns]
+	verify(used, patterns, compiled)
+	emit(src, out, used, mixed, patterns, compiled)
+
+	entries = sum(len(p[2]) for p in patterns)
+	steps = sum(len(c[0]) for c in compiled)
+	print("%d patterns, %d entries compiled to %d steps, waveforms checked" % (len(patterns), entries, steps))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""decode AT+TRACE dumps into a timeline.
+
+reads a captured spp or debug transport log on stdin, picks the +TRACE: lines out of it and prints
+them with the DEBUG() texts from trace_events.h, the time since the first event and since the
+previous one.
+
+	python3 tools/trace_decode.py < capture.txt
+"""
+
+import os
+import re
+import sys
+
+EVENTS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "trace_events.h")
+LINE = re.compile(r"\+TRACE:(\d+),(\d+),(\d+),(\d+)")
+
+
+def load_events(path):
+	events = []
+	with open(path) as f:
+		for m in re.finditer(r'^TRACE_EVENT\((\w+),\s*"(.*)"\)', f.read(), re.M):
+			events.append((m.group(1), m.group(2)))
+	return events
+
+
+def main():
+	events = load_events(sys.argv[1] if len(sys.argv) > 1 else EVENTS)
+	first = last = None
+
+	for text in sys.stdin:
+		m = LINE.search(text)
+		if not m:
+			continue
+
+		event, ms, a, b = (int(v) for v in m.groups())
+		if first is None:
+			first = last = ms
+
+		if event < len(events):
+			name, fmt = events[event]
+			# the firmware formats always take the two args as %d, extra args are ignored
+			args = (a, b)[:fmt.count("%d")]
+			message = (fmt % args).strip()
+		else:
+			name, message = "EVENT_%d" % event, "%d %d" % (a, b)
+
+		print("%8d  +%-5d %-24s %s" % (ms - first, ms - last, name, message))
+		last = ms
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,143 @@
+#include <csrtypes.h>
+#include <sink.h>
+#include <vm.h>
+#include <string.h>
+
+#include "trace.h"
+#include "echo_text.h"
+
+#ifdef DEBUG_ENABLED
+static const char* const trace_format[TRACE_EVENTS] = {
+
+#define TRACE_EVENT(id, format)		format,
+#include "trace_events.h"
+#undef TRACE_EVENT
+};
+#endif
+
+#ifdef TRACE_ENABLED
+
+typedef struct {
+
+	uint16	event;
+	uint16	a;
+	uint16	b;
+	uint32	time;
+
+} trace_entry_t;
+
+/** only built in when recording, it is the largest ram user of the app **/
+static trace_entry_t trace_ring[TRACE_DEPTH];
+static uint16 trace_first;
+static uint16 trace_count;
+
+void traceAdd(trace_event_t event, uint16 a, uint16 b) {
+
+	trace_entry_t* e = &trace_ring[(trace_first + trace_count) & (TRACE_DEPTH - 1)];
+
+	e ->event = event;
+	e ->a = a;
+	e ->b = b;
+	e ->time = VmGetClock();
+
+	if (trace_count < TRACE_DEPTH) {
+
+		trace_count++;
+	}
+	else {
+
+		/** full, the oldest is overwritten **/
+		trace_first = (trace_first + 1) & (TRACE_DEPTH - 1);
+	}
+}
+
+static char* traceLine(char* p, const trace_entry_t* e) {
+
+	p = echoTextString(p, "+TRACE:");
+	p = echoTextUint(p, e ->event);
+	p = echoTextString(p, ",");
+	p = echoTextUint(p, e ->time);
+	p = echoTextString(p, ",");
+	p = echoTextUint(p, e ->a);
+	p = echoTextString(p, ",");
+	p = echoTextUint(p, e ->b);
+
+	return echoTextString(p, "\r\n");
+}
+
+uint16 traceDump(Sink sink, uint16 reserve) {
+
+	char line[40];
+	uint16 claimed = 0;
+
+	while (trace_count) {
+
+		uint16 length = traceLine(line, &trace_ring[trace_first]) - line;
+		uint16 offset;
+
+		if (SinkSlack(sink) < length + reserve) {
+
+			/** the rest waits for the next dump **/
+			break;
+		}
+
+		offset = SinkClaim(sink, length);
+		if (offset == 0xFFFF) {
+
+			break;
+		}
+
+		memcpy(SinkMap(sink) + offset, line, length);
+		claimed += length;
+
+		trace_first = (trace_first + 1) & (TRACE_DEPTH - 1);
+		trace_count--;
+	}
+
+	return claimed;
+}
+
+#ifdef DEBUG_ENABLED
+void traceDumpDebug(void) {
+
+	char line[40];
+
+	while (trace_count) {
+
+		(void)echoTextEnd(traceLine(line, &trace_ring[trace_first]));
+		DEBUG(("%s", line));
+
+		trace_first = (trace_first + 1) & (TRACE_DEPTH - 1);
+		trace_count--;
+	}
+}
+#endif
+
+#else	/** TRACE_ENABLED **/
+
+void traceAdd(trace_event_t event, uint16 a, uint16 b) {
+
+	event = event; a = a; b = b;
+}
+
+uint16 traceDump(Sink sink, uint16 reserve) {
+
+	sink = sink; reserve = reserve;
+
+	return 0;
+}
+
+#endif	/** TRACE_ENABLED **/
+
+#ifdef DEBUG_ENABLED
+void traceDebug(trace_event_t event, uint16 a, uint16 b) {
+
+	DEBUG((trace_format[event], a, b));
+	DEBUG(("\n"));
+}
+
+#ifndef TRACE_ENABLED
+void traceDumpDebug(void) {
+}
+#endif
+#endif	/** DEBUG_ENABLED **/
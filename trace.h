@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <csrtypes.h>
+#include <sink.h>
+
+#include "debug.h"
+
+/**************************************
+
+  binary trace of the data path. an event is an id from trace_events.h, the vm clock and two args,
+  stored in a ring in ram, so tracing costs a few stores instead of printf formatting and does not
+  change the timing being looked at.
+
+  build with -DTRACE_ENABLED to record. without it TRACE() falls back to printing the event format
+  with DEBUG(), and to nothing when DEBUG_ENABLED is not defined either.
+
+  AT+TRACE dumps the ring over spp, the debug build also prints it to the debug transport when the
+  connection ends. tools/trace_decode.py turns a dump back into the DEBUG() texts on a timeline.
+  a dump line is
+
+	+TRACE:<event>,<ms>,<a>,<b>\r\n
+
+  **************************************/
+
+typedef enum {
+
+#define TRACE_EVENT(id, format)		id,
+#include "trace_events.h"
+#undef TRACE_EVENT
+
+	TRACE_EVENTS
+
+} trace_event_t;
+
+#define TRACE_DEPTH			64		/** entries, power of 2 **/
+
+#if defined(TRACE_ENABLED)
+#define TRACE(event, a, b)		traceAdd((event), (uint16)(a), (uint16)(b))
+#elif defined(DEBUG_ENABLED)
+#define TRACE(event, a, b)		traceDebug((event), (uint16)(a), (uint16)(b))
+#else
+#define TRACE(event, a, b)
+#endif
+
+void traceAdd(trace_event_t event, uint16 a, uint16 b);
+
+/** print one event with its DEBUG() format **/
+void traceDebug(trace_event_t event, uint16 a, uint16 b);
+
+/** claim the oldest entries into sink as dump lines, leaving reserve bytes of slack. the entries
+	dumped are removed, returns the claimed length **/
+uint16 traceDump(Sink sink, uint16 reserve);
+
+/** print and remove all entries to the debug transport **/
+#ifdef DEBUG_ENABLED
+void traceDumpDebug(void);
+#else
+#define traceDumpDebug()
+#endif
+
+#endif /** TRACE_H **/
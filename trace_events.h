@@ -0,0 +1,30 @@
+/**************************************
+
+  trace event table, no include guard, included with TRACE_EVENT() defined. the event id is the
+  position in this list, the format is what DEBUG() printed before and takes the two args as %d.
+  tools/trace_decode.py reads this file to render dumps, append new events at the end.
+
+  **************************************/
+
+TRACE_EVENT(TRACE_SPP_MORE_DATA,		"spp connected state pipe subState, SPP_MESSAGE_MORE_DATA message arrived, %d unpacked bytes, %d held")
+TRACE_EVENT(TRACE_PACK_FINISH,			"spp connected state pipe subState,SPP_PIPE_PACK_FINISH arrived, %d bytes packed")
+TRACE_EVENT(TRACE_FRAME_MERGED,			"    frame queue full, merged into previous frame")
+TRACE_EVENT(TRACE_ESCAPE,				"spp connected state pipe subState, escape sequence, back to echo")
+TRACE_EVENT(TRACE_DRIVER_RELEASE,		"spp connected state pipe subState,SPPB_PIPE_DRIVER_RELEASE arrived, last byte is out")
+TRACE_EVENT(TRACE_SPP_MORE_SPACE,		"spp connected state, SPP_MESSAGE_MORE_SPACE message arrived, spp sink has %d byte more space, spp_sink_busy erase...")
+TRACE_EVENT(TRACE_UART_MORE_DATA,		"spp connected state pipe subState, MESSAGE_MORE_DATA message arrived, uart source has %d bytes now...")
+TRACE_EVENT(TRACE_UART_MORE_SPACE,		"spp connected state pipe subState, MESSAGE_MORE_SPACE message arrived, uart has %d byte more space, busy flag erased...")
+TRACE_EVENT(TRACE_COALESCE_TIMEOUT,		"spp connected state pipe subState, SPPB_PIPE_COALESCE_TIMEOUT message arrived...")
+TRACE_EVENT(TRACE_IDLE_TIMEOUT,			"spp connected state pipe subState, SPPB_PIPE_IDLE_TIMEOUT_IND message arrived...")
+TRACE_EVENT(TRACE_UART_SINK_READY,		"spp connected state pipe subState, SPPB_PIPE_UART_SINK_READY message arrived, front frame %d bytes")
+TRACE_EVENT(TRACE_UART_SINK_WAIT,		"    UART_SINK_READY arrived but sink is not available, waiting...")
+TRACE_EVENT(TRACE_UART_MOVED,			"    %d of %d frame bytes moved from spp source to uart sink")
+TRACE_EVENT(TRACE_UART_MOVE_SHORT,		"    count_moved != count, %d of %d moved")
+TRACE_EVENT(TRACE_SPP_SINK_READY,		"spp connected state pipe subState, SPPB_PIPE_SPP_SINK_READY message arrived, uart source wants to send %d bytes, spp sink has %d byte space")
+TRACE_EVENT(TRACE_SPP_SINK_INVALID,		"    SinkIsValid / SourceIsValid failed .........ERROR ??? ")
+TRACE_EVENT(TRACE_SPP_SINK_EMPTY,		"    SPP_SINK_READY arrived but source has no data to send.........ERROR ??? ")
+TRACE_EVENT(TRACE_SPP_SINK_FULL,		"    SPP_SINK_READY arrived but sink is not available3, 1...........ERROR !!! ")
+TRACE_EVENT(TRACE_SPP_MOVED,			"    %d bytes moved from uart source to spp sink, %d left... spp busy flag set...")
+TRACE_EVENT(TRACE_SPP_MOVE_SHORT,		"    count_moved != count, %d of %d moved")
+TRACE_EVENT(TRACE_SPP_FLUSH_FAILED,		"    flush_result!=count_moved")
+TRACE_EVENT(TRACE_STATS_QUERY,			"spp connected state pipe subState, stats query")
@@ -0,0 +1,103 @@
+#include <csrtypes.h>
+
+#include "uart_timing.h"
+
+
+uint16 uartBitsPerChar(uint16 parity, uint16 stop) {
+
+	return 1 + 8 + (parity ? 1 : 0) + (stop == 2 ? 2 : 1);
+}
+
+uint32 uartCharsToUs(uint16 baudrate, uint16 bits_per_char, uint16 chars_x10) {
+
+	if (baudrate == 0) {
+
+		return 0;
+	}
+
+	/** one bit lasts 10000 / baudrate us with baudrate in units of 100 baud **/
+	return ((uint32)chars_x10 * bits_per_char * 1000UL + baudrate - 1) / baudrate;
+}
+
+/** non-standard rates, baudrate in AT+CONNECT encoding and divisor = round(baud x 4096 / 10^6) **/
+static const struct {
+
+	uint16 baudrate;
+	uint16 divisor;
+
+} uart_custom_rates[] = {
+
+	{    12,    5 },		/** 1200 as 1220.7, 1.7% **/
+	{    24,   10 },		/** 2400 as 2441.4, 1.7% **/
+	{    48,   20 },		/** 4800 as 4882.8, 1.7% **/
+	{   144,   59 },		/** 14400 as 14404.3, 0.0% **/
+	{   288,  118 },		/** 28800 as 28808.6, 0.0% **/
+	{   768,  315 },		/** 76800 as 76904.3, 0.1% **/
+	{  1280,  524 },		/** 128000 as 127929.7, 0.1% **/
+	{  2500, 1024 },		/** 250000, exact **/
+	{  2560, 1049 },		/** 256000 as 256103.5, 0.0% **/
+	{  5000, 2048 },		/** 500000, exact **/
+	{ 10000, 4096 }			/** 1000000, exact **/
+};
+
+uint16 uartRateDivisor(uint16 baudrate) {
+
+	uint16 i;
+
+	for (i = 0; i < sizeof(uart_custom_rates) / sizeof(uart_custom_rates[0]); i++) {
+
+		if (uart_custom_rates[i].baudrate == baudrate) {
+
+			/** the table is checked here rather than trusted **/
+			if (uartRateError(baudrate, uart_custom_rates[i].divisor) > UART_RATE_MAX_ERROR) {
+
+				return 0;
+			}
+
+			return uart_custom_rates[i].divisor;
+		}
+	}
+
+	return 0;
+}
+
+uint32 uartDivisorBaud(uint16 divisor) {
+
+	/** divisor x 10^6 / 4096 **/
+	return ((uint32)divisor * 15625UL + 32) / 64;
+}
+
+uint32 uartDivisorBytesToUs(uint16 divisor, uint16 bits_per_char, uint16 bytes) {
+
+	if (divisor == 0) {
+
+		return 0;
+	}
+
+	/** one bit lasts 4096 / divisor us **/
+	return ((uint32)bytes * bits_per_char * 4096UL + divisor - 1) / divisor;
+}
+
+uint16 uartRateError(uint16 baudrate, uint16 divisor) {
+
+	/** both in 1/64 baud, where divisor x 10^6 / 4096 is exact **/
+	uint32 requested = (uint32)baudrate * 6400;
+	uint32 actual = (uint32)divisor * 15625;
+	uint32 diff = actual > requested ? actual - requested : requested - actual;
+
+	/** off by the whole rate or more, not a divisor for it **/
+	if (requested == 0 || diff >= requested) {
+
+		return 0xFFFF;
+	}
+
+	/** diff x 1000 / requested, the baudrate is in units of 100 baud **/
+	return (uint16)((diff * 5 + (uint32)baudrate * 16) / ((uint32)baudrate * 32));
+}
+
+uint16 uartUsToMs(uint32 us) {
+
+	uint32 ms = (us + 999) / 1000;
+
+	return ms > 0xFFFF ? 0xFFFF : (uint16)ms;
+}
@@ -0,0 +1,39 @@
+#ifndef UART_TIMING_H
+#define UART_TIMING_H
+
+#include <csrtypes.h>
+
+/**************************************
+
+  uart line timing helpers. baudrate, parity and stop use the AT+CONNECT encoding, i.e. baudrate is
+  in units of 100 baud (96 is 9600), parity is 0 none / 1 odd / 2 even, stop is 1 or 2.
+
+  **************************************/
+
+/** start bit + 8 data bits + parity + stop bits **/
+uint16 uartBitsPerChar(uint16 parity, uint16 stop);
+
+/** wire time of chars_x10 / 10 characters in microseconds, 0 if baudrate is unknown **/
+uint32 uartCharsToUs(uint16 baudrate, uint16 bits_per_char, uint16 chars_x10);
+
+/** the uart divisor counts in steps of 10^6 / 4096 baud (244.14 baud), which is what the VM_UART_RATE_*
+	values are, e.g. 472 for 115200. StreamUartConfigure() takes a raw divisor as rate **/
+#define UART_RATE_MAX_ERROR		20		/** per mille, beyond this the far end samples unreliably **/
+
+/** raw divisor for a non-standard baudrate from the checked table, 0 if not supported **/
+uint16 uartRateDivisor(uint16 baudrate);
+
+/** baud actually produced by a raw divisor **/
+uint32 uartDivisorBaud(uint16 divisor);
+
+/** wire time of whole characters in microseconds at the baud a raw divisor actually produces, rounded up,
+	0 if the divisor is unknown **/
+uint32 uartDivisorBytesToUs(uint16 divisor, uint16 bits_per_char, uint16 bytes);
+
+/** |actual - requested| / requested in per mille, rounded, 0xFFFF if the divisor is off by 100% or more **/
+uint16 uartRateError(uint16 baudrate, uint16 divisor);
+
+/** microseconds to milliseconds, rounded up **/
+uint16 uartUsToMs(uint32 us);
+
+#endif /** UART_TIMING_H **/